@@ -0,0 +1,189 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Captura com disparo (ver capture.h).
+ * O core0 só escreve no buffer enquanto o estado é ARMED/TRIGGERED; o
+ * core1 só lê depois de ver DONE, então não há disputa pelas amostras.
+ * O estado só muda no core0: armar e desarmar são pedidos que o core0
+ * aplica no início do capture_push.
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "capture.h"
+#include "telemetry.h"
+
+// Valores físicos das sondas (a quantização fica para o despejo)
+static float cap_buf[CAPTURE_DEPTH][CAPTURE_MAX_CH];
+
+static volatile uint32_t cap_state = CAPTURE_IDLE;
+
+// Pedidos do core1 (armar/desarmar): cap_req só é escrito pelo core1 e
+// cap_ack só pelo core0, que aplica o pedido entre dois passos. Assim o
+// core1 nunca mexe no estado enquanto o core0 está no capture_push.
+#define CAP_REQ_ARM     1u
+#define CAP_REQ_DISARM  2u
+static volatile uint32_t cap_req, cap_ack;     // (sequência << 2) | pedido
+
+// Configuração pedida (escrita pelo core1 só sem pedido pendente)
+static const volatile float *cap_new_src;
+static float    cap_new_level;
+static uint32_t cap_new_mode, cap_new_pre, cap_new_post;
+
+// Configuração em uso (escrita pelo core0 ao aplicar o pedido)
+static const volatile float *cap_src;
+static float    cap_level;
+static uint32_t cap_mode;
+static uint32_t cap_pre, cap_post;
+static int      cap_nch;            // sondas gravadas (c->probes ao armar)
+static float    cap_dt;
+static ms_probe_def_t cap_def[CAPTURE_MAX_CH];
+
+// Estado do core0
+static uint32_t cap_wr;             // amostras gravadas desde o armar
+static uint32_t cap_left;           // amostras pós-disparo restantes
+static uint32_t cap_trig;           // índice da amostra do disparo
+static float    cap_prev;           // valor anterior da fonte (bordas)
+
+static void cap_request(uint32_t what)
+{
+    uint32_t seq = (cap_req >> 2) + 1u;
+    __dmb();                        // configuração antes do pedido
+    cap_req = (seq << 2) | what;
+}
+
+int capture_arm(const volatile float *src, capture_mode_t mode, float level,
+                uint32_t pre, uint32_t post)
+{
+    if (src == NULL || post == 0 || pre + 1 + post > CAPTURE_DEPTH) return -1;
+    if (cap_req != cap_ack) return -2;
+
+    cap_new_src   = src;
+    cap_new_mode  = (uint32_t)mode;
+    cap_new_level = level;
+    cap_new_pre   = pre;
+    cap_new_post  = post;
+    cap_request(CAP_REQ_ARM);
+    return 0;
+}
+
+void capture_disarm(void)
+{
+    cap_request(CAP_REQ_DISARM);
+}
+
+capture_state_t capture_state(void)
+{
+    return (capture_state_t)cap_state;
+}
+
+// ======================================================
+// CORE0
+// ======================================================
+
+// Aplica o pedido do core1 (o último vence: desarmar cancela um armar
+// ainda não aplicado)
+static void cap_apply(const ms_circuit_t *c, uint32_t req)
+{
+    if ((req & 3u) == CAP_REQ_ARM) {
+        cap_src   = cap_new_src;
+        cap_mode  = cap_new_mode;
+        cap_level = cap_new_level;
+        cap_pre   = cap_new_pre;
+        cap_post  = cap_new_post;
+        cap_nch   = c->probes;
+        cap_dt    = c->dt;
+        for (int i = 0; i < cap_nch; i++)
+            cap_def[i] = c->probe[i].def;
+        cap_wr    = 0;
+        cap_prev  = *cap_src;
+        __dmb();
+        cap_state = CAPTURE_ARMED;
+    } else {
+        cap_state = CAPTURE_IDLE;
+    }
+    __dmb();
+    cap_ack = req;
+}
+
+void capture_push(const ms_circuit_t *c)
+{
+    uint32_t req = cap_req;
+    if (req != cap_ack) {
+        __dmb();                    // configuração pedida visível
+        cap_apply(c, req);
+    }
+
+    uint32_t st = cap_state;
+    if (st != CAPTURE_ARMED && st != CAPTURE_TRIGGERED) return;
+
+    float *dst = cap_buf[cap_wr & (CAPTURE_DEPTH - 1)];
+    for (int i = 0; i < cap_nch; i++)
+        dst[i] = c->probe[i].value;
+    uint32_t w = cap_wr++;
+
+    if (st == CAPTURE_TRIGGERED) {
+        if (--cap_left == 0) {
+            __dmb();                // buffer completo antes do estado
+            cap_state = CAPTURE_DONE;
+        }
+        return;
+    }
+
+    // Armada: compara com o nível (só depois de ter o histórico pedido)
+    float x = *cap_src, prev = cap_prev;
+    float lv = cap_level;
+    int hit;
+    cap_prev = x;
+    switch (cap_mode) {
+        case CAPTURE_RISE: hit = (prev <  lv) && (x >= lv); break;
+        case CAPTURE_FALL: hit = (prev >  lv) && (x <= lv); break;
+        case CAPTURE_HIGH: hit = (x >= lv); break;
+        default:           hit = (x <= lv); break;
+    }
+    if (hit && w >= cap_pre) {
+        cap_trig  = w;
+        cap_left  = cap_post;
+        cap_state = CAPTURE_TRIGGERED;
+    }
+}
+
+// ======================================================
+// CORE1
+// ======================================================
+
+int capture_dump(uint32_t sat[CAPTURE_MAX_CH])
+{
+    static int16_t blk[TELEM_BATCH * CAPTURE_MAX_CH];
+
+    for (int i = 0; i < CAPTURE_MAX_CH; i++) sat[i] = 0;
+    // Com pedido pendente o core0 pode rearmar e gravar no meio do despejo
+    if (cap_state != CAPTURE_DONE || cap_req != cap_ack) return 0;
+    __dmb();
+
+    int nch = cap_nch;
+    uint32_t first = cap_trig - cap_pre;
+    uint32_t total = cap_pre + 1 + cap_post;     // inclui a amostra do disparo
+    if (total > CAPTURE_DEPTH) total = CAPTURE_DEPTH;
+
+    telemetry_send_trigger(cap_trig, (uint16_t)cap_pre, (uint16_t)cap_post);
+    telemetry_send_desc_defs(cap_def, nch, cap_dt, 1);
+
+    for (uint32_t k = 0; k < total; ) {
+        int n = 0;
+        for (; n < TELEM_BATCH && k + (uint32_t)n < total; n++) {
+            const float *s = cap_buf[(first + k + (uint32_t)n) & (CAPTURE_DEPTH - 1)];
+            for (int i = 0; i < nch; i++) {
+                float y = s[i] * cap_def[i].gain + cap_def[i].offset;
+                if (!(y >= 0.0f && y <= 1.0f)) sat[i]++;
+                blk[n * nch + i] = telemetry_quantize(&cap_def[i], s[i]);
+            }
+        }
+        telemetry_send_data(first + k, 0, nch, n, blk);
+        k += (uint32_t)n;
+    }
+    return (int)total;
+}
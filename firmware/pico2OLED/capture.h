@@ -0,0 +1,68 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Captura com disparo, no estilo de um osciloscópio.
+ * A cada passo o core0 grava o valor de todas as sondas em um buffer
+ * circular e compara a fonte de disparo (uma sonda ou uma entrada) com o
+ * nível configurado: custo fixo de algumas escritas e uma comparação,
+ * então a captura pode ficar armada o tempo todo.
+ *
+ * Depois do disparo são gravadas mais "pos" amostras e o buffer congela
+ * com "pre" amostras de histórico. O core1 despeja a captura pela USB
+ * usando os quadros da telemetria (TRIG + DESC + DATA).
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include "mini_spiceHILv3.h"
+
+// ======================================================
+// CONFIGURAÇÕES
+// ======================================================
+
+#define CAPTURE_DEPTH       1024        // amostras (potência de 2), 32 KB
+#define CAPTURE_MAX_CH      MS_MAX_PROBES
+
+typedef enum {
+    CAPTURE_RISE,       // cruzou o nível subindo
+    CAPTURE_FALL,       // cruzou o nível descendo
+    CAPTURE_HIGH,       // valor >= nível
+    CAPTURE_LOW         // valor <= nível
+} capture_mode_t;
+
+typedef enum {
+    CAPTURE_IDLE,       // desarmada
+    CAPTURE_ARMED,      // gravando histórico, aguardando disparo
+    CAPTURE_TRIGGERED,  // gravando as amostras pós-disparo
+    CAPTURE_DONE        // congelada, pronta para despejo
+} capture_state_t;
+
+// ======================================================
+// API
+// ======================================================
+
+// core1: pede para armar a captura. src aponta para a grandeza de disparo
+// (valor de uma sonda ou entrada externa); pre + 1 + pos <= CAPTURE_DEPTH.
+// O core0 aplica o pedido no próximo capture_push, guardando o número de
+// sondas, as definições e o dt do circuito daquele momento. Retorna -1
+// com parâmetros inválidos e -2 se o pedido anterior ainda não foi aplicado.
+int  capture_arm(const volatile float *src, capture_mode_t mode, float level,
+                 uint32_t pre, uint32_t post);
+void capture_disarm(void);
+capture_state_t capture_state(void);
+
+// core0, uma vez por passo, depois de output_circuit()
+void capture_push(const ms_circuit_t *c);
+
+// core1: envia a captura congelada (TRIG + DESC + DATA) com as sondas do
+// momento em que foi armada. Retorna o número de amostras enviadas (0 se
+// não há captura pronta); sat[i] recebe quantas amostras da sonda i saíram
+// de 0..1 depois de ganho e offset (cortadas na escala do PWMDAC).
+int  capture_dump(uint32_t sat[CAPTURE_MAX_CH]);
+
+#endif // CAPTURE_H
@@ -40,7 +40,10 @@
  */
 
 #include "mini_spiceHILv3.h"
-#include "hardware/pwm.h"
+#include "pwmdac.h"
+
+// Razão cíclica medida no GPIO6 (picoHIL_BETAv0.c, gpio_edge.h)
+extern volatile float duty0_val;
 
 // ======================================================
 // DEFINIÇÕES PARA SELECIONAR O EXEMPLO DE CIRCUITO
@@ -51,6 +54,7 @@
 #define EXEMPLO_RL_SIMPLE           0
 #define EXEMPLO_RL_MULTISOURCE      0
 #define EXEMPLO_BOOST               0
+#define EXEMPLO_BOOST_MEDIO         0
 #define EXEMPLO_TRIFASICO_V1        0
 #define EXEMPLO_TRIFASICO_V2        1
 #define MY_CIRCUIT        0
@@ -64,8 +68,8 @@ void setup_rl_harmonics(ms_circuit_t *c, volatile float *adc_in);
 void setup_rl_multiplesource(ms_circuit_t *c, volatile float *adc_in);
 void setup_boost_dual(ms_circuit_t *c, volatile float *adc_in, volatile float *io_in); 
 void update_boost_sources(ms_circuit_t *c, volatile float *adc_in, volatile float *io_in);
+void setup_boost_avg(ms_circuit_t *c, volatile float *adc_in, volatile float *duty_in);
 
-void outputs_three_phase_rl(ms_circuit_t *c);
 void setup_three_phase_rl(ms_circuit_t *c, volatile float *adc_in);
 void setup_three_phase_rl2(ms_circuit_t *c, volatile float *adc_in);
 void update_3f_sources(ms_circuit_t *c, volatile float *adc_in);
@@ -73,141 +77,33 @@ void update_3f_sources(ms_circuit_t *c, volatile float *adc_in);
 void setup_my_circuit(ms_circuit_t *c, volatile float *adc_in);
 void custom_update_sources(ms_circuit_t *c, volatile float *adc_in);
 
-// Declaracao principal do circuito
-void setup_circuit(ms_circuit_t *c, volatile float *adc_in, volatile float *io_in)
-{
-#if EXEMPLO_RLC_SIMPLE_V1
-    setup_rlc_circuit_simple(c, adc_in);
-#elif EXEMPLO_RLC_SIMPLE_V2
-    setup_rlc_circuit_simpleV2(c, adc_in);
-#elif EXEMPLO_RL_SIMPLE
-    setup_rl_simple(c, adc_in);
-#elif EXEMPLO_RL_MULTISOURCE
-    setup_rl_multiplesource(c, adc_in);
-#elif EXEMPLO_BOOST   
-    setup_boost_dual(c, adc_in, io_in); 
-#elif EXEMPLO_TRIFASICO_V1
-    setup_three_phase_rl(c, adc_in);
-#elif EXEMPLO_TRIFASICO_V2
-    setup_three_phase_rl2(c, adc_in);
-#endif
-} 
-
-void output_circuit(ms_circuit_t *c)
+// ======================================================
+// TABELAS DE SONDAS (SAÍDAS PWMDAC)
+// ======================================================
+// Cada linha: { tipo, a, b, ganho, offset, canal }
+// . tipo: MS_PROBE_NODE (tensão do nó a), MS_PROBE_DIFF (Va - Vb) ou
+//   MS_PROBE_CURRENT (corrente do elemento de índice a: fontes de tensão,
+//   indutores, fontes controladas por tensão e resistores).
+//   Os índices podem ser consultados na listagem exibida no início:
+//   === Lista de componentes do circuito ===
+//   [0] Fonte de tensão  (nó 1 ↔ nó 3)  valor=1.00000
+//   [1] Fonte de tensão  (nó 3 ↔ nó 0)  valor=1.00000
+//   [2] Resistor         (nó 1 ↔ nó 2)  valor=1.00000
+//   ...
+// . ganho: ajusta a escala; para normalizar em torno de 3.3V
+//   (0V => 3.3V na simulacao será 0V=>3.3V na saida do PWMDAC) use 1.0f/3.3f
+// . offset: 0.5f coloca a saída no meio do 3.3V do PWMDAC (1.65V);
+//   para sinais bipolares (-/+) é importante manter esse offset.
+//   Para visualizar apenas a parte positiva do sinal, use 0.0f.
+// . canal: PWMDAC_CH(gpio) com gpio entre 14 e 21.
+//==============================================
+// Cada tabela fica junto do seu exemplo e só a do EXEMPLO_* ativo é
+// compilada (setup_circuit, no fim do arquivo).
+
+void MS_RAM_FUNC(output_circuit)(ms_circuit_t *c)
 {
-    // Para visualizar a saida do circuito nos PWM+LPF (PWMDAC simples)
-    // iL = ms_get_element_current(c, 3); // como exemplo a corrente no indutor de indice 3
-    // os indices podem ser consultados no inicio da execucao 
-    // === Lista de componentes do circuito ===
-    // [0] Fonte de tensão  (nó 1 ↔ nó 3)  valor=1.00000
-    // [1] Fonte de tensão  (nó 3 ↔ nó 0)  valor=1.00000
-    // [2] Resistor         (nó 1 ↔ nó 2)  valor=1.00000
-    // [3] Indutor          (nó 2 ↔ nó 0)  valor=0.0100000
-    // [4] Resistor         (nó 2 ↔ nó 0)  valor=50000.0
-    // [5] Resistor         (nó 3 ↔ nó 0)  valor=10.00000e+05
-    // ========================================
-    // se emprega a funcao ms_signal_to_pwm(iL, 1.0f, 0.5f, PWM_WRAP);
-    // para converter o valor simulado (exemplo: corrente)
-    // . o primeiro parametro diz respeito a variavel a ser medida (iL)
-    // . o segundo é o ganho => nesse caso deve ser ajustado para a escala apropriada
-    //      se quiser normalizar em torno de 3.3V 
-    //      (0V => 3.3V na simulacao será 0V=>3.3V na saida do PWMDAC),
-    //      basta por o ganho c/ 1.0f/3.3f
-    // . o terceiro eh o offset => 0.5f coloca a saída no meio do 3.3V do PWMDAC (1.65V)
-    // para sinais que apresentam bipolaridade (-/+) é importante manter com esse offset.
-    // caso queira visualizar apenas a parte positiva do sinal, colocar esse valor em 0.0f
-    // . o quarto eh sempre PWM_WRAP
-    //==============================================
-
-#if EXEMPLO_TRIFASICO_V1 || EXEMPLO_TRIFASICO_V2
-    outputs_three_phase_rl(c);
-#elif  EXEMPLO_RLC_SIMPLE_V1 
-    float iL, vC, v1; 
-    // Corrente no indutor (elemento 1)
-    iL = ms_get_element_current(c, 1);
-    // Atualiza PWM com corrente normalizada
-    uint16_t duty = ms_signal_to_pwm(iL, 1.0f/3.3f, 0.5f, PWM_WRAP);
-    pwm_set_chan_level(pwm_gpio_to_slice_num(16), PWM_CHAN_A, duty);
-
-    vC = ms_get_node_voltage(c, 2); // Tensao no capacitor
-    duty = ms_signal_to_pwm(vC, 1.0f/3.3f, 0.5f, PWM_WRAP);
-    pwm_set_chan_level(pwm_gpio_to_slice_num(17), PWM_CHAN_B, duty); 
-
-    // Tensao no RLC para visualizar o que eh aplicado ao circuito
-    v1 = ms_get_node_voltage(c, 1); 
-    duty = ms_signal_to_pwm(v1, 1.0f/3.3f, 0.5f, PWM_WRAP);     
-    pwm_set_chan_level(pwm_gpio_to_slice_num(18), PWM_CHAN_A, duty); 
-#elif EXEMPLO_RLC_SIMPLE_V2
-    float iR, vC;   
-    // Corrente no resistor-serie com indutor (elemento 2)
-    iR = ms_get_resistor_current(c, 2);
-    // Atualiza PWM com corrente normalizada
-    uint16_t duty = ms_signal_to_pwm(iR, 1.0f, 0.5f, PWM_WRAP);
-    pwm_set_chan_level(pwm_gpio_to_slice_num(16), PWM_CHAN_A, duty);
-
-    vC = ms_get_node_voltage(c, 3); // Tensao no capacitor
-    duty = ms_signal_to_pwm(vC, 1.0f/3.3f, 0.5f, PWM_WRAP);
-    pwm_set_chan_level(pwm_gpio_to_slice_num(17), PWM_CHAN_B, duty); 
-#elif EXEMPLO_RL_SIMPLE 
-    /***********************************************/
-    // Para o exemplo setup_rl_simple()
-    float V1, iR1, vL1;
-
-    V1 = ms_get_node_voltage(c, 1);
-    // Normaliza 0–3.3 V para 0–1
-    uint16_t duty = ms_signal_to_pwm(V1, 1.0f/3.3f, 0.5f, PWM_WRAP);
-    pwm_set_chan_level(pwm_gpio_to_slice_num(16), PWM_CHAN_A, duty);
-    
-    //iL1 = ms_get_element_current(c, 2);   // Medicao de corrente no indutor
-    iR1 = ms_get_resistor_current(c, 1);    // Medicao de corrente no resistor
-    duty = ms_signal_to_pwm(iR1, 1.00f, 0.5f, PWM_WRAP);
-    pwm_set_chan_level(pwm_gpio_to_slice_num(17), PWM_CHAN_B, duty);  
-
-    vL1 = ms_get_node_voltage(c, 2);    // Tensao no indutor.
-    duty = ms_signal_to_pwm(vL1, 1.0f/3.3f, 0.5f, PWM_WRAP);
-    pwm_set_chan_level(pwm_gpio_to_slice_num(18), PWM_CHAN_A, duty);  
-     /**********************************************/
-#elif EXEMPLO_RL_MULTISOURCE
-    /***********************************************/
-    // Para o exemplo setup_rl_simple()
-    float V1, iR1, vL1, iL1;
-
-    V1 = ms_get_node_voltage(c, 1);
-    // Normaliza 0–3.3 V para 0–1
-    uint16_t duty = ms_signal_to_pwm(V1, 1.0f/3.3f, 0.5f, PWM_WRAP);
-    pwm_set_chan_level(pwm_gpio_to_slice_num(16), PWM_CHAN_A, duty);
-    
-    iR1 = ms_get_resistor_current(c, 2);    // Corrente atraves do resistor.
-    duty = ms_signal_to_pwm(iR1, 1.00f, 0.5f, PWM_WRAP);
-    pwm_set_chan_level(pwm_gpio_to_slice_num(17), PWM_CHAN_B, duty);  
-    
-    vL1 = ms_get_node_voltage(c, 2); // Tensao no indutor
-    duty = ms_signal_to_pwm(vL1, 1.0f/3.3f, 0.5f, PWM_WRAP);
-    //iL1 = ms_get_element_current(c, 3); // Corrente através do indutor
-    //duty = ms_signal_to_pwm(iL1, 1.00f, 0.5f, PWM_WRAP);
-    pwm_set_chan_level(pwm_gpio_to_slice_num(18), PWM_CHAN_A, duty);  
-    /**********************************************/
-#elif EXEMPLO_BOOST 
-// Para o exemplo setup_boost_dual()
-    float Vsw, Vo, vL1, iL1;
-    Vsw = ms_get_node_voltage(c, 2);
-    // Normaliza 0–3.3 V para 0–1
-    uint16_t duty = ms_signal_to_pwm(Vsw, 1.0f/3.3f, 0.0f, PWM_WRAP);
-    pwm_set_chan_level(pwm_gpio_to_slice_num(17), PWM_CHAN_B, duty);
-
-    Vo = ms_get_node_voltage(c, 3);
-    duty = ms_signal_to_pwm(Vo, 1.0f/3.3f, 0.0f, PWM_WRAP);
-    pwm_set_chan_level(pwm_gpio_to_slice_num(18), PWM_CHAN_A, duty);
-
-    iL1 = ms_get_element_current(c, 1); // 1 => Indutor
-    duty = ms_signal_to_pwm(iL1, 25.0f*1.0f/3.3f, 0.0f, PWM_WRAP);
-    //Vo = ms_get_node_voltage(c, 4);
-    //duty = ms_signal_to_pwm(Vo, 1.0f/3.3f, 0.0f, PWM_WRAP);
-    pwm_set_chan_level(pwm_gpio_to_slice_num(19), PWM_CHAN_B, duty);  
-#else
-    // my_circuit
-
-#endif
+    // Avalia a tabela de sondas do circuito ativo e escreve nos PWMDAC
+    ms_probes_eval(c, pwmdac_set, PWMDAC_LEVEL_MAX(PWM_WRAP));
 }
 // ======================================================
 // CIRCUITO CUSTOMIZADO
@@ -244,6 +140,14 @@ void update_sources(ms_circuit_t *c, volatile float *adc_in, volatile float *io_
 // ======================================================
 // CIRCUITO RLC SIMPLES
 // ======================================================
+#if EXEMPLO_RLC_SIMPLE_V1
+static const ms_probe_def_t probes_rlc_simple[] = {
+    { MS_PROBE_CURRENT, 1, 0, 1.0f/3.3f, 0.5f, PWMDAC_CH(16) },  // corrente no indutor (elemento 1)
+    { MS_PROBE_NODE,    2, 0, 1.0f/3.3f, 0.5f, PWMDAC_CH(17) },  // tensao no capacitor
+    { MS_PROBE_NODE,    1, 0, 1.0f/3.3f, 0.5f, PWMDAC_CH(18) },  // tensao aplicada ao RLC
+};
+#endif
+
 void setup_rlc_circuit_simple(ms_circuit_t *c, volatile float *adc_in) {
     ms_circuit_init(c, 2, 100e-6f); // 2 nós, dt=100us
 
@@ -266,6 +170,13 @@ void setup_rlc_circuit_simple(ms_circuit_t *c, volatile float *adc_in) {
 // ======================================================
 // CIRCUITO RLC SIMPLES v2
 // ======================================================
+#if EXEMPLO_RLC_SIMPLE_V2
+static const ms_probe_def_t probes_rlc_simpleV2[] = {
+    { MS_PROBE_CURRENT, 2, 0, 1.0f,      0.5f, PWMDAC_CH(16) },  // corrente no resistor-serie (elemento 2)
+    { MS_PROBE_NODE,    3, 0, 1.0f/3.3f, 0.5f, PWMDAC_CH(17) },  // tensao no capacitor
+};
+#endif
+
 void setup_rlc_circuit_simpleV2(ms_circuit_t *c, volatile float *adc_in) {
     ms_circuit_init(c, 3, 100e-6f); // 3 nós, dt=100us
     // R entre nó1 e terra
@@ -289,6 +200,14 @@ void setup_rlc_circuit_simpleV2(ms_circuit_t *c, volatile float *adc_in) {
 // ======================================================
 // CIRCUITO COM UNICA FONTE EXTERNA
 // ======================================================
+#if EXEMPLO_RL_SIMPLE
+static const ms_probe_def_t probes_rl_simple[] = {
+    { MS_PROBE_NODE,    1, 0, 1.0f/3.3f, 0.5f, PWMDAC_CH(16) },  // tensao da fonte
+    { MS_PROBE_CURRENT, 1, 0, 1.0f,      0.5f, PWMDAC_CH(17) },  // corrente no resistor (elemento 1)
+    { MS_PROBE_NODE,    2, 0, 1.0f/3.3f, 0.5f, PWMDAC_CH(18) },  // tensao no indutor
+};
+#endif
+
 void setup_rl_simple(ms_circuit_t *c, volatile float *adc_in) {
     // Inicializa circuito com 2 nós (mais terra = nó 0)
     ms_circuit_init(c, 2, 100e-6f); // dt = 100 µs
@@ -311,6 +230,14 @@ void setup_rl_simple(ms_circuit_t *c, volatile float *adc_in) {
 // ======================================================
 // BOOST CONVERTER COM DIODO IDEAL E DUAS ENTRADAS EXTERNAS
 // ======================================================
+#if EXEMPLO_BOOST || EXEMPLO_BOOST_MEDIO
+static const ms_probe_def_t probes_boost[] = {
+    { MS_PROBE_NODE,    2, 0, 1.0f/3.3f,       0.0f, PWMDAC_CH(17) },  // tensao na chave
+    { MS_PROBE_NODE,    3, 0, 1.0f/3.3f,       0.0f, PWMDAC_CH(18) },  // tensao de saida
+    { MS_PROBE_CURRENT, 1, 0, 25.0f*1.0f/3.3f, 0.0f, PWMDAC_CH(19) },  // corrente no indutor (elemento 1)
+};
+#endif
+
 int SwCtrl;
 void setup_boost_dual(ms_circuit_t *c,
                       volatile float *adc_in,   // entrada analógica (0–1 normalizado)
@@ -376,9 +303,54 @@ void setup_boost_dual(ms_circuit_t *c,
     // Resistor auxiliar para evitar nó flutuante (4 para gnd)
     ms_add_resistor(c, n_ctl_p, n_gnd, 50.0e3f);
 
+    // As bordas do PWM chegam por gpio_edge com o instante medido: com os
+    // eventos ligados a chave e o diodo comutam dentro do passo, em vez de
+    // só no início do passo seguinte.
+    ms_set_events(c, 1);
 }
 
 
+// ======================================================
+// BOOST MÉDIO (CÉLULA PWM MÉDIA NO LUGAR DE CHAVE E DIODO)
+// ======================================================
+// Mesmo conversor de setup_boost_dual, com a chave e o diodo trocados pela
+// célula PWM média: a razão cíclica vem do PWM medido no GPIO6 e não da
+// borda de cada período, então dt fica em 100 us qualquer que seja a
+// frequência de chaveamento. Com carga leve a célula entra em DCM.
+// Mesma numeração de nós e elementos: usa a tabela probes_boost (no nó 2
+// fica a tensão média na chave).
+#define BOOST_AVG_FSW   20e3f       // frequência do PWM aplicado no GPIO6
+
+void setup_boost_avg(ms_circuit_t *c,
+                     volatile float *adc_in,    // entrada analógica (0–1 normalizado)
+                     volatile float *duty_in)   // razão cíclica (0–1)
+{
+    ms_circuit_init(c, 3, 100e-6f); // dt = 100 µs
+
+    // Nós
+    int n_gnd = 0;    int n_vin = 1;    int n_sw = 2;    int n_vout = 3;
+
+    // Parâmetros dos componentes
+    float L     = 10000e-6f;  // 10000 µH
+    float C     = 470e-6f;    // 470 µF
+    float Rload = 500.0f;     // 500 Ω
+
+    // Fonte de tensão controlada pelo ADC (0–3.3 V)
+    int Vsrc = ms_add_voltage_source(c, n_vin, n_gnd, 0.0f);
+    ms_set_source_external(c, Vsrc, adc_in, 3.3f, 0.000f);
+
+    // Indutor entre Vin e nó da chave
+    ms_add_inductor(c, n_vin, n_sw, L);
+
+    // Célula: a = chave ativa (terra), p = diodo (saída), c = indutor
+    int Sw = ms_add_avg_switch(c, n_gnd, n_vout, n_sw, 0.0f, L, BOOST_AVG_FSW);
+    ms_set_source_external(c, Sw, duty_in, 1.0f, 0.0f);
+
+    // Capacitor de saída e carga resistiva
+    ms_add_capacitor(c, n_vout, n_gnd, C);
+    ms_add_resistor(c, n_vout, n_gnd, Rload);
+}
+
 // ======================================================
 // Atualiza as fontes comutadas conforme I/O 
 // ======================================================
@@ -390,6 +362,14 @@ void update_boost_sources(ms_circuit_t *c, volatile float *adc_in, volatile floa
 // ======================================================
 // CIRCUITO COMBINADO DE FONTE + EXTERNA
 // ======================================================
+#if EXEMPLO_RL_MULTISOURCE
+static const ms_probe_def_t probes_rl_multisource[] = {
+    { MS_PROBE_NODE,    1, 0, 1.0f/3.3f, 0.5f, PWMDAC_CH(16) },  // tensao total aplicada
+    { MS_PROBE_CURRENT, 2, 0, 1.0f,      0.5f, PWMDAC_CH(17) },  // corrente no resistor (elemento 2)
+    { MS_PROBE_NODE,    2, 0, 1.0f/3.3f, 0.5f, PWMDAC_CH(18) },  // tensao no indutor
+};
+#endif
+
 void setup_rl_multiplesource(ms_circuit_t *c, volatile float *adc_in) {
     // Inicializa circuito com 3 nós (mais terra = nó 0)
     ms_circuit_init(c, 3, 100e-6f); // dt = 100 µs
@@ -418,11 +398,25 @@ void setup_rl_multiplesource(ms_circuit_t *c, volatile float *adc_in) {
 // ======================================================
 // CIRCUITO COMBINADO TRIFASICO RL + 3 FONTES + EXTERNA
 // ======================================================
+// Normalização simples 0–1 a partir de ±1.65V e da corrente de pico (1.65V/10Ω)
+#define PROBE_3F_VGAIN  (1.0f/(2.0f*1.650f))
+#define PROBE_3F_IGAIN  (1.0f/(2.0f*(1.650f/10.0f)))
+
+#if EXEMPLO_TRIFASICO_V1
+static const ms_probe_def_t probes_three_phase_rl[] = {
+    { MS_PROBE_NODE,    1, 0, PROBE_3F_VGAIN, 0.5f, PWMDAC_CH(14) },  // fase A
+    { MS_PROBE_NODE,    2, 0, PROBE_3F_VGAIN, 0.5f, PWMDAC_CH(15) },  // fase B
+    { MS_PROBE_NODE,    3, 0, PROBE_3F_VGAIN, 0.5f, PWMDAC_CH(20) },  // fase C
+    { MS_PROBE_CURRENT, 4, 0, PROBE_3F_IGAIN, 0.5f, PWMDAC_CH(21) },  // corrente em Ra (elemento 4)
+};
+#endif
+
 void setup_three_phase_rl(ms_circuit_t *c, volatile float *adc_in)
 {
     // Nós: 3 fases (A=1, B=2, C=3) + fonte externa (D=4) + terra (0)
     // 
     ms_circuit_init(c, 7, 150e-6f); // dt = 100 µs
+    ms_set_inductor_norton(c, 1);   // indutores sem linha auxiliar (3 incógnitas a menos)
 
     // Parâmetros da fonte
     const float V_amp = 1.4242f;   // ~1.0 Vrms
@@ -468,6 +462,15 @@ void setup_three_phase_rl(ms_circuit_t *c, volatile float *adc_in)
 // ======================================================
 // CIRCUITO COMBINADO TRIFASICO RL + 3 FONTES + EXTERNA
 // ======================================================
+#if EXEMPLO_TRIFASICO_V2
+static const ms_probe_def_t probes_three_phase_rl2[] = {
+    { MS_PROBE_NODE,    1, 0, PROBE_3F_VGAIN, 0.5f, PWMDAC_CH(14) },  // fase A
+    { MS_PROBE_NODE,    2, 0, PROBE_3F_VGAIN, 0.5f, PWMDAC_CH(15) },  // fase B
+    { MS_PROBE_NODE,    3, 0, PROBE_3F_VGAIN, 0.5f, PWMDAC_CH(20) },  // fase C
+    { MS_PROBE_CURRENT, 3, 0, PROBE_3F_IGAIN, 0.5f, PWMDAC_CH(21) },  // corrente em Ra (elemento 3)
+};
+#endif
+
 volatile int Va, Vb, Vc; // Para os indices das fontes
 // Parâmetros da fonte
 const float V_amp = 1.4242f;   // ~1.0 Vrms
@@ -477,6 +480,7 @@ void setup_three_phase_rl2(ms_circuit_t *c, volatile float *adc_in)
     // Nós: 3 fases (A=1, B=2, C=3) + fonte externa (D=4) + terra (0)
     // 
     ms_circuit_init(c, 6, 150e-6f); // dt = 150 µs p/ garantir 60.0Hz com boa precisao.
+    ms_set_inductor_norton(c, 1);   // indutores sem linha auxiliar (3 incógnitas a menos)
 
     // Fontes senoidais por fase (tensão fase-terra)
     Va = ms_add_voltage_source(c, 1, 0, 0.0f);
@@ -526,46 +530,35 @@ void update_3f_sources(ms_circuit_t *c, volatile float *adc_in)
     ms_set_source_sine(c, Vc, 0.0f, V_amp_eff, freq, 240.0f/(180.0f/M_PI));   // Fase C
 }
 
-void outputs_three_phase_rl(ms_circuit_t *c)
+// ======================================================
+// SELEÇÃO DO EXEMPLO
+// ======================================================
+// Declaracao principal do circuito
+void setup_circuit(ms_circuit_t *c, volatile float *adc_in, volatile float *io_in)
 {
-    float Va = ms_get_node_voltage(c, 1);
-    float Vb = ms_get_node_voltage(c, 2);
-    float Vc = ms_get_node_voltage(c, 3);
-
-    // Normalização simples 0–1 a partir de ±V_amp
-    const float V_max = 1.650f;
-    uint16_t dA = ms_signal_to_pwm(Va, 1.0f/(2.0f*V_max), 0.5f, PWM_WRAP + 1);
-    uint16_t dB = ms_signal_to_pwm(Vb, 1.0f/(2.0f*V_max), 0.5f, PWM_WRAP + 1);
-    uint16_t dC = ms_signal_to_pwm(Vc, 1.0f/(2.0f*V_max), 0.5f, PWM_WRAP + 1);
-
-    pwm_set_chan_level(pwm_gpio_to_slice_num(14), PWM_CHAN_A, dA);
-    pwm_set_chan_level(pwm_gpio_to_slice_num(15), PWM_CHAN_B, dB);
-    pwm_set_chan_level(pwm_gpio_to_slice_num(20), PWM_CHAN_A, dC);
-
-    #if (EXEMPLO_TRIFASICO_V1 == 1)
-        float iR1 = ms_get_resistor_current(c, 4);      // Para circuito 1
-    #else
-        float iR1 = ms_get_resistor_current(c, 3);      // Para circuito 2
-    #endif 
-    const float R = 10.0f;
-    const float I_max = V_max / R; // corrente pico aproximada
-    //uint16_t duty = ms_signal_to_pwm(iR1, 1.00f, 0.5f, PWM_WRAP);
-    uint16_t duty = ms_signal_to_pwm(iR1, 1.0f/(2.0f*I_max), 0.5f, PWM_WRAP);
-    
-    pwm_set_chan_level(pwm_gpio_to_slice_num(21), PWM_CHAN_B, duty); 
-
-    /***************************************************************
-    // Correntes nas fases (guardadas em user_i[])
-    float Ia = ms_get_element_current(c, c->user_i[0]);
-    float Ib = ms_get_element_current(c, c->user_i[1]);
-    float Ic = ms_get_element_current(c, c->user_i[2]);
-
-    // Se quiser mandar correntes para outros PWMs:
-    const float I_max = V_max / R; // corrente pico aproximada
-    uint16_t diA = ms_signal_to_pwm(Ia, 1.0f/(2.0f*I_max), 0.5f, PWM_WRAP + 1);
-    uint16_t diB = ms_signal_to_pwm(Ib, 1.0f/(2.0f*I_max), 0.5f, PWM_WRAP + 1);
-    uint16_t diC = ms_signal_to_pwm(Ic, 1.0f/(2.0f*I_max), 0.5f, PWM_WRAP + 1);
-
-    pwm_set_chan_level(pwm_gpio_to_slice_num(19), PWM_CHAN_B, diA);
-    ***************************************************************/
-}
\ No newline at end of file
+#if EXEMPLO_RLC_SIMPLE_V1
+    setup_rlc_circuit_simple(c, adc_in);
+    ms_set_probes(c, probes_rlc_simple, MS_COUNT_OF(probes_rlc_simple));
+#elif EXEMPLO_RLC_SIMPLE_V2
+    setup_rlc_circuit_simpleV2(c, adc_in);
+    ms_set_probes(c, probes_rlc_simpleV2, MS_COUNT_OF(probes_rlc_simpleV2));
+#elif EXEMPLO_RL_SIMPLE
+    setup_rl_simple(c, adc_in);
+    ms_set_probes(c, probes_rl_simple, MS_COUNT_OF(probes_rl_simple));
+#elif EXEMPLO_RL_MULTISOURCE
+    setup_rl_multiplesource(c, adc_in);
+    ms_set_probes(c, probes_rl_multisource, MS_COUNT_OF(probes_rl_multisource));
+#elif EXEMPLO_BOOST   
+    setup_boost_dual(c, adc_in, io_in); 
+    ms_set_probes(c, probes_boost, MS_COUNT_OF(probes_boost));
+#elif EXEMPLO_BOOST_MEDIO
+    setup_boost_avg(c, adc_in, &duty0_val);
+    ms_set_probes(c, probes_boost, MS_COUNT_OF(probes_boost));
+#elif EXEMPLO_TRIFASICO_V1
+    setup_three_phase_rl(c, adc_in);
+    ms_set_probes(c, probes_three_phase_rl, MS_COUNT_OF(probes_three_phase_rl));
+#elif EXEMPLO_TRIFASICO_V2
+    setup_three_phase_rl2(c, adc_in);
+    ms_set_probes(c, probes_three_phase_rl2, MS_COUNT_OF(probes_three_phase_rl2));
+#endif
+} 
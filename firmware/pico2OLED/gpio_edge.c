@@ -0,0 +1,123 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Captura de bordas de GPIO6..GPIO9 com carimbo de tempo (ver gpio_edge.h).
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hil_sync.h"
+#include "gpio_edge.h"
+
+static gpio_edge_t       edge_buf[GPIO_EDGE_RING_LEN];
+static hil_ring_t        edge_ring;
+static volatile uint32_t edge_dropped;
+
+// Medida de razão cíclica (só o core0)
+typedef struct {
+    uint32_t rise, fall, last;      // instantes da última subida/descida/borda
+    bool     has_rise, has_fall;
+    float    duty;
+} gpio_duty_t;
+
+static gpio_duty_t edge_duty[GPIO_EDGE_PIN_COUNT];
+
+// ======================================================
+// PRODUTOR (IRQ NO CORE1)
+// ======================================================
+
+static void gpio_edge_push(uint32_t t_us, uint gpio, uint8_t level)
+{
+    gpio_edge_t *e = hil_ring_claim(&edge_ring);
+    if (e == NULL) {
+        edge_dropped++;
+        return;
+    }
+    e->t_us  = t_us;
+    e->input = (uint8_t)(gpio - GPIO_EDGE_PIN_FIRST);
+    e->level = level;
+    hil_ring_publish(&edge_ring);
+}
+
+static void gpio_edge_irq(uint gpio, uint32_t events)
+{
+    uint32_t t_us = time_us_32();
+
+    if (gpio < GPIO_EDGE_PIN_FIRST || gpio >= GPIO_EDGE_PIN_FIRST + GPIO_EDGE_PIN_COUNT)
+        return;
+
+    const uint32_t both = GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL;
+    if ((events & both) == both) {
+        // Pulso mais curto que a latência da IRQ: a ordem sai do nível atual
+        bool high = gpio_get(gpio);
+        gpio_edge_push(t_us, gpio, high ? 0 : 1);
+        gpio_edge_push(t_us, gpio, high ? 1 : 0);
+    } else {
+        gpio_edge_push(t_us, gpio, (events & GPIO_IRQ_EDGE_RISE) ? 1 : 0);
+    }
+}
+
+void gpio_edge_init(void)
+{
+    hil_ring_init(&edge_ring, edge_buf, sizeof edge_buf[0], GPIO_EDGE_RING_LEN);
+    edge_dropped = 0;
+
+    for (uint pin = GPIO_EDGE_PIN_FIRST; pin < GPIO_EDGE_PIN_FIRST + GPIO_EDGE_PIN_COUNT; pin++) {
+        gpio_init(pin);
+        gpio_set_dir(pin, GPIO_IN);
+        gpio_pull_down(pin);
+    }
+    // A IRQ de GPIO é ligada no core que chama: o core0 fica sem ela
+    gpio_set_irq_enabled_with_callback(GPIO_EDGE_PIN_FIRST,
+                                       GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL,
+                                       true, gpio_edge_irq);
+    for (uint pin = GPIO_EDGE_PIN_FIRST + 1; pin < GPIO_EDGE_PIN_FIRST + GPIO_EDGE_PIN_COUNT; pin++)
+        gpio_set_irq_enabled(pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+}
+
+// ======================================================
+// CONSUMIDOR (CORE0)
+// ======================================================
+
+bool gpio_edge_take(uint32_t until_us, gpio_edge_t *e)
+{
+    if (hil_ring_count(&edge_ring) == 0) return false;
+
+    const gpio_edge_t *p = hil_ring_peek(&edge_ring, 0);
+    if ((int32_t)(p->t_us - until_us) >= 0) return false;
+
+    *e = *p;
+    hil_ring_consume(&edge_ring, 1);
+
+    // Período fecha na subida: alto da subida anterior até a descida
+    gpio_duty_t *d = &edge_duty[e->input];
+    if (e->level) {
+        if (d->has_rise && d->has_fall && (int32_t)(d->fall - d->rise) >= 0) {
+            uint32_t period = e->t_us - d->rise;
+            if (period > 0) d->duty = (float)(d->fall - d->rise) / (float)period;
+        }
+        d->rise = e->t_us;
+        d->has_rise = true;
+    } else {
+        d->fall = e->t_us;
+        d->has_fall = true;
+    }
+    d->last = e->t_us;
+    return true;
+}
+
+float gpio_edge_duty(int input, uint32_t now_us)
+{
+    const gpio_duty_t *d = &edge_duty[input];
+    if (!d->has_rise || !d->has_fall || now_us - d->last > GPIO_EDGE_DUTY_TIMEOUT_US)
+        return -1.0f;
+    return d->duty;
+}
+
+uint32_t gpio_edge_dropped(void)
+{
+    return edge_dropped;
+}
@@ -0,0 +1,58 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Captura de bordas das entradas digitais GPIO6..GPIO9 (io0..io3).
+ * Cada borda gera uma IRQ de GPIO no core1, que grava o instante (timer de
+ * 1 us, time_us_32) e o nível novo em um anel SPSC (hil_sync.h). O core0
+ * retira as bordas de cada intervalo simulado e as entrega ao motor com
+ * ms_ext_edge(): com eventos ligados o passo é dividido no instante exato
+ * da borda, então a razão cíclica de um PWM externo não fica quantizada
+ * em dt nem sujeita ao jitter da amostragem uma vez por laço.
+ * O core0 também mede a razão cíclica de cada entrada (período a período,
+ * de subida a subida) para modelos médios (ms_add_avg_switch).
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#ifndef GPIO_EDGE_H
+#define GPIO_EDGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ======================================================
+// CONFIGURAÇÕES
+// ======================================================
+
+#define GPIO_EDGE_PIN_FIRST     6
+#define GPIO_EDGE_PIN_COUNT     4       // GPIO6..GPIO9
+#define GPIO_EDGE_RING_LEN      256     // bordas (potência de 2)
+#define GPIO_EDGE_DUTY_TIMEOUT_US 20000 // sem bordas: razão = nível (PWM < 50 Hz)
+
+typedef struct {
+    uint32_t t_us;              // time_us_32() na entrada da IRQ
+    uint8_t  input;             // 0..GPIO_EDGE_PIN_COUNT-1 (io0..io3)
+    uint8_t  level;             // nível depois da borda
+} gpio_edge_t;
+
+// ======================================================
+// API
+// ======================================================
+
+// core1: configura os pinos (entrada com pull-down) e liga a IRQ neste core
+void gpio_edge_init(void);
+
+// core0: retira a próxima borda anterior a until_us. Retorna false se não
+// há nenhuma (as posteriores ficam para o próximo intervalo).
+bool gpio_edge_take(uint32_t until_us, gpio_edge_t *e);
+
+// Bordas perdidas (anel cheio): o nível acompanhado pelo core0 deve ser
+// relido com gpio_get()
+uint32_t gpio_edge_dropped(void);
+
+// core0: razão cíclica do último período completo da entrada; -1 se ela
+// está parada há mais de GPIO_EDGE_DUTY_TIMEOUT_US (vale o nível)
+float gpio_edge_duty(int input, uint32_t now_us);
+
+#endif // GPIO_EDGE_H
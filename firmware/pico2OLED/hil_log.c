@@ -0,0 +1,148 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Log diferido (ver hil_log.h). A formatação percorre o formato e passa
+ * cada conversão para o snprintf com o tipo correto do argumento.
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "hil_sync.h"
+#include "hil_log.h"
+
+typedef struct {
+    const char   *fmt;                      // formato: identifica o registro
+    int32_t       nargs;
+    hil_log_arg_t arg[HIL_LOG_MAX_ARGS];
+} hil_log_rec_t;
+
+static hil_log_rec_t     log_buf[HIL_LOG_RING_LEN];
+static hil_ring_t        log_ring;
+static volatile uint32_t log_dropped;
+
+void hil_log_init(void)
+{
+    hil_ring_init(&log_ring, log_buf, sizeof log_buf[0], HIL_LOG_RING_LEN);
+    log_dropped = 0;
+}
+
+// ======================================================
+// PRODUTOR (CORE0)
+// ======================================================
+
+void hil_log_write(const char *fmt, const hil_log_arg_t *args, int nargs)
+{
+    hil_log_rec_t *r = hil_ring_claim(&log_ring);
+    if (r == NULL) {
+        log_dropped++;
+        return;
+    }
+    if (nargs > HIL_LOG_MAX_ARGS) nargs = HIL_LOG_MAX_ARGS;
+    r->fmt = fmt;
+    r->nargs = nargs;
+    for (int i = 0; i < nargs; i++)
+        r->arg[i] = args[i];
+    hil_ring_publish(&log_ring);
+}
+
+uint32_t hil_log_dropped(void)
+{
+    return log_dropped;
+}
+
+// ======================================================
+// FORMATAÇÃO (CORE1)
+// ======================================================
+
+int hil_log_format(char *buf, size_t len, const char *fmt,
+                   const hil_log_arg_t *args, int nargs)
+{
+    size_t o = 0;
+    int k = 0;
+
+    if (len == 0) return 0;
+
+    while (*fmt && o + 1 < len) {
+        if (*fmt != '%') {
+            buf[o++] = *fmt++;
+            continue;
+        }
+        if (fmt[1] == '%') {
+            buf[o++] = '%';
+            fmt += 2;
+            continue;
+        }
+
+        // Especificação sem os modificadores de tamanho: "%-08.3" + conversão
+        char spec[16];
+        size_t n = 0;
+        spec[n++] = *fmt++;
+        while (*fmt && strchr("-+ #0123456789.", *fmt) && n < sizeof spec - 3)
+            spec[n++] = *fmt++;
+        while (*fmt == 'l' || *fmt == 'h' || *fmt == 'z')
+            fmt++;
+        char conv = *fmt;
+        if (conv == '\0') break;
+        fmt++;
+
+        hil_log_arg_t a;
+        a.u = 0;
+        if (k < nargs) a = args[k];
+        k++;
+
+        int w;
+        switch (conv) {
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+            spec[n++] = conv; spec[n] = '\0';
+            w = snprintf(&buf[o], len - o, spec, (double)a.f);
+            break;
+        case 'd': case 'i':
+            spec[n++] = 'l'; spec[n++] = conv; spec[n] = '\0';
+            w = snprintf(&buf[o], len - o, spec, (long)a.i);
+            break;
+        case 'u': case 'x': case 'X': case 'o':
+            spec[n++] = 'l'; spec[n++] = conv; spec[n] = '\0';
+            w = snprintf(&buf[o], len - o, spec, (unsigned long)a.u);
+            break;
+        case 'c':
+            spec[n++] = 'c'; spec[n] = '\0';
+            w = snprintf(&buf[o], len - o, spec, (int)a.i);
+            break;
+        case 's':
+            spec[n++] = 's'; spec[n] = '\0';
+            w = snprintf(&buf[o], len - o, spec, a.s ? a.s : "(null)");
+            break;
+        default:                            // conversão desconhecida: copia
+            w = snprintf(&buf[o], len - o, "%%%c", conv);
+            break;
+        }
+        if (w < 0) break;
+        o += (size_t)w;
+        if (o >= len) o = len - 1;
+    }
+    buf[o] = '\0';
+    return (int)o;
+}
+
+void hil_log_task(void)
+{
+    static char line[HIL_LOG_LINE_LEN];
+    static uint32_t dropped_shown;
+
+    uint32_t avail = hil_ring_count(&log_ring);
+    for (uint32_t k = 0; k < avail; k++) {
+        const hil_log_rec_t *r = hil_ring_peek(&log_ring, k);
+        hil_log_format(line, sizeof line, r->fmt, r->arg, r->nargs);
+        fputs(line, stdout);
+    }
+    hil_ring_consume(&log_ring, avail);
+
+    uint32_t d = log_dropped;
+    if (d != dropped_shown) {
+        printf("log: %lu registros perdidos\n", (unsigned long)(d - dropped_shown));
+        dropped_shown = d;
+    }
+}
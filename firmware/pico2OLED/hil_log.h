@@ -0,0 +1,96 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Log diferido: tira o printf do core de tempo real.
+ * No core0, HIL_LOG() grava um registro binário de tamanho fixo (ponteiro
+ * do formato + argumentos de 32 bits) em um anel SPSC (hil_sync.h), sem
+ * formatar nada e sem tocar na USB. O core1 formata e envia os registros
+ * em hil_log_task(). Com o anel cheio o registro é descartado e contado.
+ *
+ * O tipo de cada argumento é resolvido na compilação (_Generic): float e
+ * double viram float, strings guardam só o ponteiro (devem ser constantes)
+ * e inteiros são truncados para 32 bits. Conversões aceitas no formato:
+ * %d %i %u %x %X %o %c %s %f %e %g (com flags, largura, precisão e
+ * modificadores l/h, que são ignorados).
+ *
+ *   HIL_LOG("t:%0.4f passo: %luus\n", circuit.t, step_cost);
+ *   HIL_LOG0("circuito trocado\n");
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#ifndef HIL_LOG_H
+#define HIL_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ======================================================
+// CONFIGURAÇÕES
+// ======================================================
+
+#define HIL_LOG_RING_LEN    64          // registros (potência de 2)
+#define HIL_LOG_MAX_ARGS    8
+#define HIL_LOG_LINE_LEN    160         // linha formatada no core1
+
+typedef union {
+    uint32_t    u;
+    int32_t     i;
+    float       f;
+    const char *s;
+} hil_log_arg_t;
+
+static inline hil_log_arg_t hil_log_arg_f(double v)      { hil_log_arg_t a; a.f = (float)v; return a; }
+static inline hil_log_arg_t hil_log_arg_s(const char *v) { hil_log_arg_t a; a.s = v; return a; }
+static inline hil_log_arg_t hil_log_arg_u(uint32_t v)    { hil_log_arg_t a; a.u = v; return a; }
+
+#define HIL_LOG_ARG(x) _Generic((x),            \
+    float:        hil_log_arg_f,                \
+    double:       hil_log_arg_f,                \
+    char *:       hil_log_arg_s,                \
+    const char *: hil_log_arg_s,                \
+    default:      hil_log_arg_u)(x)
+
+// Aplica HIL_LOG_ARG a cada argumento (1 a HIL_LOG_MAX_ARGS)
+#define HIL_LOG_NARGS(...)  HIL_LOG_NARGS_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define HIL_LOG_NARGS_(_1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+#define HIL_LOG_A1(a)       HIL_LOG_ARG(a)
+#define HIL_LOG_A2(a, ...)  HIL_LOG_ARG(a), HIL_LOG_A1(__VA_ARGS__)
+#define HIL_LOG_A3(a, ...)  HIL_LOG_ARG(a), HIL_LOG_A2(__VA_ARGS__)
+#define HIL_LOG_A4(a, ...)  HIL_LOG_ARG(a), HIL_LOG_A3(__VA_ARGS__)
+#define HIL_LOG_A5(a, ...)  HIL_LOG_ARG(a), HIL_LOG_A4(__VA_ARGS__)
+#define HIL_LOG_A6(a, ...)  HIL_LOG_ARG(a), HIL_LOG_A5(__VA_ARGS__)
+#define HIL_LOG_A7(a, ...)  HIL_LOG_ARG(a), HIL_LOG_A6(__VA_ARGS__)
+#define HIL_LOG_A8(a, ...)  HIL_LOG_ARG(a), HIL_LOG_A7(__VA_ARGS__)
+#define HIL_LOG_CAT(a, b)   a##b
+#define HIL_LOG_MAP(n, ...) HIL_LOG_CAT(HIL_LOG_A, n)(__VA_ARGS__)
+
+// ======================================================
+// API
+// ======================================================
+
+// Qualquer core (produtor único: o core0)
+#define HIL_LOG(fmt, ...) do {                                                  \
+        const hil_log_arg_t hil_log_args_[] = {                                 \
+            HIL_LOG_MAP(HIL_LOG_NARGS(__VA_ARGS__), __VA_ARGS__) };             \
+        hil_log_write((fmt), hil_log_args_,                                     \
+                      sizeof hil_log_args_ / sizeof hil_log_args_[0]);          \
+    } while (0)
+
+#define HIL_LOG0(fmt)       hil_log_write((fmt), NULL, 0)
+
+void hil_log_init(void);
+void hil_log_write(const char *fmt, const hil_log_arg_t *args, int nargs);
+
+// core1: formata e envia os registros pendentes (stdout)
+void hil_log_task(void);
+
+// Registros perdidos (anel cheio)
+uint32_t hil_log_dropped(void);
+
+// Formata um registro em buf (também usado no host). Retorna o tamanho.
+int hil_log_format(char *buf, size_t len, const char *fmt,
+                   const hil_log_arg_t *args, int nargs);
+
+#endif // HIL_LOG_H
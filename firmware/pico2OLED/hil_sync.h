@@ -0,0 +1,153 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Comunicação sem travas entre o core0 (passo de simulação) e o core1
+ * (display, console, telemetria). O core0 nunca espera pelo core1.
+ *
+ * hil_ring_t    : anel de produtor/consumidor único (SPSC) de elementos de
+ *                 tamanho fixo. Só o produtor escreve head e só o
+ *                 consumidor escreve tail; as barreiras garantem que o
+ *                 elemento está completo antes de o índice ser publicado
+ *                 (e lido antes de ser liberado).
+ *
+ * hil_seqlock_t : instantâneo de um bloco de dados. O escritor incrementa
+ *                 a sequência antes e depois da cópia (ímpar = escrevendo);
+ *                 o leitor repete a leitura se a sequência mudou no meio.
+ *                 O escritor nunca espera; só o leitor pode repetir.
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#ifndef HIL_SYNC_H
+#define HIL_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifndef MS_HOST_BUILD
+#include "hardware/sync.h"
+#define hil_fence_acquire()     __mem_fence_acquire()
+#define hil_fence_release()     __mem_fence_release()
+#else
+#define hil_fence_acquire()     __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define hil_fence_release()     __atomic_thread_fence(__ATOMIC_RELEASE)
+#endif
+
+// ======================================================
+// ANEL SPSC
+// ======================================================
+
+typedef struct {
+    volatile uint32_t head;     // escrito só pelo produtor
+    volatile uint32_t tail;     // escrito só pelo consumidor
+    uint32_t mask;              // comprimento - 1 (potência de 2)
+    uint32_t size;              // bytes por elemento
+    uint8_t *buf;
+} hil_ring_t;
+
+// len deve ser potência de 2; buf tem len elementos de size bytes
+static inline void hil_ring_init(hil_ring_t *r, void *buf, uint32_t size, uint32_t len)
+{
+    r->head = r->tail = 0;
+    r->mask = len - 1u;
+    r->size = size;
+    r->buf  = (uint8_t *)buf;
+}
+
+// Produtor: posição livre para escrever, ou NULL se o anel está cheio
+static inline void *hil_ring_claim(hil_ring_t *r)
+{
+    uint32_t h = r->head;
+    if (h - r->tail > r->mask) return NULL;
+    return r->buf + (h & r->mask) * r->size;
+}
+
+// Produtor: publica o elemento obtido em hil_ring_claim()
+static inline void hil_ring_publish(hil_ring_t *r)
+{
+    hil_fence_release();        // elemento visível antes do índice
+    r->head = r->head + 1u;
+}
+
+// Consumidor: elementos disponíveis
+static inline uint32_t hil_ring_count(hil_ring_t *r)
+{
+    uint32_t n = r->head - r->tail;
+    hil_fence_acquire();        // índice lido antes dos elementos
+    return n;
+}
+
+// Consumidor: i-ésimo elemento disponível (i < hil_ring_count())
+static inline void *hil_ring_peek(hil_ring_t *r, uint32_t i)
+{
+    return r->buf + ((r->tail + i) & r->mask) * r->size;
+}
+
+// Consumidor: libera n elementos já lidos
+static inline void hil_ring_consume(hil_ring_t *r, uint32_t n)
+{
+    hil_fence_release();        // leitura concluída antes de liberar
+    r->tail = r->tail + n;
+}
+
+// Consumidor: descarta tudo o que está no anel
+static inline void hil_ring_drop_all(hil_ring_t *r)
+{
+    hil_ring_consume(r, r->head - r->tail);
+}
+
+// ======================================================
+// SEQLOCK (INSTANTÂNEO)
+// ======================================================
+
+typedef struct {
+    volatile uint32_t seq;      // ímpar enquanto o escritor copia
+} hil_seqlock_t;
+
+static inline void hil_seq_write_begin(hil_seqlock_t *l)
+{
+    l->seq = l->seq + 1u;
+    hil_fence_release();
+}
+
+static inline void hil_seq_write_end(hil_seqlock_t *l)
+{
+    hil_fence_release();
+    l->seq = l->seq + 1u;
+}
+
+static inline uint32_t hil_seq_read_begin(const hil_seqlock_t *l)
+{
+    uint32_t s = l->seq;
+    hil_fence_acquire();
+    return s;
+}
+
+// true se a leitura iniciada com s precisa ser repetida
+static inline bool hil_seq_read_retry(const hil_seqlock_t *l, uint32_t s)
+{
+    hil_fence_acquire();
+    return (s & 1u) || l->seq != s;
+}
+
+// Escritor: copia n bytes de src para o bloco publicado dst
+static inline void hil_seq_write(hil_seqlock_t *l, void *dst, const void *src, size_t n)
+{
+    hil_seq_write_begin(l);
+    memcpy(dst, src, n);
+    hil_seq_write_end(l);
+}
+
+// Leitor: copia uma versão consistente do bloco publicado src para dst
+static inline void hil_seq_read(const hil_seqlock_t *l, void *dst, const void *src, size_t n)
+{
+    uint32_t s;
+    do {
+        s = hil_seq_read_begin(l);
+        memcpy(dst, src, n);
+    } while (hil_seq_read_retry(l, s));
+}
+
+#endif // HIL_SYNC_H
@@ -1,28 +1,13 @@
 #include <stdio.h>
 #include "mini_spiceHILv3.h"
 #include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "hardware/xip_cache.h"
+#include "hardware/structs/systick.h"
 
 extern uint64_t micros();
 
-extern int ms_gauss_solve(int n,
-                          float A[MS_MAX_SIZE][MS_MAX_SIZE],
-                          float b[MS_MAX_SIZE],
-                          float x[MS_MAX_SIZE]);
-extern int ms_gauss_seidel(int n,
-                           float A[MS_MAX_SIZE][MS_MAX_SIZE],
-                           float b[MS_MAX_SIZE],
-                           float x[MS_MAX_SIZE],
-                           int max_iter,
-                           float tol);
-extern int ms_lu_decompose(int n,
-                           float A[MS_MAX_SIZE][MS_MAX_SIZE],
-                           float L[MS_MAX_SIZE][MS_MAX_SIZE],
-                           float U[MS_MAX_SIZE][MS_MAX_SIZE]);
-extern void ms_lu_solve(int n,
-                        float L[MS_MAX_SIZE][MS_MAX_SIZE],
-                        float U[MS_MAX_SIZE][MS_MAX_SIZE],
-                        float b[MS_MAX_SIZE],
-                        float x[MS_MAX_SIZE]);
 // ======================================================
 // BENCHMARK DE MATRIZES
 // ======================================================
@@ -30,9 +15,11 @@ void benchmark_matrices() {
     const int sizes[] = {3, 5, 10};
     for (int s = 0; s < 3; s++) {
         int n = sizes[s];
-        float A[MS_MAX_SIZE][MS_MAX_SIZE];
-        float b[MS_MAX_SIZE];
-        float x[MS_MAX_SIZE];
+        float mem[10 * 10];
+        float *A[10];
+        float b[10];
+        float x[10];
+        for (int i = 0; i < n; i++) A[i] = &mem[i * n];
 
         // Preenche matriz com valores sofisticados
         for (int i = 0; i < n; i++) {
@@ -62,9 +49,7 @@ void benchmark_matrices() {
         t1 = micros();
         printf("Gauss-Seidel %dx%d: %llu us\n", n, n, (t1 - t0));
 
-        // LU
-        float L[MS_MAX_SIZE][MS_MAX_SIZE] = {0};
-        float U[MS_MAX_SIZE][MS_MAX_SIZE] = {0};
+        // LU no lugar (fatoração + substituição)
         for (int i = 0; i < n; i++) {
             b[i] = sinf(i + 1);
             for (int j = 0; j < n; j++) {
@@ -74,11 +59,65 @@ void benchmark_matrices() {
         }
 
         t0 = micros();
-        // Por algum motivo a lu_decompose esta bugando o i2c - 
-        // provavelmente estouro de buffer
-        //ms_lu_decompose(n, A, L, U);
-        //ms_lu_solve(n, L, U, b, x);
+        if (ms_lu_factor(n, A) == 0)
+            ms_lu_subst(n, A, b, x);
         t1 = micros();
         printf("LU %dx%d: %llu us\n", n, n, (t1 - t0));
     }
-}
\ No newline at end of file
+}
+
+// ======================================================
+// JITTER DO PASSO
+// ======================================================
+// Custo de cada passo de c em ciclos (SysTick, clock do processador), em
+// dois cenários: cache XIP como o loop o deixa e cache invalidado antes de
+// cada passo, o pior caso de o core1 (display, console) ter expulsado o
+// código do passo. Com o passo na SRAM (MS_RAM_FUNC) os dois ficam iguais;
+// compilado com -DMS_STEP_IN_FLASH a diferença é o custo das faltas.
+// As interrupções ficam desligadas durante cada passo medido. O circuito
+// avança: recarregar depois.
+static void bench_step_stats(ms_circuit_t *c, int steps, bool flush, const char *name)
+{
+    uint32_t min = 0xFFFFFFu, max = 0;
+    uint64_t sum = 0;
+    int n = 0;
+
+    for (int i = 0; i < steps; i++) {
+        if (flush) xip_cache_invalidate_all();
+        uint32_t irq = save_and_disable_interrupts();
+        uint32_t t0 = systick_hw->cvr;
+        int status = ms_circuit_step(c);
+        uint32_t t1 = systick_hw->cvr;
+        restore_interrupts(irq);
+        if (status != 0) {
+            printf("Passo: %s em t=%g\n", ms_system_status_str(status), (double)c->t);
+            break;
+        }
+        uint32_t cyc = (t0 - t1) & 0xFFFFFFu;      // contador decrescente de 24 bits
+        if (cyc < min) min = cyc;
+        if (cyc > max) max = cyc;
+        sum += cyc;
+        n++;
+    }
+    if (n == 0) return;
+
+    float mhz = (float)clock_get_hz(clk_sys) * 1e-6f;
+    printf("Passo %-14s min %6lu  med %6lu  max %6lu ciclos  jitter %6.2f us\n", name,
+           (unsigned long)min, (unsigned long)(sum / n), (unsigned long)max,
+           (double)((float)(max - min) / mhz));
+}
+
+void benchmark_step_jitter(ms_circuit_t *c, int steps)
+{
+    systick_hw->rvr = 0xFFFFFFu;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5;      // habilita, clock do processador, sem IRQ
+
+#if defined(MS_STEP_IN_FLASH)
+    printf("Passo na flash (XIP), sistema %d, %d passos\n", c->system_size, steps);
+#else
+    printf("Passo na SRAM, sistema %d, %d passos\n", c->system_size, steps);
+#endif
+    bench_step_stats(c, steps, false, "cache quente:");
+    bench_step_stats(c, steps, true,  "XIP invalidado:");
+}
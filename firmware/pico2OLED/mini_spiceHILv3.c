@@ -27,17 +27,18 @@
  */
 
 #include "mini_spiceHILv3.h"
+#include "ms_kernels.h"
 
 // ======================================================
 // UTILITÁRIOS INTERNOS
 // ======================================================
 
-static inline float ms_fabs(float x) {
+static inline float MS_RAM_FUNC(ms_fabs)(float x) {
     return x >= 0.0f ? x : -x;
 }
 
 // Avalia valor de fonte independente no tempo t
-static float ms_source_eval(const ms_source_t *s, float t)
+static float MS_RAM_FUNC(ms_source_eval)(const ms_source_t *s, float t)
 {
     switch (s->type) {
     case MS_SRC_DC:
@@ -91,10 +92,7 @@ static float ms_source_eval(const ms_source_t *s, float t)
 // ======================================================
 
 // Gauss direto
-int ms_gauss_solve(int n,
-                          float A[MS_MAX_SIZE][MS_MAX_SIZE],
-                          float b[MS_MAX_SIZE],
-                          float x[MS_MAX_SIZE])
+int MS_RAM_FUNC(ms_gauss_solve)(int n, float *const A[], float b[], float x[])
 {
     int i, j, k;
 
@@ -110,114 +108,214 @@ int ms_gauss_solve(int n,
         }
         b[i] *= inv_pivot;
 
+        // MNA é esparsa: linhas sem termo na coluna i não mudam
         for (k = i + 1; k < n; k++) {
             float factor = A[k][i];
-            if (ms_fabs(factor) < MS_EPSILON) continue;
-            for (j = i; j < n; j++) {
-                A[k][j] -= factor * A[i][j];
-            }
+            if (factor == 0.0f) continue;
+            ms_k_axpy(&A[k][i], &A[i][i], factor, n - i);
             b[k] -= factor * b[i];
         }
     }
 
-    for (i = n - 1; i >= 0; i--) {
-        float sum = b[i];
-        for (j = i + 1; j < n; j++) {
-            sum -= A[i][j] * x[j];
-        }
-        x[i] = sum;
-    }
+    for (i = n - 1; i >= 0; i--)
+        x[i] = b[i] - ms_k_dot(&A[i][i + 1], &x[i + 1], n - i - 1);
 
     return 0;
 }
 
-// Gauss-Seidel iterativo
-int ms_gauss_seidel(int n,
-                           float A[MS_MAX_SIZE][MS_MAX_SIZE],
-                           float b[MS_MAX_SIZE],
-                           float x[MS_MAX_SIZE],
-                           int max_iter,
-                           float tol)
+// Gauss-Seidel com sobre-relaxação: x_i += omega * (x_i(GS) - x_i), na
+// ordem s->order. A contração é a média geométrica das duas últimas
+// razões entre os max |dx| de iterações seguidas, e só é informada se as
+// duas concordam (regime assintótico, autovalor dominante real).
+int MS_RAM_FUNC(ms_sor_solve)(int n, float *const A[], const float b[], float x[], ms_sor_t *s)
 {
-    for (int iter = 0; iter < max_iter; iter++) {
-        float max_err = 0.0f;
+    const float w = s->omega;
+    float d1 = 0.0f;                // max |dx| da iteração anterior
+    float r1 = 0.0f;                // razão da iteração anterior
 
-        for (int i = 0; i < n; i++) {
-            float sigma = 0.0f;
+    s->iters = 0;
+    s->rate  = 0.0f;
+    for (int iter = 1; iter <= s->max_iter; iter++) {
+        float max_err = 0.0f;
 
-            for (int j = 0; j < n; j++) {
-                if (j != i)
-                    sigma += A[i][j] * x[j];
-            }
+        for (int k = 0; k < n; k++) {
+            int i = s->order ? s->order[k] : k;
+            const float *row = A[i];
+            float r = b[i] - ms_k_dot(row, x, i) -
+                      ms_k_dot(&row[i + 1], &x[i + 1], n - i - 1);
+            float x_gs = s->rdiag ? r * s->rdiag[i] : r / row[i];
+            float dx = w * (x_gs - x[i]);
+            x[i] += dx;
 
-            float x_new = (b[i] - sigma) / A[i][i];
-            float err = ms_fabs(x_new - x[i]);
+            float err = ms_fabs(dx);
             if (err > max_err) max_err = err;
-
-            x[i] = x_new;
         }
 
-        if (max_err < tol)
+        s->iters = iter;
+        float r = (d1 > 0.0f) ? max_err / d1 : 0.0f;
+        s->rate = (r1 > 0.0f && ms_fabs(r - r1) < 0.2f * r1) ? sqrtf(r * r1) : 0.0f;
+        r1 = r;
+        d1 = max_err;
+
+        if (max_err < s->tol)
             return 0;
     }
 
-    return 1; // não convergiu
+    return MS_SYS_SOLVER_NOCONV;
+}
+
+// Gauss-Seidel iterativo (SOR com omega = 1, ordem natural)
+int MS_RAM_FUNC(ms_gauss_seidel)(int n, float *const A[], const float b[], float x[],
+                    int max_iter, float tol)
+{
+    ms_sor_t s = { .omega = 1.0f, .max_iter = max_iter, .tol = tol };
+    return ms_sor_solve(n, A, b, x, &s);
 }
 
-// LU decomposition (Doolittle)
-int ms_lu_decompose(int n,
-                           float A[MS_MAX_SIZE][MS_MAX_SIZE],
-                           float L[MS_MAX_SIZE][MS_MAX_SIZE],
-                           float U[MS_MAX_SIZE][MS_MAX_SIZE])
+// LU no lugar (Doolittle, sem pivotamento): L abaixo da diagonal (com
+// diagonal unitária implícita) e U na diagonal e acima, em M
+int MS_RAM_FUNC(ms_lu_factor)(int n, float *const M[])
 {
     for (int i = 0; i < n; i++) {
-        // U
-        for (int k = i; k < n; k++) {
-            float sum = 0.0f;
-            for (int j = 0; j < i; j++)
-                sum += L[i][j] * U[j][k];
-            U[i][k] = A[i][k] - sum;
+        if (ms_fabs(M[i][i]) < MS_EPSILON)
+            return -1;
+        float inv_pivot = 1.0f / M[i][i];
+        for (int k = i + 1; k < n; k++) {
+            float l = M[k][i] * inv_pivot;
+            M[k][i] = l;
+            if (l == 0.0f) continue;
+            ms_k_axpy(&M[k][i + 1], &M[i][i + 1], l, n - i - 1);
         }
+    }
+    return 0;
+}
+
+void MS_RAM_FUNC(ms_lu_subst)(int n, float *const M[], const float b[], float x[])
+{
+    for (int i = 0; i < n; i++)
+        x[i] = b[i] - ms_k_dot(M[i], x, i);
+    for (int i = n - 1; i >= 0; i--)
+        x[i] = (x[i] - ms_k_dot(&M[i][i + 1], &x[i + 1], n - i - 1)) / M[i][i];
+}
 
-        // L
-        for (int k = i; k < n; k++) {
-            if (i == k) {
-                L[i][i] = 1.0f;
+// ======================================================
+// SOLVERS ESPARSOS (CSR)
+// ======================================================
+
+// Cholesky incompleto sem preenchimento, por linhas: para cada (i, j) do
+// triângulo inferior, L[i][j] = (A[i][j] - soma L[i][k] L[j][k]) / L[j][j],
+// com k < j nos padrões das duas linhas (colunas em ordem: intercalação).
+int MS_RAM_FUNC(ms_ic0_factor)(const ms_csr_t *A, float l[])
+{
+    for (int i = 0; i < A->n; i++) {
+        int p0 = A->row[i], pd = A->diag[i];
+        for (int p = p0; p <= pd; p++) {
+            int j = A->col[p];
+            float sum = A->val[p];
+            int q = p0, r = A->row[j], rd = A->diag[j];
+            while (q < p && r < rd) {
+                int cq = A->col[q], cr = A->col[r];
+                if (cq == cr)     sum -= l[q++] * l[r++];
+                else if (cq < cr) q++;
+                else              r++;
+            }
+            if (p < pd) {
+                l[p] = sum / l[rd];
             } else {
-                float sum = 0.0f;
-                for (int j = 0; j < i; j++)
-                    sum += L[k][j] * U[j][i];
-                if (ms_fabs(U[i][i]) < MS_EPSILON)
-                    return -1;
-                L[k][i] = (A[k][i] - sum) / U[i][i];
+                if (!(sum > 0.0f))
+                    return MS_SYS_SOLVER_PIVOT;
+                l[p] = sqrtf(sum);
             }
         }
     }
-
     return 0;
 }
 
-void ms_lu_solve(int n,
-                        float L[MS_MAX_SIZE][MS_MAX_SIZE],
-                        float U[MS_MAX_SIZE][MS_MAX_SIZE],
-                        float b[MS_MAX_SIZE],
-                        float x[MS_MAX_SIZE])
+// y = A x
+static void MS_RAM_FUNC(ms_csr_mul)(const ms_csr_t *A, const float x[], float y[])
 {
-    float y[MS_MAX_SIZE];
-
-    for (int i = 0; i < n; i++) {
+    for (int i = 0; i < A->n; i++) {
         float sum = 0.0f;
-        for (int j = 0; j < i; j++)
-            sum += L[i][j] * y[j];
-        y[i] = b[i] - sum;
+        for (int p = A->row[i]; p < A->row[i + 1]; p++)
+            sum += A->val[p] * x[A->col[p]];
+        y[i] = sum;
     }
+}
+
+// z = M^-1 r: Jacobi ou L L^T z = r (L^T percorrido pelas linhas de L)
+static void MS_RAM_FUNC(ms_cg_precond)(const ms_csr_t *A, const ms_cg_t *s,
+                                       const float r[], float z[])
+{
+    const float *m = s->m;
+    int n = A->n;
 
+    if (!s->ic) {
+        for (int i = 0; i < n; i++) z[i] = r[i] * m[i];
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        float sum = r[i];
+        for (int p = A->row[i]; p < A->diag[i]; p++)
+            sum -= m[p] * z[A->col[p]];
+        z[i] = sum / m[A->diag[i]];
+    }
     for (int i = n - 1; i >= 0; i--) {
-        float sum = 0.0f;
-        for (int j = i + 1; j < n; j++)
-            sum += U[i][j] * x[j];
-        x[i] = (y[i] - sum) / U[i][i];
+        z[i] /= m[A->diag[i]];
+        for (int p = A->row[i]; p < A->diag[i]; p++)
+            z[A->col[p]] -= m[p] * z[i];
+    }
+}
+
+// Gradiente conjugado precondicionado. Custo por iteração: um produto
+// A p (não nulos), uma aplicação de M^-1 (n ou não nulos do triângulo) e
+// alguns vetores de n.
+int MS_RAM_FUNC(ms_cg_solve)(const ms_csr_t *A, const float b[], float x[], ms_cg_t *s)
+{
+    int n = A->n;
+    float *r = s->work, *z = r + n, *p = z + n, *q = p + n;
+
+    ms_csr_mul(A, x, q);
+    float bmax = 0.0f, rmax = 0.0f;
+    for (int i = 0; i < n; i++) {
+        r[i] = b[i] - q[i];
+        bmax = fmaxf(bmax, ms_fabs(b[i]));
+        rmax = fmaxf(rmax, ms_fabs(r[i]));
+    }
+    float tol = s->tol * (bmax > 0.0f ? bmax : 1.0f);
+
+    s->iters = 0;
+    if (rmax <= tol)
+        return 0;
+
+    ms_cg_precond(A, s, r, z);
+    for (int i = 0; i < n; i++) p[i] = z[i];
+    float rz = ms_k_dot(r, z, n);
+
+    for (int iter = 1; iter <= s->max_iter; iter++) {
+        ms_csr_mul(A, p, q);
+        float pq = ms_k_dot(p, q, n);
+        if (!(pq > 0.0f))
+            return MS_SYS_SOLVER_NOCONV;        // A não é definida positiva
+        float alpha = rz / pq;
+
+        rmax = 0.0f;
+        for (int i = 0; i < n; i++) {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * q[i];
+            rmax = fmaxf(rmax, ms_fabs(r[i]));
+        }
+        s->iters = iter;
+        if (rmax <= tol)
+            return 0;
+
+        ms_cg_precond(A, s, r, z);
+        float rz_new = ms_k_dot(r, z, n);
+        float beta = rz_new / rz;
+        rz = rz_new;
+        for (int i = 0; i < n; i++) p[i] = z[i] + beta * p[i];
     }
+
+    return MS_SYS_SOLVER_NOCONV;
 }
 
 // ======================================================
@@ -237,18 +335,108 @@ void ms_circuit_init(ms_circuit_t *c, int nodes, float dt)
     c->system_size = nodes;
     c->solver      = MS_SOLVER_GAUSS;
 
+    c->l_norton     = 0;
+    c->events       = 0;
+    c->event_splits = 0;
+    c->edges        = 0;
+
+    c->probes          = 0;
+    c->probes_resolved = NULL;
+
+    c->lu_valid       = 0;
+    c->lu_dt          = 0.0f;
+    c->factorizations = 0;
+
+    c->sor_omega       = 1.0f;
+    c->sor_auto        = 0;
+    c->sor_redblack    = 0;
+    c->sor_colored     = 0;
+
+    c->cg_precond = MS_CG_JACOBI;
+    c->cg_active  = 0;
+    c->cg_ic      = 0;
+    c->cg_nnz     = 0;
+    c->cg_stamped = 0;
+
+    c->iters       = 0;
+    c->iters_max   = 0;
+    c->iters_total = 0;
+    c->noconv      = 0;
+
+    c->fixed        = 0;
+    c->reduced_size = nodes;
+    c->aux_valid    = 0;
+    c->sys_checked  = 0;
+
+    // Matrizes só depois de ms_circuit_finalize
+    c->mem        = NULL;
+    c->mem_floats = 0;
+    c->mem_n      = 0;
+    c->mem_nr     = 0;
+
     for (int i = 0; i < MS_MAX_SIZE; i++) {
-        c->b[i] = 0.0f;
-        c->x[i] = 0.0f;
-        for (int j = 0; j < MS_MAX_SIZE; j++) {
-            c->A[i][j] = 0.0f;
-        }
+        c->sys_free[i] = (uint8_t)i;
+        c->b[i]  = 0.0f;
+        c->x[i]  = 0.0f;
+        c->A[i]  = NULL;
+        c->LU[i] = NULL;
     }
 }
 
 void ms_set_solver(ms_circuit_t *c, ms_solver_type_t solver)
 {
-    c->solver = solver;
+    c->solver      = solver;
+    c->lu_valid    = 0;
+    c->sys_checked = 0;         // LU ou CSR: refeito na próxima montagem
+}
+
+void ms_set_sor(ms_circuit_t *c, float omega, int redblack)
+{
+    c->sor_auto     = !(omega > 0.0f);
+    c->sor_omega    = c->sor_auto ? 1.0f : fminf(omega, MS_SOR_OMEGA_MAX);
+    c->sor_redblack = redblack ? 1 : 0;
+    c->lu_valid     = 0;            // refaz a ordem de visita
+}
+
+void ms_set_cg(ms_circuit_t *c, ms_cg_precond_t precond)
+{
+    c->cg_precond = precond;
+    c->lu_valid   = 0;              // refaz o precondicionador
+}
+
+void ms_set_inductor_norton(ms_circuit_t *c, int on)
+{
+    c->l_norton        = on ? 1 : 0;
+    c->lu_valid        = 0;
+    c->aux_valid       = 0;
+    c->sys_checked     = 0;
+    c->probes_resolved = NULL;      // a sonda de corrente muda de lugar
+}
+
+void ms_set_events(ms_circuit_t *c, int on)
+{
+    c->events = on ? 1 : 0;
+}
+
+int MS_RAM_FUNC(ms_ext_edge)(ms_circuit_t *c, volatile float *ext, float t_rel, float value)
+{
+    if (!c->events || c->edges >= MS_MAX_EXT_EDGES) {
+        *ext = value;
+        return c->events ? -1 : 0;
+    }
+    if (t_rel < 0.0f)  t_rel = 0.0f;
+    if (t_rel > c->dt) t_rel = c->dt;
+
+    // Mantém a fila ordenada (chegam quase sempre em ordem)
+    int i = c->edges++;
+    while (i > 0 && c->edge[i - 1].t > c->t + t_rel) {
+        c->edge[i] = c->edge[i - 1];
+        i--;
+    }
+    c->edge[i].t     = c->t + t_rel;
+    c->edge[i].ext   = ext;
+    c->edge[i].value = value;
+    return 0;
 }
 
 static int ms_add_element_base(ms_circuit_t *c,
@@ -260,6 +448,12 @@ static int ms_add_element_base(ms_circuit_t *c,
 
     ms_element_t *e = &c->elem[c->elems];
 
+    // Novos elementos podem deslocar os índices auxiliares
+    c->probes_resolved = NULL;
+    c->lu_valid        = 0;
+    c->aux_valid       = 0;
+    c->sys_checked     = 0;
+
     e->type = type;
     e->a    = a;
     e->b    = b;
@@ -293,6 +487,9 @@ static int ms_add_element_base(ms_circuit_t *c,
     e->ron       = 0.0f;
     e->roff      = 0.0f;
     e->vth       = 0.0f;
+    e->on        = 0;
+    e->theta     = MS_ADC_THETA_DEFAULT;
+    e->hist      = 0.0f;
 
     return c->elems++;
 }
@@ -411,6 +608,7 @@ int ms_add_switch(ms_circuit_t *c, int a, int b, int c1, int c2,
         c->elem[idx].ron  = ron;
         c->elem[idx].roff = roff;
         c->elem[idx].vth  = vth;
+        c->elem[idx].on   = (0.0f > vth);      // x[] começa em zero
     }
     return idx;
 }
@@ -434,6 +632,48 @@ int ms_add_diode(ms_circuit_t *c, int anode, int cathode,
 }
 
 
+// Célula PWM média (a = ativo, p = passivo, cn = comum)
+int ms_add_avg_switch(ms_circuit_t *c, int a, int p, int cn,
+                      float duty, float L, float fsw)
+{
+    int idx = ms_add_element_base(c, MS_ELEM_AVGSW, a, p, L);
+    if (idx >= 0) {
+        c->elem[idx].c1     = cn;
+        c->elem[idx].c2     = 0;
+        c->elem[idx].fsw    = fsw;
+        c->elem[idx].src.dc = duty;
+        c->elem[idx].state  = duty;
+    }
+    return idx;
+}
+
+// Chave ADC: condutância gs fixa, controle como ms_add_switch
+int ms_add_adc_switch(ms_circuit_t *c, int a, int b, int c1, int c2,
+                      float gs, float vth)
+{
+    int idx = ms_add_element_base(c, MS_ELEM_ADCSW, a, b, gs);
+    if (idx >= 0) {
+        c->elem[idx].c1  = c1;
+        c->elem[idx].c2  = c2;
+        c->elem[idx].vth = vth;
+    }
+    return idx;
+}
+
+// Diodo ADC ideal (sem queda direta)
+int ms_add_adc_diode(ms_circuit_t *c, int anode, int cathode, float gs)
+{
+    return ms_add_element_base(c, MS_ELEM_ADCD, anode, cathode, gs);
+}
+
+void ms_set_adc_damping(ms_circuit_t *c, int elem_index, float theta)
+{
+    if (elem_index < 0 || elem_index >= c->elems) return;
+    if (theta < 0.5f) theta = 0.5f;
+    if (theta > 1.0f) theta = 1.0f;
+    c->elem[elem_index].theta = theta;
+}
+
 // ======================================================
 // CONFIGURAÇÃO DE FONTES
 // ======================================================
@@ -487,17 +727,61 @@ void ms_set_source_external(ms_circuit_t *c, int elem_index,
 // MONTAGEM DO SISTEMA (MNA)
 // ======================================================
 
-static void ms_assemble_system(ms_circuit_t *c)
+// Elemento usado como controle por uma fonte F ou H
+static int MS_RAM_FUNC(ms_is_current_ctrl)(const ms_circuit_t *c, int idx)
+{
+    for (int i = 0; i < c->elems; i++) {
+        const ms_element_t *e = &c->elem[i];
+        if ((e->type == MS_ELEM_CCCS || e->type == MS_ELEM_CCVS) && e->ctrl_elem == idx)
+            return 1;
+    }
+    return 0;
+}
+
+// Máscara de nós (bit n - 1 para o nó n)
+#if MS_MAX_NODES <= 32
+typedef uint32_t ms_node_mask_t;
+#else
+typedef uint64_t ms_node_mask_t;
+#endif
+#define MS_NODE_BIT(i)  ((ms_node_mask_t)1 << (i))
+
+// Fonte de tensão que pode ser eliminada: um terminal no terra, o outro
+// ainda livre, e a corrente não é controle de F/H
+static int MS_RAM_FUNC(ms_source_fixes_node)(const ms_circuit_t *c, int idx, ms_node_mask_t fixed_mask)
 {
+    const ms_element_t *e = &c->elem[idx];
+    if (e->type != MS_ELEM_V || (e->a != 0) == (e->b != 0)) return 0;
+    int n = e->a ? e->a : e->b;
+    return !(fixed_mask & MS_NODE_BIT(n - 1)) && !ms_is_current_ctrl(c, idx);
+}
+
+// Define as variáveis auxiliares (fontes de tensão e indutores), as fontes
+// eliminadas e o tamanho do sistema. Depende apenas da topologia: o
+// resultado vale até o próximo elemento (ou ms_set_inductor_norton), e a
+// busca O(elems²) por controles de F/H não entra no passo.
+static int MS_RAM_FUNC(ms_assign_aux)(ms_circuit_t *c)
+{
+    if (c->aux_valid)
+        return c->system_size;
+
     int N = c->nodes;
+    ms_node_mask_t fixed_mask = 0;
 
+    c->fixed = 0;
     int M = 0;
     for (int i = 0; i < c->elems; i++) {
         ms_element_t *e = &c->elem[i];
-        if (e->type == MS_ELEM_V ||
-            e->type == MS_ELEM_L ||
+        if (ms_source_fixes_node(c, i, fixed_mask)) {
+            fixed_mask |= MS_NODE_BIT((e->a ? e->a : e->b) - 1);
+            c->fixed_elem[c->fixed++] = (uint8_t)i;
+            e->uses_aux  = 0;
+            e->aux_index = -1;
+        } else if (e->type == MS_ELEM_V ||
+            (e->type == MS_ELEM_L && (!c->l_norton || ms_is_current_ctrl(c, i))) ||
             e->type == MS_ELEM_VCVS ||
-            e->type == MS_ELEM_CCVS) {
+            e->type == MS_ELEM_CCVS ||
+            e->type == MS_ELEM_AVGSW) {
             e->uses_aux  = 1;
             e->aux_index = N + M;
             M++;
@@ -511,6 +795,307 @@ static void ms_assemble_system(ms_circuit_t *c)
     if (size > MS_MAX_SIZE) size = MS_MAX_SIZE;
     c->system_size = size;
 
+    int nr = 0;
+    for (int r = 0; r < size; r++)
+        if (r >= N || !(fixed_mask & MS_NODE_BIT(r))) c->sys_free[nr++] = (uint8_t)r;
+    c->reduced_size = nr;
+    c->aux_valid    = 1;
+    return size;
+}
+
+// Linha de A do nó fixado pela fonte eliminada e, e a tensão imposta nele
+static inline int MS_RAM_FUNC(ms_fixed_node)(const ms_element_t *e)
+{
+    return (e->a ? e->a : e->b) - 1;
+}
+
+static inline float MS_RAM_FUNC(ms_fixed_voltage)(const ms_circuit_t *c, const ms_element_t *e)
+{
+    float v = ms_source_eval(&e->src, c->t);
+    return e->a ? v : -v;
+}
+
+// Só condutâncias entre dois nós, fontes de corrente e fontes de tensão
+// eliminadas: o bloco nodal reduzido é simétrico, com diagonal positiva e
+// dominante (definido positivo se cada parte do circuito chega a um nó
+// fixado ou ao terra). Chamar depois de ms_assign_aux.
+static int MS_RAM_FUNC(ms_spd_topology)(const ms_circuit_t *c)
+{
+    for (int i = 0; i < c->elems; i++) {
+        const ms_element_t *e = &c->elem[i];
+        switch (e->type) {
+        case MS_ELEM_R: case MS_ELEM_C: case MS_ELEM_SWITCH: case MS_ELEM_DIODE:
+        case MS_ELEM_ADCSW: case MS_ELEM_ADCD: case MS_ELEM_I:
+            break;
+        case MS_ELEM_L: case MS_ELEM_V:
+            if (e->uses_aux) return 0;          // linha auxiliar / não eliminada
+            break;
+        default:
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int ms_circuit_is_spd(ms_circuit_t *c)
+{
+    ms_assign_aux(c);
+    return ms_spd_topology(c);
+}
+
+static int MS_RAM_FUNC(ms_uses_cg)(const ms_circuit_t *c)
+{
+    return c->solver == MS_SOLVER_CG && ms_spd_topology(c);
+}
+
+// Vizinhos de cada nó pelos elementos de dois terminais (padrão de A)
+static void MS_RAM_FUNC(ms_cg_adjacency)(const ms_circuit_t *c, ms_node_mask_t adj[])
+{
+    for (int i = 0; i < c->nodes; i++) adj[i] = MS_NODE_BIT(i);
+    for (int i = 0; i < c->elems; i++) {
+        const ms_element_t *e = &c->elem[i];
+        if (e->type == MS_ELEM_I || e->type == MS_ELEM_V || !e->a || !e->b) continue;
+        adj[e->a - 1] |= MS_NODE_BIT(e->b - 1);
+        adj[e->b - 1] |= MS_NODE_BIT(e->a - 1);
+    }
+}
+
+// Não nulos do sistema reduzido (entre nós livres)
+static int MS_RAM_FUNC(ms_cg_nnz)(const ms_circuit_t *c)
+{
+    ms_node_mask_t adj[MS_MAX_NODES], free_mask = 0;
+    ms_cg_adjacency(c, adj);
+    for (int r = 0; r < c->reduced_size; r++) free_mask |= MS_NODE_BIT(c->sys_free[r]);
+
+    int nnz = 0;
+    for (int r = 0; r < c->reduced_size; r++)
+        for (ms_node_mask_t m = adj[c->sys_free[r]] & free_mask; m; m &= m - 1)
+            nnz++;
+    return nnz;
+}
+
+// Floats de memória: A, e LU ou (com CG) valores, precondicionador, 4
+// vetores e os índices do CSR
+static size_t MS_RAM_FUNC(ms_mem_floats)(const ms_circuit_t *c, int cg, int nnz)
+{
+    size_t n  = (size_t)c->system_size;
+    size_t nr = (size_t)c->reduced_size;
+    if (!cg)
+        return n * n + nr * nr;
+    size_t idx_bytes = (2 * nr + 1) * sizeof(uint16_t) + (size_t)nnz;
+    return n * n + 2 * (size_t)nnz + 4 * nr + (idx_bytes + sizeof(float) - 1) / sizeof(float);
+}
+
+// Padrão CSR do sistema reduzido: colunas em ordem (sys_free é crescente)
+static void MS_RAM_FUNC(ms_cg_build_pattern)(ms_circuit_t *c)
+{
+    ms_node_mask_t adj[MS_MAX_NODES];
+    int8_t *col_of = c->cg_rowof;
+    ms_cg_adjacency(c, adj);
+    for (int i = 0; i < c->nodes; i++) col_of[i] = -1;
+    for (int r = 0; r < c->reduced_size; r++) col_of[c->sys_free[r]] = (int8_t)r;
+
+    int p = 0;
+    for (int r = 0; r < c->reduced_size; r++) {
+        int u = c->sys_free[r];
+        c->cg_row[r] = (uint16_t)p;
+        for (int v = 0; v < c->nodes; v++) {
+            if (col_of[v] < 0 || !(adj[u] & MS_NODE_BIT(v))) continue;
+            if (v == u) c->cg_diag[r] = (uint16_t)p;
+            c->cg_col[p++] = (uint8_t)col_of[v];
+        }
+    }
+    c->cg_row[c->reduced_size] = (uint16_t)p;
+}
+
+// Fatia a memória do chamador em A (system_size x system_size) e LU
+// (reduced_size x reduced_size), com linhas contíguas, ou, com o CG num
+// circuito SPD, em A e no CSR do sistema reduzido. Só refaz quando a
+// topologia muda o tamanho ou o solver muda de forma; chamar depois de
+// ms_assign_aux.
+static int MS_RAM_FUNC(ms_bind_matrices)(ms_circuit_t *c)
+{
+    int n  = c->system_size;
+    int nr = c->reduced_size;
+    int cg = ms_uses_cg(c);
+    if (c->mem_n == n && c->mem_nr == nr && c->cg_active == cg)
+        return 0;
+
+    c->mem_n = c->mem_nr = 0;
+    c->cg_active   = 0;
+    c->lu_valid    = 0;
+    c->sys_checked = 0;
+    int nnz = cg ? ms_cg_nnz(c) : 0;
+    if (!c->mem || ms_mem_floats(c, cg, nnz) > c->mem_floats)
+        return MS_SYS_NO_MEMORY;
+
+    float *p = c->mem;
+    for (int i = 0; i < n; i++, p += n) c->A[i] = p;
+    if (cg) {
+        c->cg_nnz  = nnz;
+        c->cg_val  = p;  p += nnz;
+        c->cg_m    = p;  p += nnz;
+        c->cg_work = p;  p += 4 * nr;
+        c->cg_row  = (uint16_t *)p;
+        c->cg_diag = c->cg_row + nr + 1;
+        c->cg_col  = (uint8_t *)(c->cg_diag + nr);
+        ms_cg_build_pattern(c);
+        for (int i = 0; i < nr; i++) c->LU[i] = NULL;
+    } else {
+        for (int i = 0; i < nr; i++, p += nr) c->LU[i] = p;
+    }
+    c->cg_active = cg;
+    c->mem_n  = n;
+    c->mem_nr = nr;
+    return 0;
+}
+
+size_t ms_circuit_mem_size(ms_circuit_t *c)
+{
+    ms_assign_aux(c);
+    int cg = ms_uses_cg(c);
+    return ms_mem_floats(c, cg, cg ? ms_cg_nnz(c) : 0) * sizeof(float);
+}
+
+int ms_circuit_finalize(ms_circuit_t *c, void *mem, size_t size)
+{
+    c->mem        = (float *)mem;
+    c->mem_floats = mem ? size / sizeof(float) : 0;
+    c->mem_n      = 0;
+    c->mem_nr     = 0;
+    c->aux_valid  = 0;
+    ms_assign_aux(c);
+    return ms_bind_matrices(c);
+}
+
+// Razão efetiva da célula PWM média com razão cíclica d. Em DCM a
+// corrente do indutor zera antes do fim do período: com pico d*Ts*|v_ac|/L
+// e média |i_c| do passo anterior, mu = d / (d + d2) = d^2 |v_ac| / (2 L fsw |i_c|).
+// mu <= d indica CCM.
+static float MS_RAM_FUNC(ms_avgsw_ratio)(const ms_circuit_t *c, const ms_element_t *e, float d)
+{
+    int k = e->aux_index;
+    if (e->value <= 0.0f || e->fsw <= 0.0f)
+        return d;
+
+    float va  = (e->a  != 0) ? c->x[e->a  - 1] : 0.0f;
+    float vc  = (e->c1 != 0) ? c->x[e->c1 - 1] : 0.0f;
+    float num = d * d * ms_fabs(va - vc);
+    float den = 2.0f * e->value * e->fsw * ms_fabs(c->x[k]);
+
+    if (num <= d * den) return d;           // CCM
+    if (num >= den)     return 1.0f;        // corrente quase nula
+    return num / den;
+}
+
+// Par de fontes controladas da célula PWM média, com a corrente j que
+// entra na célula pelo terminal comum como variável auxiliar:
+//   v_c - v_p = mu (v_a - v_p);  sai mu*j por a e (1 - mu)*j por p
+// Em DCM mu ~ 1/|j| e a corrente da chave ativa, mu*j, só depende das
+// tensões: com mu do passo anterior explícito o laço indutor-célula
+// (constante de tempo de poucos us) oscila com dt de 100 us. Por isso o
+// estampo em DCM é linearizado em torno da solução anterior (j0, mu0):
+//   i_a = mu0 j0 (constante);  v_c - v_p - mu0 v_ap + r (j - j0) = 0,
+// com r = v_ap0 mu0 / j0, a resistência equivalente do DCM.
+static void MS_RAM_FUNC(ms_stamp_avgsw)(ms_circuit_t *c, ms_element_t *e, float t)
+{
+    int k = e->aux_index;
+    if (k < 0 || k >= c->system_size) return;
+
+    float d = ms_source_eval(&e->src, t);
+    if (d < 0.0f) d = 0.0f;
+    if (d > 1.0f) d = 1.0f;
+    float mu = ms_avgsw_ratio(c, e, d);
+    e->state = mu;
+
+    int a  = (e->a  == 0 ? -1 : e->a  - 1);
+    int p  = (e->b  == 0 ? -1 : e->b  - 1);
+    int cn = (e->c1 == 0 ? -1 : e->c1 - 1);
+
+    if (cn >= 0) { c->A[cn][k] += 1.0f;  c->A[k][cn] += 1.0f; }
+    if (a  >= 0)   c->A[k][a] -= mu;
+    if (p  >= 0)   c->A[k][p] -= 1.0f - mu;
+
+    if (mu <= d || mu >= 1.0f) {
+        // CCM (ou célula presa em a): estampo simétrico
+        if (a >= 0) c->A[a][k] -= mu;
+        if (p >= 0) c->A[p][k] -= 1.0f - mu;
+        return;
+    }
+
+    float j0  = c->x[k];
+    float va  = (a >= 0) ? c->x[a] : 0.0f;
+    float vp  = (p >= 0) ? c->x[p] : 0.0f;
+    float r   = (va - vp) * mu / j0;
+    float ia  = mu * j0;
+
+    if (a >= 0) c->b[a] += ia;
+    if (p >= 0) { c->A[p][k] -= 1.0f; c->b[p] -= ia; }
+    c->A[k][k] += r;
+    c->b[k]    += r * j0;
+}
+
+// Fonte de histórico do elemento ADC para o passo que começa em x (a
+// solução anterior), com i a corrente na chave e v a tensão em x:
+//   fechado (indutor virtual):   J = i + k gs v
+//   aberto (capacitor virtual):  J = -gs v - k i,   k = (1 - theta) / theta
+// A corrente do passo é i' = gs v' + J (de a para b).
+static void MS_RAM_FUNC(ms_stamp_adc)(ms_circuit_t *c, ms_element_t *e, int with_matrix)
+{
+    int a = (e->a == 0 ? -1 : e->a - 1);
+    int b = (e->b == 0 ? -1 : e->b - 1);
+    float g = e->value;
+    float v = (a >= 0 ? c->x[a] : 0.0f) - (b >= 0 ? c->x[b] : 0.0f);
+    float k = (1.0f - e->theta) / e->theta;
+
+    e->hist = e->on ? e->state + k * g * v : -g * v - k * e->state;
+
+    if (a >= 0) c->b[a] -= e->hist;
+    if (b >= 0) c->b[b] += e->hist;
+    if (!with_matrix) return;
+
+    if (a >= 0) c->A[a][a] += g;
+    if (b >= 0) c->A[b][b] += g;
+    if (a >= 0 && b >= 0) {
+        c->A[a][b] -= g;
+        c->A[b][a] -= g;
+    }
+}
+
+// Diodo de Shockley linearizado na tensão anodo-catodo Vd da solução
+// anterior: condutância incremental g e fonte de corrente equivalente Ieq
+static inline void MS_RAM_FUNC(ms_diode_companion)(float Vd, float *g, float *Ieq)
+{
+    // Parâmetros do diodo
+    float Is = 1.0e-7f;      // corrente de saturação
+    float n  = 1.24f;       // fator de idealidade
+    float Vt = 0.026f;    // tensão térmica ~26 mV
+
+    // Limit Vd para evitar overflow e g absurdo
+    float Vd_max = 0.50f;        // limite de segurança
+    float Vd_min = -0.50f;       // limite em reverso
+    float Vd_lim = fminf(fmaxf(Vd, Vd_min), Vd_max);
+
+    // Corrente e condutância incremental
+    if (Vd_lim > 0.0f) {
+        // Região direta: modelo Shockley linearizado
+        float expx = expf(Vd_lim / (n * Vt));
+        float Id   = Is * (expx - 1.0f);
+        *g   = (Is / (n * Vt)) * expx;
+        *Ieq = Id - *g * Vd_lim;
+    } else {
+        // Região reversa: bloqueio de corrente
+        *g   = 1.0e-18f;   // condutância mínima (quase zero)
+        *Ieq = 0.0f;
+    }
+}
+
+static int MS_RAM_FUNC(ms_assemble_system)(ms_circuit_t *c)
+{
+    int size = ms_assign_aux(c);
+    if (ms_bind_matrices(c) != 0)
+        return MS_SYS_NO_MEMORY;
+
     for (int i = 0; i < size; i++) {
         c->b[i] = 0.0f;
         for (int j = 0; j < size; j++) {
@@ -568,8 +1153,17 @@ static void ms_assemble_system(ms_circuit_t *c)
             float Lval = e->value;
             if (Lval <= 0.0f) break;
 
-            float Req  = Lval / dt;
             float Iprev= e->state;
+            if (!e->uses_aux) {
+                // Norton: i = (dt/L) v + i(t - dt), de a para b
+                float Geq = dt / Lval;
+                if (a >= 0) { c->A[a][a] += Geq; c->b[a] -= Iprev; }
+                if (b >= 0) { c->A[b][b] += Geq; c->b[b] += Iprev; }
+                if (a >= 0 && b >= 0) { c->A[a][b] -= Geq; c->A[b][a] -= Geq; }
+                break;
+            }
+
+            float Req  = Lval / dt;
             float Veq  = - Req * Iprev;
 
             int k = e->aux_index;
@@ -678,14 +1272,8 @@ static void ms_assemble_system(ms_circuit_t *c)
         } break;
 
         case MS_ELEM_SWITCH: {
-            int c1 = (e->c1 == 0 ? -1 : e->c1 - 1);
-            int c2 = (e->c2 == 0 ? -1 : e->c2 - 1);
-
-            float vctrl = 0.0f;
-            if (c1 >= 0) vctrl += c->x[c1];
-            if (c2 >= 0) vctrl -= c->x[c2];
-
-            float R = (vctrl > e->vth) ? e->ron : e->roff;
+            // Estado decidido no fim do passo anterior (ms_update_states)
+            float R = e->on ? e->ron : e->roff;
             if (R <= 0.0f) R = e->ron;
             float g = 1.0f / R;
 
@@ -696,45 +1284,24 @@ static void ms_assemble_system(ms_circuit_t *c)
                 c->A[b][a] -= g;
             }
         } break;
+
+        case MS_ELEM_AVGSW:
+            ms_stamp_avgsw(c, e, t);
+            break;
+
+        case MS_ELEM_ADCSW:
+        case MS_ELEM_ADCD:
+            ms_stamp_adc(c, e, 1);
+            break;
 /********************************************/
         case MS_ELEM_DIODE: {
             int a = (e->a == 0 ? -1 : e->a - 1);
             int b = (e->b == 0 ? -1 : e->b - 1);
             if (a < 0 || b < 0) break;
 
-            // Tensões atuais
-            float Va = c->x[a];
-            float Vb = c->x[b];
-            float Vd = Va - Vb; // anodo-catodo
-
-            // Parâmetros do diodo
-            float Is = 1.0e-7f;      // corrente de saturação
-            float n  = 1.24f;       // fator de idealidade
-            float Vt = 0.026f;    // tensão térmica ~26 mV
-
-            // Limit Vd para evitar overflow e g absurdo
-            float Vd_max = 0.50f;        // limite de segurança
-            float Vd_min = -0.50f;       // limite em reverso
-            float Vd_lim = fminf(fmaxf(Vd, Vd_min), Vd_max);
-
-           
-            float Id, g, Ieq;
-            // Corrente e condutância incremental
-            if (Vd_lim > 0.0f) {
-                // Região direta: modelo Shockley linearizado
-                float expx = expf(Vd_lim / (n * Vt));
-                Id   = Is * (expx - 1.0f);
-                g    = (Is / (n * Vt)) * expx;
-                Ieq  = Id - g * Vd_lim;
-            } else {
-                // Região reversa: bloqueio de corrente
-                g    = 1.0e-18f;   // condutância mínima (quase zero)
-                Id   = 0.0f;//-Is;      // corrente de saturação reversa
-                Ieq  = 0.0f;//Id - g * Vd_lim;
-            }
-                        
-            // Equivalente linear
-            //Ieq = Id - g * Vd_lim;
+            // Equivalente linear na tensão anodo-catodo atual
+            float g, Ieq;
+            ms_diode_companion(c->x[a] - c->x[b], &g, &Ieq);
 
             // Estampa condutância
             if (g != 0.0f) {
@@ -826,34 +1393,16 @@ static void ms_assemble_system(ms_circuit_t *c)
     }
     ********************************/
 
+    return 0;
 }
 
 
 // Monta apenas elementos fixos (resistores, fontes DC constantes, fontes controladas estáticas)
 void ms_assemble_static(ms_circuit_t *c)
 {
-    int N = c->nodes;
-    int M = 0;
-
     // Define variáveis auxiliares
-    for (int i = 0; i < c->elems; i++) {
-        ms_element_t *e = &c->elem[i];
-        if (e->type == MS_ELEM_V ||
-            e->type == MS_ELEM_L ||
-            e->type == MS_ELEM_VCVS ||
-            e->type == MS_ELEM_CCVS) {
-            e->uses_aux  = 1;
-            e->aux_index = N + M;
-            M++;
-        } else {
-            e->uses_aux  = 0;
-            e->aux_index = -1;
-        }
-    }
-
-    int size = N + M;
-    if (size > MS_MAX_SIZE) size = MS_MAX_SIZE;
-    c->system_size = size;
+    int size = ms_assign_aux(c);
+    if (ms_bind_matrices(c) != 0) return;
 
     // Zera matriz e vetor
     for (int i = 0; i < size; i++) {
@@ -986,8 +1535,15 @@ void ms_assemble_dynamic(ms_circuit_t *c)
         case MS_ELEM_L: {
             float Lval = e->value;
             if (Lval <= 0.0f) break;
-            float Req  = Lval / dt;
             float Iprev= e->state;
+            if (!e->uses_aux) {
+                float Geq = dt / Lval;
+                if (a >= 0) { c->A[a][a] += Geq; c->b[a] -= Iprev; }
+                if (b >= 0) { c->A[b][b] += Geq; c->b[b] += Iprev; }
+                if (a >= 0 && b >= 0) { c->A[a][b] -= Geq; c->A[b][a] -= Geq; }
+                break;
+            }
+            float Req  = Lval / dt;
             float Veq  = - Req * Iprev;
             int k = e->aux_index;
             if (k < 0 || k >= size) break;
@@ -1009,14 +1565,8 @@ void ms_assemble_dynamic(ms_circuit_t *c)
         } break;
 
         case MS_ELEM_SWITCH: {
-            int c1 = (e->c1 == 0 ? -1 : e->c1 - 1);
-            int c2 = (e->c2 == 0 ? -1 : e->c2 - 1);
-
-            float vctrl = 0.0f;
-            if (c1 >= 0) vctrl += c->x[c1];
-            if (c2 >= 0) vctrl -= c->x[c2];
-
-            float R = (vctrl > e->vth) ? e->ron : e->roff;
+            // Estado decidido no fim do passo anterior (ms_update_states)
+            float R = e->on ? e->ron : e->roff;
             if (R <= 0.0f) R = e->ron;
             float g = 1.0f / R;
 
@@ -1028,14 +1578,49 @@ void ms_assemble_dynamic(ms_circuit_t *c)
             }
         } break;
 
+        case MS_ELEM_AVGSW:
+            ms_stamp_avgsw(c, e, t);
+            break;
+
         default:
             break;
         }
     }
 }
 
-// Atualiza estados de C e L
-static void ms_update_states(ms_circuit_t *c)
+// Tensão de controle de um interruptor para a solução x
+static inline float MS_RAM_FUNC(ms_switch_ctrl)(const ms_element_t *e, const float *x)
+{
+    float v = 0.0f;
+    if (e->c1 != 0) v += x[e->c1 - 1];
+    if (e->c2 != 0) v -= x[e->c2 - 1];
+    return v;
+}
+
+static inline int MS_RAM_FUNC(ms_is_switching)(const ms_element_t *e)
+{
+    return e->type == MS_ELEM_SWITCH || e->type == MS_ELEM_ADCSW ||
+           e->type == MS_ELEM_ADCD;
+}
+
+// Margem de comutação no estado "on", para a solução x e a corrente i da
+// chave: > 0 pede a chave fechada. O diodo ADC aberto olha a tensão e
+// fechado a corrente.
+static inline float MS_RAM_FUNC(ms_switch_margin)(const ms_element_t *e, int on,
+                                     const float *x, float i)
+{
+    if (e->type != MS_ELEM_ADCD)
+        return ms_switch_ctrl(e, x) - e->vth;
+    if (on)
+        return i;
+    float v = 0.0f;
+    if (e->a != 0) v += x[e->a - 1];
+    if (e->b != 0) v -= x[e->b - 1];
+    return v;
+}
+
+// Atualiza estados de C e L e dos interruptores
+static void MS_RAM_FUNC(ms_update_states)(ms_circuit_t *c)
 {
     for (int i = 0; i < c->elems; i++) {
         ms_element_t *e = &c->elem[i];
@@ -1049,32 +1634,123 @@ static void ms_update_states(ms_circuit_t *c)
 
         if (e->type == MS_ELEM_L) {
             int k = e->aux_index;
-            if (k >= 0 && k < c->system_size) {
+            if (!e->uses_aux) {
+                // Norton: reconstrói a corrente com a tensão do passo
+                float v = 0.0f;
+                if (e->a != 0) v += c->x[e->a - 1];
+                if (e->b != 0) v -= c->x[e->b - 1];
+                if (e->value > 0.0f) e->state += c->dt / e->value * v;
+            } else if (k >= 0 && k < c->system_size) {
                 e->state = c->x[k];
             }
         }
+
+        if (e->type == MS_ELEM_ADCSW || e->type == MS_ELEM_ADCD) {
+            float v = 0.0f;
+            if (e->a != 0) v += c->x[e->a - 1];
+            if (e->b != 0) v -= c->x[e->b - 1];
+            e->state = e->value * v + e->hist;
+        }
+
+        if (ms_is_switching(e))
+            e->on = ms_switch_margin(e, e->on, c->x, e->state) > 0.0f;
     }
 }
 
-// ======================================================
-// DIAGNÓSTICO DO SISTEMA
-// ======================================================
-ms_system_status_t ms_check_system(const ms_circuit_t *c)
+// Só o vetor b, para a matriz já fatorada: os elementos que restam num
+// circuito de matriz constante (ver ms_matrix_constant)
+static void MS_RAM_FUNC(ms_assemble_rhs)(ms_circuit_t *c)
 {
-    int n = c->system_size;
+    int size = c->system_size;
+    float dt = c->dt;
+    float t  = c->t;
+
+    for (int i = 0; i < size; i++)
+        c->b[i] = 0.0f;
 
-    // Verifica elementos inválidos
     for (int i = 0; i < c->elems; i++) {
-        const ms_element_t *e = &c->elem[i];
-        if ((e->type == MS_ELEM_R && e->value <= 0.0f) ||
-            (e->type == MS_ELEM_C && e->value <= 0.0f) ||
-            (e->type == MS_ELEM_L && e->value <= 0.0f)) {
-            return MS_SYS_INVALID_ELEMENT;
+        ms_element_t *e = &c->elem[i];
+        int a = (e->a == 0 ? -1 : e->a - 1);
+        int b = (e->b == 0 ? -1 : e->b - 1);
+        int k = e->aux_index;
+
+        switch (e->type) {
+        case MS_ELEM_C: {
+            if (e->value <= 0.0f) break;
+            float Ieq = e->value / dt * e->state;
+            if (a >= 0) c->b[a] += Ieq;
+            if (b >= 0) c->b[b] -= Ieq;
+        } break;
+
+        case MS_ELEM_L:
+            if (e->value <= 0.0f) break;
+            if (!e->uses_aux) {
+                if (a >= 0) c->b[a] -= e->state;
+                if (b >= 0) c->b[b] += e->state;
+                break;
+            }
+            if (k < 0 || k >= size) break;
+            c->b[k] -= e->value / dt * e->state;
+            break;
+
+        case MS_ELEM_I: {
+            float Ival = ms_source_eval(&e->src, t);
+            if (a >= 0) c->b[a] -= Ival;
+            if (b >= 0) c->b[b] += Ival;
+        } break;
+
+        case MS_ELEM_V:
+            if (k < 0 || k >= size) break;
+            c->b[k] += ms_source_eval(&e->src, t);
+            break;
+
+        case MS_ELEM_ADCSW:
+        case MS_ELEM_ADCD:
+            ms_stamp_adc(c, e, 0);
+            break;
+
+        default:
+            break;
         }
     }
+}
 
-    // Verifica nós isolados (linha toda zero em A)
-    for (int i = 0; i < n; i++) {
+// A matriz só depende de dt e da topologia: sem chave e diodo resistivos
+// (o valor muda com o estado) e sem célula PWM média (mu muda a cada passo)
+static int MS_RAM_FUNC(ms_matrix_constant)(const ms_circuit_t *c)
+{
+    for (int i = 0; i < c->elems; i++) {
+        ms_element_type_t t = c->elem[i].type;
+        if (t == MS_ELEM_SWITCH || t == MS_ELEM_DIODE || t == MS_ELEM_AVGSW)
+            return 0;
+    }
+    return 1;
+}
+
+// ======================================================
+// DIAGNÓSTICO DO SISTEMA
+// ======================================================
+ms_system_status_t MS_RAM_FUNC(ms_check_system)(const ms_circuit_t *c)
+{
+    int n = c->system_size;
+
+    if (c->mem_n != n)
+        return MS_SYS_NO_MEMORY;
+
+    // Verifica elementos inválidos
+    for (int i = 0; i < c->elems; i++) {
+        const ms_element_t *e = &c->elem[i];
+        if ((e->type == MS_ELEM_R && e->value <= 0.0f) ||
+            (e->type == MS_ELEM_C && e->value <= 0.0f) ||
+            (e->type == MS_ELEM_L && e->value <= 0.0f)) {
+            return MS_SYS_INVALID_ELEMENT;
+        }
+    }
+
+    // Verifica nós isolados (linha toda zero em A). Os nós fixados por
+    // fontes eliminadas não entram no sistema.
+    for (int r = 0; r < c->reduced_size; r++) {
+        int i = c->sys_free[r];
         int nonzero = 0;
         for (int j = 0; j < n; j++) {
             if (ms_fabs(c->A[i][j]) > MS_EPSILON) {
@@ -1087,8 +1763,13 @@ ms_system_status_t ms_check_system(const ms_circuit_t *c)
         }
     }
 
-    // Verifica pivôs (singularidade simples)
-    for (int i = 0; i < n; i++) {
+    // Verifica pivôs (singularidade simples). Gauss e LU trabalham numa
+    // cópia (o sistema reduzido) e conferem os pivôs na eliminação; em A
+    // as linhas de fontes de tensão têm diagonal nula por construção.
+    if (c->solver != MS_SOLVER_GAUSS_SEIDEL)
+        return MS_SYS_OK;
+    for (int r = 0; r < c->reduced_size; r++) {
+        int i = c->sys_free[r];
         if (ms_fabs(c->A[i][i]) < MS_EPSILON) {
             return MS_SYS_SINGULAR;
         }
@@ -1097,6 +1778,398 @@ ms_system_status_t ms_check_system(const ms_circuit_t *c)
     return MS_SYS_OK;
 }
 
+// ======================================================
+// SOLUÇÃO DO SISTEMA REDUZIDO
+// ======================================================
+
+// ======================================================
+// GAUSS-SEIDEL / SOR NO CIRCUITO
+// ======================================================
+
+// Duas cores por busca em largura no grafo do sistema reduzido (aresta
+// i-j com LU[i][j] ou LU[j][i] não nulo). Em malhas nodais (grade,
+// escada) o grafo é bipartido: cada incógnita só depende das da outra cor
+// e a ordem "vermelhos, depois pretos" deixa a matriz consistentemente
+// ordenada, a hipótese da estimativa de omega. Retorna 0 se houver ciclo
+// ímpar (a ordem fica a natural).
+static int MS_RAM_FUNC(ms_sor_color)(ms_circuit_t *c, int n)
+{
+    uint8_t color[MS_MAX_SIZE];
+    uint8_t queue[MS_MAX_SIZE];
+
+    for (int i = 0; i < n; i++) color[i] = 0xFF;
+    for (int s = 0; s < n; s++) {
+        if (color[s] != 0xFF) continue;
+        int head = 0, tail = 0;
+        color[s] = 0;
+        queue[tail++] = (uint8_t)s;
+        while (head < tail) {
+            int i = queue[head++];
+            for (int j = 0; j < n; j++) {
+                if (j == i || (c->LU[i][j] == 0.0f && c->LU[j][i] == 0.0f)) continue;
+                if (color[j] == 0xFF) {
+                    color[j] = color[i] ^ 1;
+                    queue[tail++] = (uint8_t)j;
+                } else if (color[j] == color[i]) {
+                    return 0;
+                }
+            }
+        }
+    }
+
+    int k = 0;
+    for (int pass = 0; pass < 2; pass++)
+        for (int i = 0; i < n; i++)
+            if (color[i] == pass) c->sor_order[k++] = (uint8_t)i;
+    return 1;
+}
+
+// Matriz nova em c->LU: inversos da diagonal e ordem de visita
+static int MS_RAM_FUNC(ms_sor_prepare)(ms_circuit_t *c, int n)
+{
+    for (int i = 0; i < n; i++) {
+        float d = c->LU[i][i];
+        if (ms_fabs(d) < MS_EPSILON)
+            return MS_SYS_SOLVER_PIVOT;
+        c->sor_rdiag[i] = 1.0f / d;
+    }
+    // omega estimado: a ordem em duas cores é a que a estimativa supõe
+    c->sor_colored = (c->sor_redblack || c->sor_auto) ? ms_sor_color(c, n) : 0;
+    if (!c->sor_colored)
+        for (int i = 0; i < n; i++) c->sor_order[i] = (uint8_t)i;
+    return 0;
+}
+
+// Estimativa de omega (Young): com a matriz consistentemente ordenada, o
+// autovalor dominante lambda do SOR com fator w e o raio espectral mu do
+// Jacobi satisfazem (lambda + w - 1)^2 = lambda w^2 mu^2, e o ótimo é
+// w = 2 / (1 + sqrt(1 - mu^2)). lambda vem da contração observada. Acima
+// do ótimo lambda é complexo, |lambda| = w - 1, e a razão observada
+// oscila: só razões estáveis (ms_sor_solve) e acima de w - 1 entram. A
+// média com o valor anterior filtra o ruído de soluções curtas.
+static void MS_RAM_FUNC(ms_sor_update_omega)(ms_circuit_t *c, float rate)
+{
+    float w = c->sor_omega;
+    if (!(rate > w - 1.0f && rate < 1.0f))
+        return;
+    float lw  = rate + w - 1.0f;
+    float mu2 = lw * lw / (rate * w * w);
+    if (mu2 > 0.9999f) mu2 = 0.9999f;
+
+    float w_opt = 2.0f / (1.0f + sqrtf(1.0f - mu2));
+    if (w_opt > MS_SOR_OMEGA_MAX) w_opt = MS_SOR_OMEGA_MAX;
+    if (w_opt < 1.0f) w_opt = 1.0f;
+    c->sor_omega = 0.5f * (w + w_opt);
+}
+
+static int MS_RAM_FUNC(ms_sor_run)(ms_circuit_t *c, int n, const float b[], float x[])
+{
+    ms_sor_t s = {
+        .omega    = c->sor_omega,
+        .max_iter = MS_SOR_MAX_ITER,
+        .tol      = MS_SOR_TOL,
+        .rdiag    = c->sor_rdiag,
+        .order    = c->sor_order,
+    };
+    int status = ms_sor_solve(n, c->LU, b, x, &s);
+
+    c->iters       += (uint32_t)s.iters;
+    c->iters_total += (uint32_t)s.iters;
+    if (status != 0)
+        c->noconv++;
+    // Poucas iterações: a razão ainda reflete o chute inicial
+    if (c->sor_auto && s.iters >= 4)
+        ms_sor_update_omega(c, s.rate);
+    return 0;       // sem convergência a última iteração é aceita
+}
+
+// ======================================================
+// GRADIENTE CONJUGADO NO CIRCUITO
+// ======================================================
+
+static inline ms_csr_t MS_RAM_FUNC(ms_cg_matrix)(const ms_circuit_t *c)
+{
+    ms_csr_t m = {
+        .n    = c->reduced_size,
+        .row  = c->cg_row,
+        .diag = c->cg_diag,
+        .col  = c->cg_col,
+        .val  = c->cg_val,
+    };
+    return m;
+}
+
+// Matriz nova: valores do CSR (só os não nulos, copiados de A se não
+// vieram de ms_assemble_cg) e precondicionador
+static int MS_RAM_FUNC(ms_cg_prepare)(ms_circuit_t *c, int n)
+{
+    if (!c->cg_stamped) {
+        for (int i = 0; i < n; i++) {
+            const float *row = c->A[c->sys_free[i]];
+            for (int p = c->cg_row[i]; p < c->cg_row[i + 1]; p++)
+                c->cg_val[p] = row[c->sys_free[c->cg_col[p]]];
+        }
+    }
+    c->cg_stamped = 0;
+
+    ms_csr_t m = ms_cg_matrix(c);
+    c->cg_ic = c->cg_precond == MS_CG_IC0 && ms_ic0_factor(&m, c->cg_m) == 0;
+    if (c->cg_ic)
+        return 0;
+    for (int i = 0; i < n; i++) {
+        float d = c->cg_val[c->cg_diag[i]];
+        if (!(d > MS_EPSILON))
+            return MS_SYS_SOLVER_PIVOT;
+        c->cg_m[i] = 1.0f / d;
+    }
+    return 0;
+}
+
+// Montagem direta no CSR. Num circuito SPD com chave ou diodo resistivo
+// a matriz muda a cada passo, e montar A densa (n² zeros) para copiar os
+// não nulos custa mais que o próprio CG. Aqui as entradas entre nós
+// livres vão direto para cg_val; as que tocam um nó fixado ficam em A (a
+// linha da fonte eliminada, para ms_fixed_currents, e a coluna que
+// ms_solve passa para b). Os termos entram na mesma ordem de
+// ms_assemble_system, com o mesmo resultado.
+static inline void MS_RAM_FUNC(ms_cg_add)(ms_circuit_t *c, int i, int j, float v)
+{
+    int r = c->cg_rowof[i], col = c->cg_rowof[j];
+    if (r < 0 || col < 0) {
+        c->A[i][j] += v;
+    } else if (r == col) {
+        c->cg_val[c->cg_diag[r]] += v;
+    } else {
+        int p = c->cg_row[r];
+        while (c->cg_col[p] != col) p++;    // o padrão tem toda aresta
+        c->cg_val[p] += v;
+    }
+}
+
+static inline void MS_RAM_FUNC(ms_cg_stamp_g)(ms_circuit_t *c, int a, int b, float g)
+{
+    if (a >= 0) ms_cg_add(c, a, a, g);
+    if (b >= 0) ms_cg_add(c, b, b, g);
+    if (a >= 0 && b >= 0) {
+        ms_cg_add(c, a, b, -g);
+        ms_cg_add(c, b, a, -g);
+    }
+}
+
+// Só os elementos aceitos por ms_spd_topology, sem linhas auxiliares
+static void MS_RAM_FUNC(ms_assemble_cg)(ms_circuit_t *c)
+{
+    int n = c->system_size;
+    float dt = c->dt;
+
+    for (int i = 0; i < n; i++) c->b[i] = 0.0f;
+    for (int p = 0; p < c->cg_nnz; p++) c->cg_val[p] = 0.0f;
+    for (int f = 0; f < c->fixed; f++) {
+        int k = ms_fixed_node(&c->elem[c->fixed_elem[f]]);
+        for (int j = 0; j < n; j++) c->A[k][j] = 0.0f;
+        for (int r = 0; r < c->reduced_size; r++) c->A[c->sys_free[r]][k] = 0.0f;
+    }
+
+    for (int i = 0; i < c->elems; i++) {
+        ms_element_t *e = &c->elem[i];
+        int a = (e->a == 0 ? -1 : e->a - 1);
+        int b = (e->b == 0 ? -1 : e->b - 1);
+
+        switch (e->type) {
+        case MS_ELEM_R:
+            if (e->value > 0.0f) ms_cg_stamp_g(c, a, b, 1.0f / e->value);
+            break;
+
+        case MS_ELEM_C: {
+            if (e->value <= 0.0f) break;
+            float Gc  = e->value / dt;
+            float Ieq = Gc * e->state;
+            if (a >= 0) c->b[a] += Ieq;
+            if (b >= 0) c->b[b] -= Ieq;
+            ms_cg_stamp_g(c, a, b, Gc);
+        } break;
+
+        case MS_ELEM_L:             // forma de Norton
+            if (e->value <= 0.0f) break;
+            if (a >= 0) c->b[a] -= e->state;
+            if (b >= 0) c->b[b] += e->state;
+            ms_cg_stamp_g(c, a, b, dt / e->value);
+            break;
+
+        case MS_ELEM_I: {
+            float Ival = ms_source_eval(&e->src, c->t);
+            if (a >= 0) c->b[a] -= Ival;
+            if (b >= 0) c->b[b] += Ival;
+        } break;
+
+        case MS_ELEM_SWITCH: {
+            float R = e->on ? e->ron : e->roff;
+            if (R <= 0.0f) R = e->ron;
+            ms_cg_stamp_g(c, a, b, 1.0f / R);
+        } break;
+
+        case MS_ELEM_ADCSW:
+        case MS_ELEM_ADCD:
+            ms_stamp_adc(c, e, 0);
+            ms_cg_stamp_g(c, a, b, e->value);
+            break;
+
+        case MS_ELEM_DIODE: {
+            if (a < 0 || b < 0) break;
+            float g, Ieq;
+            ms_diode_companion(c->x[a] - c->x[b], &g, &Ieq);
+            if (g != 0.0f) ms_cg_stamp_g(c, a, b, g);
+            c->b[a] -= Ieq;
+            c->b[b] += Ieq;
+        } break;
+
+        default:                    // fontes de tensão eliminadas
+            break;
+        }
+    }
+
+    // Gmin de ms_assemble_system
+    for (int i = 0; i < c->nodes - 1; i++)
+        ms_cg_add(c, i, i, 1e-6f);
+
+    c->cg_stamped = 1;
+}
+
+// CG num circuito que comuta, com o padrão já conferido (ms_check_system
+// na primeira montagem completa)
+static inline int MS_RAM_FUNC(ms_cg_direct)(const ms_circuit_t *c)
+{
+    return c->solver == MS_SOLVER_CG && c->cg_active && c->sys_checked &&
+           !ms_matrix_constant(c);
+}
+
+static int MS_RAM_FUNC(ms_cg_run)(ms_circuit_t *c, const float b[], float x[])
+{
+    ms_csr_t m = ms_cg_matrix(c);
+    ms_cg_t s = {
+        .m        = c->cg_m,
+        .ic       = c->cg_ic,
+        .max_iter = MS_CG_MAX_ITER,
+        .tol      = MS_CG_TOL,
+        .work     = c->cg_work,
+    };
+    int status = ms_cg_solve(&m, b, x, &s);
+
+    c->iters       += (uint32_t)s.iters;
+    c->iters_total += (uint32_t)s.iters;
+    if (status != 0)
+        c->noconv++;
+    return 0;       // sem convergência a última iteração é aceita
+}
+
+// Corrente das fontes eliminadas pela linha do nó em A, com x completo
+static void MS_RAM_FUNC(ms_fixed_currents)(ms_circuit_t *c)
+{
+    for (int f = 0; f < c->fixed; f++) {
+        ms_element_t *e = &c->elem[c->fixed_elem[f]];
+        int k = ms_fixed_node(e);
+        float sum = c->b[k] - ms_k_dot(c->A[k], c->x, c->system_size);
+        e->state = e->a ? sum : -sum;
+    }
+}
+
+// Resolve A x = b só nas incógnitas livres (c->sys_free): os nós fixados
+// pelas fontes eliminadas recebem a tensão da fonte em c->t e suas colunas
+// passam para b. Com factored != 0 usa a fatoração LU já em c->LU (só
+// substituição). Depois reconstrói a corrente das fontes eliminadas pela
+// linha do nó em A: i = b_a - A_a.x (a fonte sai de a para o terra).
+static int MS_RAM_FUNC(ms_solve)(ms_circuit_t *c, int factored)
+{
+    int nr = c->reduced_size;
+    float br[MS_MAX_SIZE];
+    float xr[MS_MAX_SIZE];
+
+    for (int f = 0; f < c->fixed; f++) {
+        const ms_element_t *e = &c->elem[c->fixed_elem[f]];
+        c->x[ms_fixed_node(e)] = ms_fixed_voltage(c, e);
+    }
+
+    // Só nós fixados pelas fontes: não há sistema a resolver
+    if (nr <= 0) {
+        ms_fixed_currents(c);
+        return 0;
+    }
+
+    for (int i = 0; i < nr; i++) {
+        const float *row = c->A[c->sys_free[i]];
+        float sum = c->b[c->sys_free[i]];
+        for (int f = 0; f < c->fixed; f++) {
+            int k = ms_fixed_node(&c->elem[c->fixed_elem[f]]);
+            sum -= row[k] * c->x[k];
+        }
+        br[i] = sum;
+        xr[i] = c->x[c->sys_free[i]];       // estimativa inicial (iterativos)
+    }
+
+    // Com CG o sistema reduzido vai para o CSR (ms_cg_prepare). Fora de
+    // circuitos SPD o CG resolve com LU.
+    ms_solver_type_t solver = c->solver;
+    if (solver == MS_SOLVER_CG && !c->cg_active)
+        solver = MS_SOLVER_LU;
+
+    if (!factored && solver != MS_SOLVER_CG) {
+        for (int i = 0; i < nr; i++)
+            for (int j = 0; j < nr; j++)
+                c->LU[i][j] = c->A[c->sys_free[i]][c->sys_free[j]];
+    }
+
+    int status = 0;
+    switch (solver) {
+
+    case MS_SOLVER_GAUSS:
+        status = ms_gauss_solve(nr, c->LU, br, xr);
+        break;
+
+    case MS_SOLVER_GAUSS_SEIDEL:
+        if (!factored) {
+            c->lu_valid = 0;
+            status = ms_sor_prepare(c, nr);
+            if (status != 0) break;
+            c->lu_valid = ms_matrix_constant(c);
+            c->lu_dt    = c->dt;
+        }
+        status = ms_sor_run(c, nr, br, xr);
+        break;
+
+    case MS_SOLVER_LU:
+        if (!factored) {
+            c->lu_valid = 0;
+            status = ms_lu_factor(nr, c->LU);
+            c->factorizations++;
+            if (status != 0) break;
+            c->lu_valid = ms_matrix_constant(c);
+            c->lu_dt    = c->dt;
+        }
+        ms_lu_subst(nr, c->LU, br, xr);
+        break;
+
+    case MS_SOLVER_CG:
+        if (!factored) {
+            c->lu_valid = 0;
+            status = ms_cg_prepare(c, nr);
+            if (status != 0) break;
+            c->lu_valid = ms_matrix_constant(c);
+            c->lu_dt    = c->dt;
+        }
+        status = ms_cg_run(c, br, xr);
+        break;
+    }
+
+    if (status != 0)
+        return status;
+
+    for (int i = 0; i < nr; i++)
+        c->x[c->sys_free[i]] = xr[i];
+
+    ms_fixed_currents(c);
+    return 0;
+}
+
 // ======================================================
 // PASSO DE SIMULAÇÃO
 // ======================================================
@@ -1108,6 +2181,9 @@ int ms_circuit_stepNEW(ms_circuit_t *c)
     // Inserir antes do loop principal de execução e apos o
     // a chamada de construcao do circuito.
 
+    if (ms_bind_matrices(c) != 0)
+        return MS_SYS_NO_MEMORY;
+
     // Agora só atualiza parte dinâmica
     ms_assemble_dynamic(c);
 
@@ -1117,88 +2193,382 @@ int ms_circuit_stepNEW(ms_circuit_t *c)
         return check;
     }
 
-    int n = c->system_size;
-    int status = 0;
+    int status = ms_solve(c, 0);
+    if (status != 0) return status;
 
-    switch (c->solver) {
-    case MS_SOLVER_GAUSS:
-        status = ms_gauss_solve(n, c->A, c->b, c->x);
-        break;
-    case MS_SOLVER_GAUSS_SEIDEL:
-        status = ms_gauss_seidel(n, c->A, c->b, c->x, 50, 1e-5f);
-        break;
-    case MS_SOLVER_LU: {
-        static float L[MS_MAX_SIZE][MS_MAX_SIZE];
-        static float U[MS_MAX_SIZE][MS_MAX_SIZE];
-        status = ms_lu_decompose(n, c->A, L, U);
-        if (status == 0) ms_lu_solve(n, L, U, c->b, c->x);
-        break;
-    }
+    ms_update_states(c);
+    c->t += c->dt;
+    return 0;
+}
+
+// Um passo de c->dt a partir de c->t, sem eventos
+static int MS_RAM_FUNC(ms_step_once)(ms_circuit_t *c)
+{
+    // Fatorar uma vez: matriz constante e já fatorada (ou, no SOR, com
+    // diagonal e ordem prontas; no CG, com CSR e precondicionador) para
+    // este dt, só b
+    int status;
+    if (c->solver != MS_SOLVER_GAUSS && c->lu_valid && c->lu_dt == c->dt) {
+        ms_assemble_rhs(c);
+        status = ms_solve(c, 1);
+    } else if (ms_cg_direct(c)) {
+        ms_assemble_cg(c);
+        status = ms_solve(c, 0);
+    } else {
+        status = ms_assemble_system(c);
+        // Checagem de sistema: nós isolados e elementos inválidos só
+        // dependem do padrão, conferido na primeira montagem depois de
+        // mudar topologia, memória ou solver
+        if (status == 0 && !c->sys_checked) {
+            status = ms_check_system(c);
+            c->sys_checked = (status == MS_SYS_OK);
+        }
+        if (status == 0)
+            status = ms_solve(c, 0);
     }
 
-    if (status != 0) return status;
+    if (status != 0)
+        return status;
 
     ms_update_states(c);
     c->t += c->dt;
     return 0;
 }
 
-int ms_circuit_step(ms_circuit_t *c)
+// ======================================================
+// EVENTOS DENTRO DO PASSO
+// ======================================================
+//
+// Sem eventos um interruptor só muda de estado na fronteira do passo e uma
+// borda de PULSE só é vista no primeiro passo que começa depois dela: com
+// PWM isso quantiza a razão cíclica em múltiplos de dt. Com eventos o passo
+// de t0 a t0 + dt vira uma sequência de sub-passos:
+//   1. o sub-passo termina no próximo ponto de quebra: rampa de fonte PULSE
+//      ou borda de entrada externa (ms_ext_edge, que é aplicada ali);
+//   2. se um interruptor muda de estado num sub-passo que começa numa
+//      quebra, a causa é o salto da fonte: o sub-passo é refeito já com o
+//      estado novo (comutação exatamente na quebra), de novo enquanto uma
+//      comutação provocar outra (chave que abre e diodo que conduz);
+//   3. senão, se o controle de algum interruptor cruzou vth, o instante é
+//      interpolado linearmente entre as duas soluções, o sub-passo é
+//      refeito até ali e o interruptor comuta nesse instante (cruzamento
+//      junto do início é tratado como em 2);
+//   4. repete até t0 + dt (no máximo MS_EVENT_MAX_SPLITS divisões; o resto
+//      do passo é resolvido de uma vez, como sem eventos).
+// Custo: 1 solução sem evento, +1 por quebra de fonte, +1 por comutação na
+// quebra (até MS_EVENT_MAX_SPLITS em cadeia) e +2 por cruzamento interpolado.
+
+#define MS_EVENT_MAX_SPLITS 4
+#define MS_EVENT_MIN_FRAC   0.01f   // sub-passos menores que 1% de dt não são separados
+
+typedef struct {
+    float   t;
+    float   x[MS_MAX_SIZE];
+    float   state[MS_MAX_ELEMS];
+    uint8_t on[MS_MAX_ELEMS];
+} ms_step_save_t;
+
+static void MS_RAM_FUNC(ms_step_save)(const ms_circuit_t *c, ms_step_save_t *s)
 {
-    ms_assemble_system(c);
+    s->t = c->t;
+    for (int i = 0; i < c->system_size; i++) s->x[i] = c->x[i];
+    for (int i = 0; i < c->elems; i++) {
+        s->state[i] = c->elem[i].state;
+        s->on[i]    = (uint8_t)c->elem[i].on;
+    }
+}
 
-    int n = c->system_size;
+static void MS_RAM_FUNC(ms_step_restore)(ms_circuit_t *c, const ms_step_save_t *s)
+{
+    c->t = s->t;
+    for (int i = 0; i < c->system_size; i++) c->x[i] = s->x[i];
+    for (int i = 0; i < c->elems; i++) {
+        c->elem[i].state = s->state[i];
+        c->elem[i].on    = s->on[i];
+    }
+}
+
+static int MS_RAM_FUNC(ms_switches_changed)(const ms_circuit_t *c, const ms_step_save_t *s)
+{
+    for (int i = 0; i < c->elems; i++)
+        if (ms_is_switching(&c->elem[i]) && c->elem[i].on != s->on[i]) return 1;
+    return 0;
+}
+
+// Aplica às entradas as bordas externas anteriores a "until"
+static void MS_RAM_FUNC(ms_apply_edges)(ms_circuit_t *c, float until)
+{
+    int k = 0;
+    while (k < c->edges && c->edge[k].t < until) {
+        *c->edge[k].ext = c->edge[k].value;
+        k++;
+    }
+    if (k == 0) return;
+    for (int i = k; i < c->edges; i++) c->edge[i - k] = c->edge[i];
+    c->edges -= k;
+}
+
+// Primeiro ponto de quebra (início e fim das rampas das fontes PULSE e
+// bordas externas) em (lo, hi); hi se não houver nenhum
+static float MS_RAM_FUNC(ms_next_breakpoint)(const ms_circuit_t *c, float lo, float hi)
+{
+    for (int i = 0; i < c->edges; i++) {
+        if (c->edge[i].t > lo && c->edge[i].t < hi) {
+            hi = c->edge[i].t;      // fila ordenada: a primeira basta
+            break;
+        }
+    }
+
+    for (int i = 0; i < c->elems; i++) {
+        const ms_element_t *e = &c->elem[i];
+        if (e->type != MS_ELEM_V && e->type != MS_ELEM_I) continue;
+
+        const ms_source_t *s = &e->src;
+        if (s->type != MS_SRC_PULSE || s->period <= 0.0f || hi <= s->delay) continue;
+
+        float base = s->delay;
+        if (lo > s->delay)
+            base += floorf((lo - s->delay) / s->period) * s->period;
+
+        const float edge[4] = {
+            0.0f, s->tr, s->tr + s->width, s->tr + s->width + s->tf
+        };
+        for (int k = 0; k < 2; k++, base += s->period) {
+            for (int j = 0; j < 4; j++) {
+                float te = base + edge[j];
+                if (te > lo && te < hi) hi = te;
+            }
+        }
+    }
+    return hi;
+}
+
+// Sub-passo de h com as fontes avaliadas no meio dele: entre quebras as
+// fontes PULSE são constantes, e no meio o arredondamento de t não as
+// joga para o lado errado de uma borda
+static int MS_RAM_FUNC(ms_substep)(ms_circuit_t *c, float h)
+{
+    float t0 = c->t;
+    c->dt = h;
+    c->t  = t0 + 0.5f * h;
+    int status = ms_step_once(c);
+    c->t  = t0 + h;
+    return status;
+}
+
+// Refaz desde s0 o sub-passo de h com os interruptores no estado deixado
+// pela tentativa anterior (c->elem[].on), até o estado ficar consistente
+static int MS_RAM_FUNC(ms_substep_consistent)(ms_circuit_t *c, ms_step_save_t *s0, float h)
+{
     int status = 0;
+    for (int k = 0; k < MS_EVENT_MAX_SPLITS; k++) {
+        for (int i = 0; i < c->elems; i++) s0->on[i] = (uint8_t)c->elem[i].on;
+        ms_step_restore(c, s0);
+        status = ms_substep(c, h);
+        c->event_splits++;
+        if (status != 0 || !ms_switches_changed(c, s0)) break;
+    }
+    return status;
+}
 
-    switch (c->solver) {
+static int MS_RAM_FUNC(ms_step_events)(ms_circuit_t *c)
+{
+    static ms_step_save_t s0;
+    static float alpha_sw[MS_MAX_ELEMS];
 
-    case MS_SOLVER_GAUSS:
-        status = ms_gauss_solve(n, c->A, c->b, c->x);
-        break;
+    const float dt    = c->dt;
+    const float t_end = c->t + dt;
+    const float h_min = MS_EVENT_MIN_FRAC * dt;
+    int status = 0;
 
-    case MS_SOLVER_GAUSS_SEIDEL:
-        status = ms_gauss_seidel(n, c->A, c->b, c->x,
-                                 50,
-                                 1e-5f);
-        break;
+    for (int split = 0; t_end - c->t > 0.5f * h_min; split++) {
+        int   last = split >= MS_EVENT_MAX_SPLITS;
+        float h    = t_end - c->t;
 
-    case MS_SOLVER_LU: {
-        static float L[MS_MAX_SIZE][MS_MAX_SIZE];
-        static float U[MS_MAX_SIZE][MS_MAX_SIZE];
+        // Sub-passo começando numa quebra de fonte: o controle salta ali
+        int at_break = ms_next_breakpoint(c, c->t - h_min, c->t + h_min) < c->t + h_min;
+        ms_apply_edges(c, c->t + h_min);
 
-        for (int i = 0; i < n; i++) {
-            for (int j = 0; j < n; j++) {
-                L[i][j] = 0.0f;
-                U[i][j] = 0.0f;
-            }
+        if (!last) {
+            float te = ms_next_breakpoint(c, c->t + h_min, t_end - h_min);
+            if (te < t_end - h_min) h = te - c->t;
         }
 
-        status = ms_lu_decompose(n, c->A, L, U);
-        if (status == 0)
-            ms_lu_solve(n, L, U, c->b, c->x);
-        break;
+        ms_step_save(c, &s0);
+        status = ms_substep(c, h);
+        if (status != 0 || last) break;
+
+        if (!ms_switches_changed(c, &s0)) continue;
+
+        if (at_break) {
+            // Comutação causada pelo salto da fonte: o estado novo vale
+            // desde o início do sub-passo. Refaz com ele.
+            status = ms_substep_consistent(c, &s0, h);
+            if (status != 0) break;
+            continue;
+        }
+
+        // Cruzamento contínuo: o mais cedo entre os interruptores
+        float alpha = 1.0f;
+        for (int i = 0; i < c->elems; i++) {
+            const ms_element_t *e = &c->elem[i];
+            alpha_sw[i] = 1.0f;
+            if (!ms_is_switching(e) || e->on == s0.on[i]) continue;
+
+            float m0 = ms_switch_margin(e, s0.on[i], s0.x, s0.state[i]);
+            float m1 = ms_switch_margin(e, s0.on[i], c->x, e->state);
+            float a  = (m1 != m0) ? -m0 / (m1 - m0) : 0.0f;
+            if (a < 0.0f) a = 0.0f;
+            if (a > 1.0f) a = 1.0f;
+            alpha_sw[i] = a;
+            if (a < alpha) alpha = a;
+        }
+
+        // Cruzamento junto do início (ex.: diodo que entra em condução logo
+        // após a abertura da chave): o estado novo vale desde o início do
+        // sub-passo, senão o passo inteiro fica com a chave errada
+        if (alpha * h < h_min) {
+            for (int i = 0; i < c->elems; i++)
+                if (alpha_sw[i] * h >= h_min) c->elem[i].on = s0.on[i];
+            status = ms_substep_consistent(c, &s0, h);
+            if (status != 0) break;
+            continue;
+        }
+
+        // Junto do fim: comuta na fronteira, como sem eventos
+        if ((1.0f - alpha) * h < h_min) continue;
+
+        // Refaz o sub-passo até o cruzamento e comuta ali
+        ms_step_restore(c, &s0);
+        status = ms_substep(c, alpha * h);
+        if (status != 0) break;
+
+        for (int i = 0; i < c->elems; i++) {
+            ms_element_t *e = &c->elem[i];
+            if (!ms_is_switching(e)) continue;
+            e->on = (alpha_sw[i] * h <= alpha * h + h_min) ? !s0.on[i] : s0.on[i];
+        }
+        c->event_splits++;
     }
+
+    // Bordas que sobraram (limite de divisões ou junto do fim) valem a
+    // partir do próximo passo
+    ms_apply_edges(c, INFINITY);
+
+    c->dt = dt;
+    if (status == 0) c->t = t_end;      // sem acúmulo de arredondamento dos sub-passos
+    return status;
+}
+
+int MS_RAM_FUNC(ms_circuit_step)(ms_circuit_t *c)
+{
+    int status;
+
+    c->iters = 0;
+    if (c->events) {
+        status = ms_step_events(c);
+    } else {
+        ms_apply_edges(c, INFINITY);
+        status = ms_step_once(c);
     }
+    if (c->iters > c->iters_max)
+        c->iters_max = c->iters;
+    return status;
+}
 
-    if (status != 0)
-        return status;
+// ======================================================
+// PASSO ADAPTATIVO
+// ======================================================
 
-    ms_update_states(c);
-    c->t += c->dt;
+#define MS_ADAPT_SAFETY     0.9f    // margem sobre o passo ótimo
+#define MS_ADAPT_GROW_MAX   2.0f    // crescimento máximo por passo
+#define MS_ADAPT_SHRINK_MIN 0.1f    // redução máxima por rejeição
+#define MS_ADAPT_TRIES      16      // tentativas antes de aceitar dt_min
 
-    // Checagem de sistema
-    ms_system_status_t check = ms_check_system(c);
-    if (check != MS_SYS_OK) {
-        return check;
+void ms_adaptive_init(ms_adaptive_t *ad, float dt_min, float dt_max)
+{
+    ad->dt_min   = dt_min;
+    ad->dt_max   = dt_max;
+    ad->reltol   = 1e-3f;
+    ad->vntol    = 1e-4f;
+    ad->abstol   = 1e-6f;
+    ad->dt       = dt_min;
+    ad->accepted = 0;
+    ad->rejected = 0;
+    ad->history  = 0;
+}
+
+// Maior razão LTE/tolerância entre os elementos com estado. prev[] tem os
+// estados antes do passo; e->state já foi atualizado pelo passo.
+static float ms_adaptive_error(const ms_circuit_t *c, const ms_adaptive_t *ad,
+                               const float *prev, float dt)
+{
+    float worst = 0.0f;
+
+    for (int i = 0; i < c->elems; i++) {
+        const ms_element_t *e = &c->elem[i];
+        if (e->type != MS_ELEM_C && e->type != MS_ELEM_L) continue;
+
+        // x'' ~ (x'_n - x'_{n-1}) / ((dt_n + dt_{n-1}) / 2); LTE = dt^2/2 |x''|
+        float d   = (e->state - prev[i]) / dt;
+        float lte = dt * dt * ms_fabs(d - ad->dprev[i]) / (dt + ad->dt_last);
+
+        float mag = fmaxf(ms_fabs(e->state), ms_fabs(prev[i]));
+        float tol = ad->reltol * mag + (e->type == MS_ELEM_C ? ad->vntol : ad->abstol);
+        float r   = lte / tol;
+        if (r > worst) worst = r;
+    }
+    return worst;
+}
+
+int ms_circuit_step_adaptive(ms_circuit_t *c, ms_adaptive_t *ad)
+{
+    static ms_step_save_t s0;
+
+    float t0 = c->t;
+    ms_step_save(c, &s0);
+
+    for (int tries = 0; ; tries++) {
+        float dt = fminf(fmaxf(ad->dt, ad->dt_min), ad->dt_max);
+        c->dt = dt;
+
+        // Fontes avaliadas no fim do passo (Euler implícito): no passo fixo
+        // elas usam o início, um atraso de 1 dt que com passos longos
+        // apareceria como erro. Os eventos (ms_set_events) não se aplicam:
+        // o controle de passo já encurta dt nas transições.
+        c->t = t0 + dt;
+        int status = ms_step_once(c);
+        c->t = t0 + dt;
+        if (status != 0) return status;
+
+        // Primeiro passo: sem histórico da derivada, aceita com o mínimo
+        float ratio = ad->history ? ms_adaptive_error(c, ad, s0.state, dt) : 0.0f;
+
+        if (ratio > 1.0f && dt > ad->dt_min && tries < MS_ADAPT_TRIES) {
+            // Rejeita: volta ao início do passo e tenta com dt menor
+            ad->rejected++;
+            ad->dt = dt * fmaxf(MS_ADAPT_SHRINK_MIN, MS_ADAPT_SAFETY / sqrtf(ratio));
+            ms_step_restore(c, &s0);
+            continue;
+        }
+
+        ad->accepted++;
+        for (int i = 0; i < c->elems; i++)
+            ad->dprev[i] = (c->elem[i].state - s0.state[i]) / dt;
+        ad->history = 1;
+        ad->dt_last = dt;
+
+        float grow = (ratio > 0.0f) ? MS_ADAPT_SAFETY / sqrtf(ratio) : MS_ADAPT_GROW_MAX;
+        ad->dt = dt * fminf(grow, MS_ADAPT_GROW_MAX);
+        return 0;
     }
-    //return 0;
 }
 
 // ======================================================
 // LEITURA DE RESULTADOS
 // ======================================================
 
-float ms_get_node_voltage(const ms_circuit_t *c, int node)
+float MS_RAM_FUNC(ms_get_node_voltage)(const ms_circuit_t *c, int node)
 {
     if (node == 0) return 0.0f;
     if (node < 0 || node > c->nodes) return 0.0f;
@@ -1209,6 +2579,8 @@ float ms_get_element_current(const ms_circuit_t *c, int elem_index)
 {
     if (elem_index < 0 || elem_index >= c->elems) return 0.0f;
     const ms_element_t *e = &c->elem[elem_index];
+    if (e->type == MS_ELEM_ADCSW || e->type == MS_ELEM_ADCD) return e->state;
+    if ((e->type == MS_ELEM_L || e->type == MS_ELEM_V) && !e->uses_aux) return e->state;
     if (!e->uses_aux) return 0.0f;
     int k = e->aux_index;
     if (k < 0 || k >= c->system_size) return 0.0f;
@@ -1247,6 +2619,130 @@ float ms_get_capacitor_current(const ms_circuit_t *c, int elem_index)
     return e->value * (dV / c->dt);
 }
 
+// ======================================================
+// SONDAS
+// ======================================================
+
+static const float ms_probe_zero = 0.0f;
+
+int ms_add_probe(ms_circuit_t *c, const ms_probe_def_t *def)
+{
+    if (c->probes >= MS_MAX_PROBES)
+        return -1;
+
+    ms_probe_t *p = &c->probe[c->probes];
+    p->def   = *def;
+    p->pos   = &ms_probe_zero;
+    p->neg   = &ms_probe_zero;
+    p->k     = 0.0f;
+    p->value = 0.0f;
+
+    c->probes_resolved = NULL;
+    return c->probes++;
+}
+
+int ms_set_probes(ms_circuit_t *c, const ms_probe_def_t *defs, int n)
+{
+    ms_clear_probes(c);
+    for (int i = 0; i < n; i++) {
+        if (ms_add_probe(c, &defs[i]) < 0)
+            return -1;
+    }
+    return c->probes;
+}
+
+void ms_clear_probes(ms_circuit_t *c)
+{
+    c->probes          = 0;
+    c->probes_resolved = NULL;
+}
+
+static const float *ms_probe_node_ptr(const ms_circuit_t *c, int node)
+{
+    if (node <= 0 || node > c->nodes) return &ms_probe_zero;
+    return &c->x[node - 1];
+}
+
+// Converte as definições em ponteiros diretos para x[] e escalas.
+// Retorna o número de sondas que não puderam ser resolvidas (ficam em zero).
+int ms_probes_resolve(ms_circuit_t *c)
+{
+    int failed = 0;
+
+    ms_assign_aux(c);
+
+    for (int i = 0; i < c->probes; i++) {
+        ms_probe_t *p = &c->probe[i];
+        const ms_probe_def_t *d = &p->def;
+
+        p->pos = &ms_probe_zero;
+        p->neg = &ms_probe_zero;
+        p->k   = 0.0f;
+
+        switch (d->type) {
+        case MS_PROBE_NODE:
+            p->pos = ms_probe_node_ptr(c, d->a);
+            p->k   = 1.0f;
+            break;
+
+        case MS_PROBE_DIFF:
+            p->pos = ms_probe_node_ptr(c, d->a);
+            p->neg = ms_probe_node_ptr(c, d->b);
+            p->k   = 1.0f;
+            break;
+
+        case MS_PROBE_CURRENT: {
+            if (d->a < 0 || d->a >= c->elems) { failed++; break; }
+            const ms_element_t *e = &c->elem[d->a];
+
+            if (e->uses_aux) {
+                p->pos = &c->x[e->aux_index];
+                p->k   = 1.0f;
+            } else if (e->type == MS_ELEM_ADCSW || e->type == MS_ELEM_ADCD ||
+                       e->type == MS_ELEM_L || e->type == MS_ELEM_V) {
+                p->pos = &e->state;
+                p->k   = 1.0f;
+            } else if (e->type == MS_ELEM_R && e->value > 0.0f) {
+                // I = (Va - Vb) / R
+                p->pos = ms_probe_node_ptr(c, e->a);
+                p->neg = ms_probe_node_ptr(c, e->b);
+                p->k   = 1.0f / e->value;
+            } else {
+                failed++;
+            }
+        } break;
+
+        default:
+            failed++;
+            break;
+        }
+    }
+
+    c->probes_resolved = c;
+    return failed;
+}
+
+// Avalia todas as sondas e envia os níveis para a saída.
+void MS_RAM_FUNC(ms_probes_eval)(ms_circuit_t *c, ms_probe_out_fn out, uint16_t pwm_max)
+{
+    // Resolve sob demanda (topologia alterada ou circuito copiado)
+    if (c->probes_resolved != c)
+        ms_probes_resolve(c);
+
+    for (int i = 0; i < c->probes; i++) {
+        ms_probe_t *p = &c->probe[i];
+        float v = (*p->pos - *p->neg) * p->k;
+        p->value = v;
+
+        if (p->def.channel < 0 || out == NULL) continue;
+
+        float n = v * p->def.gain + p->def.offset;
+        if (n < 0.0f) n = 0.0f;
+        if (n > 1.0f) n = 1.0f;
+        out(p->def.channel, (uint16_t)(n * (float)pwm_max));
+    }
+}
+
 // ======================================================
 // LISTAGEM DE COMPONENTES
 // ======================================================
@@ -1265,6 +2761,9 @@ const char* ms_element_type_str(ms_element_type_t type)
     case MS_ELEM_CCCS:  return "Fonte CCCS";
     case MS_ELEM_SWITCH:return "Chave";
     case MS_ELEM_DIODE: return "Diodo";
+    case MS_ELEM_AVGSW: return "Celula PWM media";
+    case MS_ELEM_ADCSW: return "Chave ADC";
+    case MS_ELEM_ADCD:  return "Diodo ADC";
     default:            return "Desconhecido";
     }
 }
@@ -1287,7 +2786,7 @@ void ms_list_elements(const ms_circuit_t *c)
 // INTERFACE PWM/DAC
 // ======================================================
 
-uint16_t ms_value_to_pwm_duty(float normalized_value, uint16_t pwm_max)
+uint16_t MS_RAM_FUNC(ms_value_to_pwm_duty)(float normalized_value, uint16_t pwm_max)
 {
     float v = normalized_value;
     if (v < 0.0f) v = 0.0f;
@@ -1295,7 +2794,7 @@ uint16_t ms_value_to_pwm_duty(float normalized_value, uint16_t pwm_max)
     return (uint16_t)(v * (float)pwm_max);
 }
 
-uint16_t ms_signal_to_pwm(float value,
+uint16_t MS_RAM_FUNC(ms_signal_to_pwm)(float value,
                           float gain, float offset,
                           uint16_t pwm_max)
 {
@@ -1303,7 +2802,7 @@ uint16_t ms_signal_to_pwm(float value,
     return ms_value_to_pwm_duty(v, pwm_max);
 }
 
-uint16_t ms_signal_to_dac(float value,
+uint16_t MS_RAM_FUNC(ms_signal_to_dac)(float value,
                           float gain, float offset,
                           uint16_t dac_max)
 {
@@ -1324,6 +2823,8 @@ const char* ms_system_status_str(int status)
         return "Erro: elemento inválido (R, C ou L <= 0)";
     case MS_SYS_ISOLATED_NODE:
         return "Erro: nó isolado detectado";
+    case MS_SYS_NO_MEMORY:
+        return "Erro: sem memória para as matrizes (ms_circuit_finalize)";
     case MS_SYS_SOLVER_PIVOT:
         return "Erro: falha no solver (pivô nulo)";
     case MS_SYS_SOLVER_NOCONV:
@@ -4,7 +4,9 @@
 #include <stdint.h>
 #include <math.h>
 #include <stdio.h>
-#include "pico/stdlib.h"
+#ifndef MS_HOST_BUILD
+#include "pico/stdlib.h"      // ferramentas do host (tools/) compilam sem o SDK
+#endif
 
 // ======================================================
 // CONFIGURAÇÕES DIVERSAS
@@ -21,11 +23,43 @@
 // CONFIGURAÇÕES GERAIS
 // ======================================================
 
+// Os limites podem ser aumentados na compilação das ferramentas do host
+// (malhas grandes em tools/solver_bench.c): índices de incógnita são de
+// 8 bits e os nós fixados por fontes ficam numa máscara de até 64 bits.
+#ifndef MS_MAX_NODES
 #define MS_MAX_NODES   16
+#endif
+#ifndef MS_MAX_ELEMS
 #define MS_MAX_ELEMS   64
+#endif
 #define MS_MAX_SIZE   (MS_MAX_NODES + MS_MAX_ELEMS)
 
+_Static_assert(MS_MAX_NODES <= 64 && MS_MAX_SIZE <= 256, "limites do motor");
+
+#define MS_MAX_PROBES   8
+#define MS_MAX_EXT_EDGES 8      // bordas de entrada externa por passo
+
 #define MS_EPSILON     1e-9f
+
+#define MS_COUNT_OF(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+// Posicionamento na memória (RP2350). Por padrão o código roda da flash
+// (XIP): cada falta no cache custa dezenas de ciclos e o custo do passo
+// passa a depender do que o core1 executou antes. As funções do passo
+// (montagem, solvers, fontes, eventos, sondas) vão para a SRAM com
+// MS_RAM_FUNC; MS_SCRATCH_DATA põe dados no banco scratch Y, o da pilha do
+// core0 (a do core1 fica no scratch X). Compilar com -DMS_STEP_IN_FLASH
+// deixa tudo na flash, para comparar (benchmark_step_jitter).
+#if !defined(MS_HOST_BUILD) && !defined(MS_STEP_IN_FLASH)
+#define MS_RAM_FUNC(f)      __not_in_flash_func(f)
+#define MS_SCRATCH_DATA     __scratch_y("ms_data")
+#else
+#define MS_RAM_FUNC(f)      f
+#define MS_SCRATCH_DATA
+#endif
+
+// Memória das matrizes para o maior sistema possível (ms_circuit_finalize)
+#define MS_MEM_MAX_BYTES (2u * MS_MAX_SIZE * MS_MAX_SIZE * sizeof(float))
 // ======================================================
 // DIAGNÓSTICO DO SISTEMA
 // ======================================================
@@ -35,6 +69,7 @@ typedef enum {
     MS_SYS_SINGULAR = -2,      // Matriz singular
     MS_SYS_INVALID_ELEMENT = -3,// Elemento inválido
     MS_SYS_ISOLATED_NODE = -4, // Nó isolado
+    MS_SYS_NO_MEMORY = -5,     // Matrizes sem memória (ms_circuit_finalize)
 
     MS_SYS_SOLVER_PIVOT = -1,  // Falha no solver (pivô nulo)
     MS_SYS_SOLVER_NOCONV = 1   // Solver iterativo não convergiu
@@ -60,7 +95,12 @@ typedef enum {
     // Interruptor controlado por tensão
     MS_ELEM_SWITCH,
     // Diodo
-    MS_ELEM_DIODE
+    MS_ELEM_DIODE,
+    // Célula PWM média (chave + diodo pela razão cíclica)
+    MS_ELEM_AVGSW,
+    // Chave e diodo de admitância constante (modelo ADC)
+    MS_ELEM_ADCSW,
+    MS_ELEM_ADCD
 } ms_element_type_t;
 
 // ======================================================
@@ -81,9 +121,15 @@ typedef enum {
 typedef enum {
     MS_SOLVER_GAUSS,
     MS_SOLVER_GAUSS_SEIDEL,
-    MS_SOLVER_LU
+    MS_SOLVER_LU,
+    MS_SOLVER_CG                // gradiente conjugado (circuitos SPD, ms_set_cg)
 } ms_solver_type_t;
 
+typedef enum {
+    MS_CG_JACOBI,               // inverso da diagonal
+    MS_CG_IC0                   // Cholesky incompleto sem preenchimento
+} ms_cg_precond_t;
+
 // ======================================================
 // ESTRUTURA DE FONTE
 // ======================================================
@@ -145,14 +191,61 @@ typedef struct {
 
     // Interruptor
     float ron, roff, vth;
+    int on;            // estado atual (1 = fechado), atualizado ao fim do passo
     // Diodo
     float vf;
+    // Célula PWM média: terminais a (ativo), b (passivo) e c1 (comum);
+    // razão cíclica em src, L em value (0 = só CCM), state = razão efetiva
+    float fsw;         // frequência de chaveamento (DCM)
+    // Chave/diodo ADC: condutância em value, state = corrente na chave
+    float theta;       // amortecimento (1 = Euler implícito, 0.5 = trapézio)
+    float hist;        // fonte de histórico do passo em curso
 } ms_element_t;
 
+// ======================================================
+// SONDAS (MAPEAMENTO GRANDEZA -> SAÍDA)
+// ======================================================
+
+typedef enum {
+    MS_PROBE_NODE,      // tensão do nó a (em relação ao terra)
+    MS_PROBE_DIFF,      // tensão diferencial entre nós a e b
+    MS_PROBE_CURRENT    // corrente de ramo do elemento de índice a
+} ms_probe_type_t;
+
+// Definição declarativa (uma linha da tabela de sondas)
+typedef struct {
+    ms_probe_type_t type;
+    int a, b;          // nós (NODE/DIFF) ou índice do elemento em a (CURRENT)
+    float gain;        // normalização: saída = valor * gain + offset (0..1)
+    float offset;
+    int channel;       // canal de saída (< 0 => só leitura, sem saída)
+} ms_probe_def_t;
+
+// Sonda resolvida: value = (*pos - *neg) * k
+typedef struct {
+    ms_probe_def_t def;
+
+    const float *pos;  // aponta direto para x[] (ou para zero, se terra)
+    const float *neg;
+    float k;           // escala física (1 ou 1/R)
+
+    float value;       // último valor físico avaliado
+} ms_probe_t;
+
+// Saída de um canal (ex.: pwmdac_set)
+typedef void (*ms_probe_out_fn)(int channel, uint16_t level);
+
 // ======================================================
 // ESTRUTURA DO CIRCUITO
 // ======================================================
 
+// Mudança de uma entrada externa dentro do passo (ms_ext_edge)
+typedef struct {
+    float t;                    // instante absoluto da mudança
+    volatile float *ext;        // entrada (a mesma apontada pelas fontes EXT)
+    float value;                // valor a partir de t
+} ms_ext_edge_t;
+
 typedef struct {
     int nodes;      // número de nós do circuito
     int elems;      // número de elementos (resistores, fontes, diodos, etc.)
@@ -161,13 +254,79 @@ typedef struct {
 
     ms_element_t elem[MS_MAX_ELEMS];        // vetor com todos os elementos do circuito
 
-    float A[MS_MAX_SIZE][MS_MAX_SIZE];      // matriz do sistema (condutâncias + vínculos)
+    float *A[MS_MAX_SIZE];      // linhas da matriz do sistema (condutâncias + vínculos)
     float b[MS_MAX_SIZE];       // vetor independente (correntes/fontes)
     float x[MS_MAX_SIZE];       // solução (tensões nos nós e correntes auxiliares)
 
     int system_size;            // tamanho efetivo do sistema linear
 
     ms_solver_type_t solver;    // tipo de solver usado (ex: Gauss, LU, etc.)
+
+    // Fontes de tensão entre um nó e o terra (fora as que controlam F/H)
+    // não têm linha auxiliar: a tensão do nó é imposta e sai do sistema
+    // junto com a linha do nó. A corrente da fonte fica em e->state.
+    uint8_t fixed_elem[MS_MAX_NODES];   // fontes eliminadas
+    int     fixed;
+    uint8_t sys_free[MS_MAX_SIZE];      // incógnita do sistema reduzido -> linha de A
+    int     reduced_size;
+    int     aux_valid;                  // ms_assign_aux em dia com a topologia
+    int     sys_checked;                // ms_check_system já passou neste padrão
+
+    // Sistema reduzido, resolvido no lugar: com LU guarda a fatoração (L
+    // abaixo da diagonal, U na diagonal e acima), reaproveitada enquanto a
+    // matriz for constante (sem S, D e A) e dt não mudar.
+    float *LU[MS_MAX_SIZE];
+
+    // Memória do chamador para A (system_size²) e LU (reduced_size²),
+    // fatiada em linhas contíguas (ms_circuit_finalize)
+    float *mem;
+    size_t mem_floats;
+    int mem_n, mem_nr;          // tamanhos atualmente fatiados
+    int   lu_valid;
+    float lu_dt;
+    uint32_t factorizations;    // fatorações feitas (estatística)
+
+    // Gauss-Seidel/SOR (ms_set_sor). rdiag e order valem para a matriz em
+    // LU, que é reaproveitada como na LU enquanto for constante.
+    float    sor_omega;             // fator em uso (estimado com sor_auto)
+    int      sor_auto;
+    int      sor_redblack;
+    int      sor_colored;           // sor_order está em vermelho-preto
+    float    sor_rdiag[MS_MAX_SIZE];    // 1/diagonal do sistema reduzido
+    uint8_t  sor_order[MS_MAX_SIZE];    // ordem de visita das incógnitas
+
+    // Gradiente conjugado (ms_set_cg) sobre o sistema reduzido em CSR, com
+    // o padrão tirado da topologia. Fica na memória do chamador no lugar de
+    // LU (ms_circuit_finalize); fora de circuitos SPD resolve com LU.
+    int       cg_precond;           // ms_cg_precond_t pedido
+    int       cg_active;            // circuito SPD: CSR ligado à memória
+    int       cg_ic;                // IC0 fatorado (0: Jacobi, também na falha)
+    int       cg_nnz;
+    uint16_t *cg_row;               // início de cada linha (reduced_size + 1)
+    uint16_t *cg_diag;              // posição da diagonal em cada linha
+    uint8_t  *cg_col;               // coluna de cada valor
+    float    *cg_val;               // valores do sistema reduzido
+    float    *cg_m;                 // precondicionador (mesmo padrão)
+    float    *cg_work;              // r, z, p, q
+    int8_t    cg_rowof[MS_MAX_NODES];   // linha do CSR de cada nó (-1: fixado)
+    int       cg_stamped;           // cg_val montado direto (ms_assemble_cg)
+
+    // Solvers iterativos (SOR e CG)
+    uint32_t iters;             // iterações no último passo (todas as soluções)
+    uint32_t iters_max;         // maior iters (estatística)
+    uint32_t iters_total;       // iterações desde o início (estatística)
+    uint32_t noconv;            // soluções que pararam no limite de iterações
+
+    int l_norton;               // indutores sem variável auxiliar (ms_set_inductor_norton)
+    int events;                 // localiza comutações dentro do passo (ms_set_events)
+    uint32_t event_splits;      // sub-passos criados por eventos (estatística)
+
+    ms_ext_edge_t edge[MS_MAX_EXT_EDGES];   // bordas do próximo passo, em ordem
+    int edges;
+
+    ms_probe_t probe[MS_MAX_PROBES];    // tabela de sondas (saídas)
+    int probes;                         // número de sondas
+    const void *probes_resolved;        // circuito para o qual foram resolvidas
 } ms_circuit_t;
 
 // ======================================================
@@ -175,8 +334,68 @@ typedef struct {
 // ======================================================
 
 void ms_circuit_init(ms_circuit_t *c, int nodes, float dt);
+
+// Liga as matrizes à memória mem (size bytes, do chamador) depois de
+// montado o circuito: só o tamanho real do sistema é usado. Retorna 0 ou
+// MS_SYS_NO_MEMORY se não couber. ms_circuit_init desfaz a ligação, e uma
+// cópia da estrutura continua apontando para a memória da original:
+// chamar de novo depois de carregar ou copiar. Mudanças de topologia
+// depois disso refazem as fatias, se couberem.
+int ms_circuit_finalize(ms_circuit_t *c, void *mem, size_t size);
+
+// Bytes de memória que o circuito montado precisa
+size_t ms_circuit_mem_size(ms_circuit_t *c);
 void ms_set_solver(ms_circuit_t *c, ms_solver_type_t solver);
 
+// Gauss-Seidel com sobre-relaxação (solver MS_SOLVER_GAUSS_SEIDEL):
+// omega fixo em (0, 2) (1 = Gauss-Seidel simples) ou 0 para estimar a
+// partir da convergência observada em cada solução. Com redblack != 0 as
+// incógnitas são visitadas em duas cores (vermelho-preto) quando o grafo
+// do sistema permite (malhas nodais: grade, escada); senão fica a ordem
+// natural (sor_colored = 0). Com omega estimado as duas cores são sempre
+// tentadas: a estimativa supõe a matriz consistentemente ordenada, e na
+// ordem natural ela passa do ótimo em malhas que já convergem rápido.
+// Cada solução parte da solução do passo anterior. Não convergir em
+// MS_SOR_MAX_ITER não interrompe o passo: a última iteração é aceita (e
+// continua no passo seguinte) e conta em noconv.
+#define MS_SOR_MAX_ITER     50
+#define MS_SOR_TOL          1e-5f
+#define MS_SOR_OMEGA_MAX    1.95f
+void ms_set_sor(ms_circuit_t *c, float omega, int redblack);
+
+// Gradiente conjugado precondicionado (solver MS_SOLVER_CG). Só vale para
+// circuitos em que o sistema reduzido é simétrico e definido positivo
+// (ms_circuit_is_spd); nos outros o solver CG resolve com LU. O custo por
+// iteração segue os não nulos, não n². Parte da solução anterior e, como
+// no SOR, não convergir em MS_CG_MAX_ITER não interrompe o passo. Se o
+// IC0 falhar (pivô não positivo) o precondicionador fica o de Jacobi.
+#define MS_CG_MAX_ITER      50
+#define MS_CG_TOL           1e-6f       // max |r| relativo a max |b|
+void ms_set_cg(ms_circuit_t *c, ms_cg_precond_t precond);
+
+// Sistema reduzido simétrico e definido positivo: só condutâncias entre
+// dois nós (R, C, L na forma de Norton, chaves, diodos, elementos ADC),
+// fontes de corrente e fontes de tensão eliminadas (ligadas ao terra).
+int ms_circuit_is_spd(ms_circuit_t *c);
+
+// Eventos dentro do passo: com on != 0 cada passo é dividido nos fins de
+// rampa das fontes PULSE, nas bordas de entradas externas (ms_ext_edge) e
+// no instante (interpolado) em que o controle de um interruptor cruza vth.
+// Cada divisão custa uma solução a mais.
+void ms_set_events(ms_circuit_t *c, int on);
+
+// Indutores na forma de Norton: condutância dt/L em paralelo com a fonte
+// de histórico i(t - dt), sem a linha auxiliar da corrente. Mesma
+// discretização (Euler implícito), sistema menor; a corrente fica em
+// e->state. Indutores que controlam fontes F/H mantêm a linha auxiliar.
+void ms_set_inductor_norton(ms_circuit_t *c, int on);
+
+// Agenda para o próximo passo a mudança da entrada *ext para value em
+// t_rel segundos (0..dt) após o início do passo. Com eventos a mudança
+// vira um ponto de quebra; sem eventos (ou com a fila cheia, retorno -1)
+// vale desde o início do passo, como uma leitura amostrada.
+int ms_ext_edge(ms_circuit_t *c, volatile float *ext, float t_rel, float value);
+
 // Elementos básicos
 int ms_add_resistor   (ms_circuit_t *c, int a, int b, float R);
 int ms_add_capacitor  (ms_circuit_t *c, int a, int b, float C);
@@ -200,6 +419,42 @@ int ms_add_switch(ms_circuit_t *c, int a, int b, int c1, int c2,
 int ms_add_diode(ms_circuit_t *c, int anode, int cathode,
                  float ron, float roff, float vf);                  
 
+// Célula PWM média (modelo de Vorpérian): entre os terminais a (chave
+// ativa), p (diodo) e cn (comum, onde fica o indutor) impõe
+//   v_cp = mu * v_ap   e   i_a = mu * i_c
+// com mu = d em CCM. Com L (o indutor ligado a cn) e fsw > 0 detecta o
+// DCM pela corrente do passo anterior: mu = d^2 |v_ac| / (2 L fsw |i_c|)
+// quando maior que d. A razão d vem da fonte do elemento (DC aqui, ou
+// ms_set_source_external para ADC/GPIO), limitada a 0..1. Substitui chave
+// e diodo de um conversor: dt pode ser maior que o período de chaveamento.
+int ms_add_avg_switch(ms_circuit_t *c, int a, int p, int cn,
+                      float duty, float L, float fsw);
+
+// Chave e diodo de circuito discreto associado (ADC, Pejović): fechado é
+// um indutor e aberto um capacitor virtuais, discretizados com a mesma
+// condutância gs. A comutação troca só a fonte de histórico em paralelo:
+// a matriz não muda e, com o solver LU, é fatorada uma vez só (enquanto
+// dt for o mesmo). Em regime a chave é ideal; a escolha de gs só pesa
+// no transitório da comutação (Ls = theta*dt/gs, Cs = theta*dt*gs);
+// um bom ponto de partida é gs ~ sqrt(C/L) do conversor.
+// A chave comuta pelo controle (v(c1) - v(c2) > vth), o diodo pela
+// própria tensão (aberto) ou corrente (fechado).
+// Não serve quando o transitório da comutação importa (sobretensão no
+// nó da chave, snubber, dv/dt, perdas de comutação): o L/C virtual oscila
+// a cada comutação. No boost do tools/adcsw_bench.c a sobretensão no nó
+// da chave é ~1.5 V (0.03 V com a chave resistiva) e ~9.8 V com theta
+// 0.5. Nesses casos use a chave resistiva com eventos (ms_set_events).
+#define MS_ADC_THETA_DEFAULT  1.0f
+
+int ms_add_adc_switch(ms_circuit_t *c, int a, int b, int c1, int c2,
+                      float gs, float vth);
+int ms_add_adc_diode(ms_circuit_t *c, int anode, int cathode, float gs);
+
+// Amortecimento da discretização do elemento ADC: theta de 0.5
+// (trapézio, sem perdas mas com oscilação numérica a cada comutação) a 1
+// (Euler implícito, amortece tudo e perde a energia dos elementos virtuais)
+void ms_set_adc_damping(ms_circuit_t *c, int elem_index, float theta);
+
 // Configuração de fontes
 void ms_set_source_sine(ms_circuit_t *c, int elem_index,
                         float offset, float amplitude,
@@ -217,6 +472,89 @@ void ms_set_source_external(ms_circuit_t *c, int elem_index,
 // Simulação
 int   ms_circuit_step(ms_circuit_t *c);
 
+// ======================================================
+// PASSO ADAPTATIVO (HOST / PRÉ-SIMULAÇÃO)
+// ======================================================
+// Controle do passo pelo erro local de truncamento (LTE) do Euler
+// implícito nos modelos de C e L: LTE ~ dt^2/2 * |x''|, com x'' estimado
+// pela diferença dividida dos estados. Passo com LTE acima da tolerância
+// é rejeitado (x, estados e t restaurados) e repetido com dt menor.
+
+typedef struct {
+    float dt_min, dt_max;       // limites do passo
+    float reltol;               // tolerância relativa do LTE
+    float vntol;                // tolerância absoluta em capacitores (V)
+    float abstol;               // tolerância absoluta em indutores (A)
+
+    float dt;                   // passo da próxima tentativa
+    uint32_t accepted, rejected;
+
+    int   history;              // dprev[] e dt_last válidos
+    float dt_last;              // passo aceito anterior
+    float dprev[MS_MAX_ELEMS];  // derivada do estado no passo aceito anterior
+} ms_adaptive_t;
+
+void ms_adaptive_init(ms_adaptive_t *ad, float dt_min, float dt_max);
+
+// Avança um passo aceito (c->dt fica com o passo usado). Retorna o mesmo
+// status de ms_circuit_step().
+int  ms_circuit_step_adaptive(ms_circuit_t *c, ms_adaptive_t *ad);
+
+// Solvers densos sobre linhas por ponteiro (A[i] aponta a linha i, com
+// pelo menos n colunas). Gauss e LU trabalham no lugar e sem pivotamento.
+int  ms_gauss_solve(int n, float *const A[], float b[], float x[]);
+int  ms_gauss_seidel(int n, float *const A[], const float b[], float x[],
+                     int max_iter, float tol);
+
+// SOR: x entra com a estimativa inicial e sai com a última iteração.
+// Retorna 0 ou MS_SYS_SOLVER_NOCONV (max_iter sem atingir tol).
+typedef struct {
+    float omega;                // fator de relaxação, 0 < omega < 2
+    int   max_iter;
+    float tol;                  // critério de parada: max |dx|
+    const float   *rdiag;       // 1/A[i][i] (NULL: divide a cada visita)
+    const uint8_t *order;       // ordem de visita (NULL: natural)
+    // Saída
+    int   iters;                // iterações feitas
+    float rate;                 // contração de max |dx| por iteração (0: poucas iterações)
+} ms_sor_t;
+int  ms_sor_solve(int n, float *const A[], const float b[], float x[], ms_sor_t *s);
+
+// Matriz esparsa em linhas (CSR), colunas em ordem crescente em cada
+// linha e diagonal presente
+typedef struct {
+    int n;
+    const uint16_t *row;        // n + 1 posições
+    const uint16_t *diag;       // posição de (i, i)
+    const uint8_t  *col;
+    const float    *val;
+} ms_csr_t;
+
+// Cholesky incompleto no padrão de A: L (triângulo inferior com a
+// diagonal) em l, nas mesmas posições de val. Retorna
+// MS_SYS_SOLVER_PIVOT se um pivô não for positivo.
+int  ms_ic0_factor(const ms_csr_t *A, float l[]);
+
+// Gradiente conjugado em A simétrica definida positiva. x entra com a
+// estimativa inicial. m: 1/diagonal (Jacobi, n valores) ou o fator do
+// ms_ic0_factor (ic != 0). work: 4 n floats. Retorna 0 ou
+// MS_SYS_SOLVER_NOCONV.
+typedef struct {
+    const float *m;
+    int   ic;
+    int   max_iter;
+    float tol;                  // critério de parada: max |r| <= tol max |b|
+    float *work;
+    // Saída
+    int   iters;
+} ms_cg_t;
+int  ms_cg_solve(const ms_csr_t *A, const float b[], float x[], ms_cg_t *s);
+
+// LU no lugar: L (diagonal unitária implícita) abaixo da diagonal e U na
+// diagonal e acima, na própria matriz. Retorna -1 com pivô nulo.
+int  ms_lu_factor(int n, float *const M[]);
+void ms_lu_subst(int n, float *const M[], const float b[], float x[]);
+
 // Conferencia por erros
 ms_system_status_t ms_check_system(const ms_circuit_t *c);
 const char* ms_system_status_str(int status);
@@ -227,6 +565,14 @@ float ms_get_element_current(const ms_circuit_t *c, int elem_index);
 float ms_get_resistor_current(const ms_circuit_t *c, int elem_index);
 float ms_get_capacitor_current(const ms_circuit_t *c, int elem_index);
 void ms_list_elements(const ms_circuit_t *c);
+
+// Sondas: definidas uma vez, resolvidas em índices diretos de x[] e
+// avaliadas em um único laço após a solução.
+int  ms_add_probe(ms_circuit_t *c, const ms_probe_def_t *def);
+int  ms_set_probes(ms_circuit_t *c, const ms_probe_def_t *defs, int n);
+void ms_clear_probes(ms_circuit_t *c);
+int  ms_probes_resolve(ms_circuit_t *c);
+void ms_probes_eval(ms_circuit_t *c, ms_probe_out_fn out, uint16_t pwm_max);
 // ======================================================
 // INTERFACE COM PWM/DAC
 // ======================================================
@@ -0,0 +1,322 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Geração e carga da imagem binária de circuito (ver ms_image.h).
+ * A carga só lê a imagem: valida o CRC e os registros e monta o circuito
+ * com as mesmas funções ms_add_* usadas no circuit.c.
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include <string.h>
+#include "ms_image.h"
+
+// Os registros são copiados byte a byte entre host e RP2350
+_Static_assert(sizeof(ms_img_header_t) == 44, "cabecalho deve ter 44 bytes");
+_Static_assert(sizeof(ms_img_elem_t)   == 40, "elemento deve ter 40 bytes");
+_Static_assert(sizeof(ms_img_probe_t)  == 12, "sonda deve ter 12 bytes");
+
+// Início da área coberta pelo CRC (campo nodes)
+#define MS_IMG_CRC_START    offsetof(ms_img_header_t, nodes)
+
+// ======================================================
+// CRC-32
+// ======================================================
+
+// Tabela de 256 entradas (1 KB de RAM) montada na primeira chamada:
+// um acesso por byte, para validar um slot no boot em poucos microssegundos.
+uint32_t ms_crc32(const void *data, size_t len)
+{
+    static uint32_t tab[256];
+    static int tab_ready = 0;
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t crc = 0xFFFFFFFFu;
+
+    if (!tab_ready) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t r = i;
+            for (int k = 0; k < 8; k++)
+                r = (r >> 1) ^ (0xEDB88320u & (0u - (r & 1u)));
+            tab[i] = r;
+        }
+        tab_ready = 1;
+    }
+
+    while (len--)
+        crc = (crc >> 8) ^ tab[(crc ^ *p++) & 0xFF];
+    return ~crc;
+}
+
+// ======================================================
+// GERAÇÃO
+// ======================================================
+
+size_t ms_image_size(const ms_circuit_t *c)
+{
+    return sizeof(ms_img_header_t) +
+           (size_t)c->elems  * sizeof(ms_img_elem_t) +
+           (size_t)c->probes * sizeof(ms_img_probe_t);
+}
+
+static int ms_img_ext_index(volatile float *p, volatile float *const *ext, int n_ext)
+{
+    for (int i = 0; i < n_ext; i++)
+        if (ext[i] == p) return i;
+    return -1;
+}
+
+int ms_image_build(const ms_circuit_t *c,
+                   volatile float *const *ext, int n_ext,
+                   const char *name, void *buf, size_t cap)
+{
+    size_t total = ms_image_size(c);
+    if (total > cap || total > MS_IMG_SLOT_SIZE) return MS_IMG_ERR_SIZE;
+
+    uint8_t *out = (uint8_t *)buf;
+    memset(out, 0, total);
+
+    ms_img_header_t *h = (ms_img_header_t *)out;
+    h->magic       = MS_IMG_MAGIC;
+    h->version     = MS_IMG_VERSION;
+    h->header_size = sizeof(ms_img_header_t);
+    h->total_size  = (uint32_t)total;
+    h->nodes       = (uint8_t)c->nodes;
+    h->elems       = (uint8_t)c->elems;
+    h->probes      = (uint8_t)c->probes;
+    h->solver      = (uint8_t)c->solver | (c->events ? MS_IMG_SOLVER_EVENTS : 0) |
+                     (c->l_norton ? MS_IMG_SOLVER_LNORTON : 0) |
+                     (c->sor_redblack ? MS_IMG_SOLVER_REDBLACK : 0) |
+                     (c->cg_precond == MS_CG_IC0 ? MS_IMG_SOLVER_CG_IC : 0);
+    h->dt          = c->dt;
+    h->sor_omega   = c->sor_auto ? 0.0f : c->sor_omega;
+    if (name) strncpy(h->name, name, MS_IMG_NAME_LEN - 1);
+
+    ms_img_elem_t *r = (ms_img_elem_t *)(out + sizeof(ms_img_header_t));
+    for (int i = 0; i < c->elems; i++, r++) {
+        const ms_element_t *e = &c->elem[i];
+
+        r->type      = (uint8_t)e->type;
+        r->src_type  = (uint8_t)e->src.type;
+        r->ext       = -1;
+        r->ctrl_elem = (int8_t)e->ctrl_elem;
+        r->a  = (uint8_t)e->a;   r->b  = (uint8_t)e->b;
+        r->c1 = (uint8_t)e->c1;  r->c2 = (uint8_t)e->c2;
+        r->value = e->value;
+
+        switch (e->type) {
+        case MS_ELEM_V:
+        case MS_ELEM_I:
+            switch (e->src.type) {
+            case MS_SRC_DC:
+                r->p[0] = e->src.dc;
+                break;
+            case MS_SRC_SINE:
+                r->p[0] = e->src.offset;    r->p[1] = e->src.amplitude;
+                r->p[2] = e->src.frequency; r->p[3] = e->src.phase;
+                break;
+            case MS_SRC_PULSE:
+                r->p[0] = e->src.v1;    r->p[1] = e->src.v2;
+                r->p[2] = e->src.delay; r->p[3] = e->src.tr;
+                r->p[4] = e->src.tf;    r->p[5] = e->src.width;
+                r->p[6] = e->src.period;
+                break;
+            case MS_SRC_EXTERNAL:
+                r->ext = (int8_t)ms_img_ext_index(e->src.ext, ext, n_ext);
+                if (r->ext < 0) return MS_IMG_ERR_EXT;
+                r->p[0] = e->src.gain;  r->p[1] = e->src.offset_ext;
+                break;
+            }
+            break;
+        case MS_ELEM_SWITCH:
+            r->p[0] = e->ron; r->p[1] = e->roff; r->p[2] = e->vth;
+            break;
+        case MS_ELEM_DIODE:
+            r->p[0] = e->ron; r->p[1] = e->roff; r->p[2] = e->vf;
+            break;
+        case MS_ELEM_AVGSW:
+            if (e->src.type == MS_SRC_EXTERNAL) {
+                r->ext = (int8_t)ms_img_ext_index(e->src.ext, ext, n_ext);
+                if (r->ext < 0) return MS_IMG_ERR_EXT;
+                r->p[0] = e->src.gain;  r->p[1] = e->src.offset_ext;
+            } else if (e->src.type == MS_SRC_DC) {
+                r->p[0] = e->src.dc;
+            } else {
+                return MS_IMG_ERR_CONTENT;
+            }
+            r->p[2] = e->fsw;
+            break;
+        case MS_ELEM_ADCSW:
+        case MS_ELEM_ADCD:
+            r->p[0] = e->vth; r->p[1] = e->theta;
+            break;
+        default:
+            break;
+        }
+    }
+
+    ms_img_probe_t *q = (ms_img_probe_t *)r;
+    for (int i = 0; i < c->probes; i++, q++) {
+        const ms_probe_def_t *d = &c->probe[i].def;
+        q->type    = (uint8_t)d->type;
+        q->a       = (uint8_t)d->a;
+        q->b       = (uint8_t)d->b;
+        q->channel = (int8_t)d->channel;
+        q->gain    = d->gain;
+        q->offset  = d->offset;
+    }
+
+    h->crc32 = ms_crc32(out + MS_IMG_CRC_START, total - MS_IMG_CRC_START);
+    return (int)total;
+}
+
+// ======================================================
+// VALIDAÇÃO E CARGA
+// ======================================================
+
+int ms_image_check(const void *img, size_t max_size)
+{
+    const ms_img_header_t *h = (const ms_img_header_t *)img;
+
+    if (h->magic != MS_IMG_MAGIC) return MS_IMG_ERR_MAGIC;
+    if (h->version != MS_IMG_VERSION || h->header_size != sizeof(ms_img_header_t))
+        return MS_IMG_ERR_VERSION;
+
+    size_t expect = sizeof(ms_img_header_t) +
+                    (size_t)h->elems  * sizeof(ms_img_elem_t) +
+                    (size_t)h->probes * sizeof(ms_img_probe_t);
+    if (h->total_size != expect || expect > max_size)
+        return MS_IMG_ERR_SIZE;
+
+    const uint8_t *p = (const uint8_t *)img;
+    if (ms_crc32(p + MS_IMG_CRC_START, expect - MS_IMG_CRC_START) != h->crc32)
+        return MS_IMG_ERR_CRC;
+
+    return MS_IMG_OK;
+}
+
+// Confere um registro de elemento contra os limites do motor
+static int ms_img_elem_valid(const ms_img_elem_t *r, int nodes, int index)
+{
+    if (r->type > MS_ELEM_ADCD) return 0;
+    if (r->a > nodes || r->b > nodes) return 0;
+
+    switch (r->type) {
+    case MS_ELEM_VCVS: case MS_ELEM_VCCS: case MS_ELEM_SWITCH: case MS_ELEM_ADCSW:
+        return r->c1 <= nodes && r->c2 <= nodes;
+    case MS_ELEM_CCVS: case MS_ELEM_CCCS:
+        return r->ctrl_elem >= 0 && r->ctrl_elem < index;
+    case MS_ELEM_V: case MS_ELEM_I:
+        return r->src_type <= MS_SRC_EXTERNAL;
+    case MS_ELEM_AVGSW:
+        return r->c1 <= nodes &&
+               (r->src_type == MS_SRC_DC || r->src_type == MS_SRC_EXTERNAL);
+    default:
+        return 1;
+    }
+}
+
+int ms_image_load(ms_circuit_t *c, const void *img, size_t max_size,
+                  volatile float *const *ext, int n_ext)
+{
+    int st = ms_image_check(img, max_size);
+    if (st != MS_IMG_OK) return st;
+
+    const ms_img_header_t *h = (const ms_img_header_t *)img;
+    const ms_img_elem_t  *r = (const ms_img_elem_t *)((const uint8_t *)img + sizeof(*h));
+    const ms_img_probe_t *q = (const ms_img_probe_t *)(r + h->elems);
+
+    // Valida tudo antes de tocar no circuito
+    if (h->nodes < 1 || h->nodes > MS_MAX_NODES || h->elems > MS_MAX_ELEMS ||
+        h->probes > MS_MAX_PROBES || (h->solver & ~MS_IMG_SOLVER_FLAGS) > MS_SOLVER_CG || !(h->dt > 0.0f) ||
+        !(h->sor_omega >= 0.0f && h->sor_omega < 2.0f))
+        return MS_IMG_ERR_CONTENT;
+    for (int i = 0; i < h->elems; i++) {
+        if (!ms_img_elem_valid(&r[i], h->nodes, i)) return MS_IMG_ERR_CONTENT;
+        if (r[i].src_type == MS_SRC_EXTERNAL &&
+            (r[i].ext < 0 || r[i].ext >= n_ext || ext[r[i].ext] == NULL))
+            return MS_IMG_ERR_EXT;
+    }
+    for (int i = 0; i < h->probes; i++) {
+        if (q[i].type > MS_PROBE_CURRENT) return MS_IMG_ERR_CONTENT;
+        int lim = (q[i].type == MS_PROBE_CURRENT) ? h->elems - 1 : h->nodes;
+        if (q[i].a > lim || q[i].b > h->nodes) return MS_IMG_ERR_CONTENT;
+    }
+
+    ms_circuit_init(c, h->nodes, h->dt);
+    ms_set_solver(c, (ms_solver_type_t)(h->solver & ~MS_IMG_SOLVER_FLAGS));
+    ms_set_events(c, h->solver & MS_IMG_SOLVER_EVENTS);
+    ms_set_inductor_norton(c, h->solver & MS_IMG_SOLVER_LNORTON);
+    ms_set_sor(c, h->sor_omega, h->solver & MS_IMG_SOLVER_REDBLACK);
+    ms_set_cg(c, (h->solver & MS_IMG_SOLVER_CG_IC) ? MS_CG_IC0 : MS_CG_JACOBI);
+
+    for (int i = 0; i < h->elems; i++, r++) {
+        int idx;
+        switch (r->type) {
+        case MS_ELEM_R:      idx = ms_add_resistor (c, r->a, r->b, r->value); break;
+        case MS_ELEM_C:      idx = ms_add_capacitor(c, r->a, r->b, r->value); break;
+        case MS_ELEM_L:      idx = ms_add_inductor (c, r->a, r->b, r->value); break;
+        case MS_ELEM_VCVS:   idx = ms_add_vcvs(c, r->a, r->b, r->c1, r->c2, r->value); break;
+        case MS_ELEM_VCCS:   idx = ms_add_vccs(c, r->a, r->b, r->c1, r->c2, r->value); break;
+        case MS_ELEM_CCVS:   idx = ms_add_ccvs(c, r->a, r->b, r->ctrl_elem, r->value); break;
+        case MS_ELEM_CCCS:   idx = ms_add_cccs(c, r->a, r->b, r->ctrl_elem, r->value); break;
+        case MS_ELEM_SWITCH: idx = ms_add_switch(c, r->a, r->b, r->c1, r->c2,
+                                                 r->p[0], r->p[1], r->p[2]); break;
+        case MS_ELEM_DIODE:  idx = ms_add_diode(c, r->a, r->b, r->p[0], r->p[1], r->p[2]); break;
+        case MS_ELEM_AVGSW:
+            idx = ms_add_avg_switch(c, r->a, r->b, r->c1,
+                                    r->src_type == MS_SRC_DC ? r->p[0] : 0.0f,
+                                    r->value, r->p[2]);
+            if (r->src_type == MS_SRC_EXTERNAL)
+                ms_set_source_external(c, idx, ext[r->ext], r->p[0], r->p[1]);
+            break;
+        case MS_ELEM_ADCSW:
+        case MS_ELEM_ADCD:
+            idx = (r->type == MS_ELEM_ADCSW)
+                ? ms_add_adc_switch(c, r->a, r->b, r->c1, r->c2, r->value, r->p[0])
+                : ms_add_adc_diode(c, r->a, r->b, r->value);
+            ms_set_adc_damping(c, idx, r->p[1]);
+            break;
+        case MS_ELEM_V:
+        case MS_ELEM_I:
+            idx = (r->type == MS_ELEM_V)
+                ? ms_add_voltage_source(c, r->a, r->b, r->p[0])
+                : ms_add_current_source(c, r->a, r->b, r->p[0]);
+            if (r->src_type == MS_SRC_SINE)
+                ms_set_source_sine(c, idx, r->p[0], r->p[1], r->p[2], r->p[3]);
+            else if (r->src_type == MS_SRC_PULSE)
+                ms_set_source_pulse(c, idx, r->p[0], r->p[1], r->p[2], r->p[3],
+                                    r->p[4], r->p[5], r->p[6]);
+            else if (r->src_type == MS_SRC_EXTERNAL)
+                ms_set_source_external(c, idx, ext[r->ext], r->p[0], r->p[1]);
+            break;
+        default:
+            idx = -1;
+            break;
+        }
+        if (idx < 0) return MS_IMG_ERR_CONTENT;
+        c->elem[idx].value = r->value;
+    }
+
+    for (int i = 0; i < h->probes; i++, q++) {
+        ms_probe_def_t d = { (ms_probe_type_t)q->type, q->a, q->b,
+                             q->gain, q->offset, q->channel };
+        ms_add_probe(c, &d);
+    }
+
+    return MS_IMG_OK;
+}
+
+const char *ms_image_status_str(int status)
+{
+    switch (status) {
+        case MS_IMG_OK:          return "OK";
+        case MS_IMG_ERR_MAGIC:   return "Slot vazio";
+        case MS_IMG_ERR_VERSION: return "Versao incompativel";
+        case MS_IMG_ERR_SIZE:    return "Tamanho invalido";
+        case MS_IMG_ERR_CRC:     return "CRC invalido";
+        case MS_IMG_ERR_CONTENT: return "Conteudo invalido";
+        case MS_IMG_ERR_EXT:     return "Entrada externa invalida";
+        default:                 return "Status desconhecido";
+    }
+}
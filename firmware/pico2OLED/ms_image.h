@@ -0,0 +1,144 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Imagem binária compacta de circuito (netlist "compilada").
+ * Guarda elementos, fontes, sondas e configuração do solver em registros
+ * de tamanho fixo, protegidos por CRC-32, para que o firmware carregue o
+ * circuito direto da flash (XIP), sem nenhum parsing de texto.
+ *
+ * Layout (little-endian, floats IEEE-754, como no RP2350):
+ *
+ *   ms_img_header_t                 44 bytes
+ *   ms_img_elem_t  [elems]          40 bytes cada
+ *   ms_img_probe_t [probes]         12 bytes cada
+ *
+ * O CRC-32 (polinômio 0xEDB88320, o mesmo do zlib) cobre tudo a partir
+ * do campo "nodes" do cabeçalho até o fim da imagem.
+ *
+ * As imagens ficam em MS_IMG_SLOTS setores no fim da flash e são geradas
+ * no host por tools/ms_imgtool.c a partir do circuit.c ou de uma netlist
+ * em texto (ms_netlist.h).
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#ifndef MS_IMAGE_H
+#define MS_IMAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mini_spiceHILv3.h"
+
+// ======================================================
+// FORMATO
+// ======================================================
+
+#define MS_IMG_MAGIC        0x4C494850u     // "PHIL"
+#define MS_IMG_VERSION      2
+#define MS_IMG_NAME_LEN     16
+
+// Slots na flash: slot n (1..MS_IMG_SLOTS) fica em
+// FLASH_SIZE - (MS_IMG_SLOTS - n + 1) * MS_IMG_SLOT_SIZE
+#define MS_IMG_SLOTS        3
+#define MS_IMG_SLOT_SIZE    4096u           // 1 setor de flash
+#define MS_IMG_SLOT_OFFSET(flash_size, n) \
+    ((uint32_t)(flash_size) - (uint32_t)(MS_IMG_SLOTS - (n) + 1) * MS_IMG_SLOT_SIZE)
+
+// Setor logo abaixo do slot 1: slot escolhido para o boot (!boot no console)
+#define MS_IMG_BOOT_OFFSET(flash_size) \
+    (MS_IMG_SLOT_OFFSET(flash_size, 1) - MS_IMG_SLOT_SIZE)
+
+#define MS_IMG_SOLVER_EVENTS    0x80    // bit de "solver": eventos dentro do passo
+#define MS_IMG_SOLVER_LNORTON   0x40    // bit de "solver": indutores na forma de Norton
+#define MS_IMG_SOLVER_REDBLACK  0x20    // bit de "solver": SOR em vermelho-preto
+#define MS_IMG_SOLVER_CG_IC     0x08    // bit de "solver": CG com Cholesky incompleto
+#define MS_IMG_SOLVER_FLAGS     (MS_IMG_SOLVER_EVENTS | MS_IMG_SOLVER_LNORTON | \
+                                 MS_IMG_SOLVER_REDBLACK | MS_IMG_SOLVER_CG_IC)
+
+typedef struct {
+    uint32_t magic;                 // MS_IMG_MAGIC
+    uint16_t version;               // MS_IMG_VERSION
+    uint16_t header_size;           // sizeof(ms_img_header_t)
+    uint32_t total_size;            // cabeçalho + registros, em bytes
+    uint32_t crc32;                 // CRC-32 de nodes..fim da imagem
+
+    uint8_t  nodes;
+    uint8_t  elems;
+    uint8_t  probes;
+    uint8_t  solver;                // ms_solver_type_t | MS_IMG_SOLVER_FLAGS
+    float    dt;
+    float    sor_omega;             // omega fixo do SOR (0 = estimado, ms_set_sor)
+    char     name[MS_IMG_NAME_LEN]; // nome livre (terminado em '\0')
+} ms_img_header_t;
+
+// Parâmetros p[] por tipo de elemento:
+//   R, L, C, E, G, F, H : só value (valor ou ganho)
+//   V, I  DC            : p[0] = dc
+//         SINE          : p[0..3] = offset, amplitude, frequência, fase [rad]
+//         PULSE         : p[0..6] = v1, v2, atraso, tr, tf, largura, período
+//         EXTERNAL      : p[0..1] = ganho, offset   (entrada em ext)
+//   S                   : p[0..2] = ron, roff, vth
+//   D                   : p[0..2] = ron, roff, vf
+//   A (célula PWM média): value = L; p[0] = razão (DC) ou p[0..1] = ganho,
+//                         offset (EXTERNAL); p[2] = fsw; c1 = terminal comum
+//   S ADC               : value = gs; p[0] = vth, p[1] = theta
+//   D ADC               : value = gs; p[1] = theta
+typedef struct {
+    uint8_t type;                   // ms_element_type_t
+    uint8_t src_type;               // ms_source_type_t (V, I e A)
+    int8_t  ext;                    // entrada externa (-1 = nenhuma)
+    int8_t  ctrl_elem;              // elemento de controle de F/H (-1 = nenhum)
+    uint8_t a, b, c1, c2;
+    float   value;
+    float   p[7];
+} ms_img_elem_t;
+
+typedef struct {
+    uint8_t type;                   // ms_probe_type_t
+    uint8_t a, b;
+    int8_t  channel;
+    float   gain;
+    float   offset;
+} ms_img_probe_t;
+
+// ======================================================
+// DIAGNÓSTICO
+// ======================================================
+
+typedef enum {
+    MS_IMG_OK           =  0,
+    MS_IMG_ERR_MAGIC    = -1,   // slot vazio ou não é uma imagem
+    MS_IMG_ERR_VERSION  = -2,   // versão ou cabeçalho incompatível
+    MS_IMG_ERR_SIZE     = -3,   // tamanho inconsistente ou maior que o slot
+    MS_IMG_ERR_CRC      = -4,   // conteúdo corrompido
+    MS_IMG_ERR_CONTENT  = -5,   // registro com tipo/nó/índice inválido
+    MS_IMG_ERR_EXT      = -6    // fonte externa fora da tabela de entradas
+} ms_image_status_t;
+
+// ======================================================
+// API
+// ======================================================
+
+uint32_t ms_crc32(const void *data, size_t len);
+
+// Tamanho da imagem do circuito, em bytes
+size_t ms_image_size(const ms_circuit_t *c);
+
+// Serializa o circuito em buf. ext[] identifica as entradas das fontes
+// EXTERNAL (mesma numeração de EXT() na netlist). Retorna o tamanho
+// escrito ou um ms_image_status_t negativo.
+int ms_image_build(const ms_circuit_t *c,
+                   volatile float *const *ext, int n_ext,
+                   const char *name, void *buf, size_t cap);
+
+// Valida cabeçalho, tamanho e CRC sem tocar em nenhum circuito
+int ms_image_check(const void *img, size_t max_size);
+
+// Valida e monta o circuito a partir da imagem (pode estar na flash).
+int ms_image_load(ms_circuit_t *c, const void *img, size_t max_size,
+                  volatile float *const *ext, int n_ext);
+
+const char *ms_image_status_str(int status);
+
+#endif // MS_IMAGE_H
@@ -0,0 +1,102 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Núcleos dos solvers diretos (mini_spiceHILv3.c): atualização de linha
+ * y -= a*x (eliminação e fatoração LU) e produto escalar (substituições e
+ * reconstrução das correntes das fontes eliminadas).
+ *
+ * Duas versões, escolhidas na compilação:
+ *   . rápida (padrão no firmware): desenrolada de 4 em 4 com fmaf, que no
+ *     Cortex-M33 vira VFMA.F32 (uma operação, um arredondamento); o
+ *     produto escalar usa 4 acumuladores independentes para não esperar a
+ *     latência da FPU a cada termo;
+ *   . portátil (padrão no host, onde fmaf sem -mfma é uma chamada de
+ *     biblioteca): o laço simples de antes, referência para comparar.
+ * -DMS_KERNELS_FAST ou -DMS_KERNELS_PORTABLE forçam uma delas. As duas
+ * ficam sempre definidas (_ref e _fast) para o tools/kernel_bench.c.
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#ifndef MS_KERNELS_H
+#define MS_KERNELS_H
+
+#include <math.h>
+#include "mini_spiceHILv3.h"
+
+#if !defined(MS_KERNELS_FAST) && !defined(MS_KERNELS_PORTABLE)
+#ifdef MS_HOST_BUILD
+#define MS_KERNELS_PORTABLE
+#else
+#define MS_KERNELS_FAST
+#endif
+#endif
+
+// ======================================================
+// REFERÊNCIA (PORTÁTIL)
+// ======================================================
+
+// y[0..n) -= a * x[0..n)
+static inline void MS_RAM_FUNC(ms_k_axpy_ref)(float *y, const float *x, float a, int n)
+{
+    for (int j = 0; j < n; j++)
+        y[j] -= a * x[j];
+}
+
+// Soma de a[j] * x[j], j em [0, n)
+static inline float MS_RAM_FUNC(ms_k_dot_ref)(const float *a, const float *x, int n)
+{
+    float sum = 0.0f;
+    for (int j = 0; j < n; j++)
+        sum += a[j] * x[j];
+    return sum;
+}
+
+// ======================================================
+// RÁPIDA (DESENROLADA, FMA)
+// ======================================================
+
+static inline void MS_RAM_FUNC(ms_k_axpy_fast)(float *y, const float *x, float a, int n)
+{
+    float na = -a;
+    int j = 0;
+    for (; j + 4 <= n; j += 4) {
+        float y0 = fmaf(na, x[j],     y[j]);
+        float y1 = fmaf(na, x[j + 1], y[j + 1]);
+        float y2 = fmaf(na, x[j + 2], y[j + 2]);
+        float y3 = fmaf(na, x[j + 3], y[j + 3]);
+        y[j] = y0; y[j + 1] = y1; y[j + 2] = y2; y[j + 3] = y3;
+    }
+    for (; j < n; j++)
+        y[j] = fmaf(na, x[j], y[j]);
+}
+
+static inline float MS_RAM_FUNC(ms_k_dot_fast)(const float *a, const float *x, int n)
+{
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    int j = 0;
+    for (; j + 4 <= n; j += 4) {
+        s0 = fmaf(a[j],     x[j],     s0);
+        s1 = fmaf(a[j + 1], x[j + 1], s1);
+        s2 = fmaf(a[j + 2], x[j + 2], s2);
+        s3 = fmaf(a[j + 3], x[j + 3], s3);
+    }
+    for (; j < n; j++)
+        s0 = fmaf(a[j], x[j], s0);
+    return (s0 + s1) + (s2 + s3);
+}
+
+// ======================================================
+// SELEÇÃO
+// ======================================================
+
+#ifdef MS_KERNELS_FAST
+#define ms_k_axpy   ms_k_axpy_fast
+#define ms_k_dot    ms_k_dot_fast
+#else
+#define ms_k_axpy   ms_k_axpy_ref
+#define ms_k_dot    ms_k_dot_ref
+#endif
+
+#endif
@@ -0,0 +1,606 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Carregador de netlist em tempo de execução (ver ms_netlist.h).
+ * Cada linha é tokenizada em uma cópia local (sem alocação dinâmica) e
+ * vira uma chamada ms_add_* sobre o circuito em construção.
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "ms_netlist.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define MS_NL_DEFAULT_DT    100e-6f
+
+// Parâmetros padrão de S e D (mesmos valores usados nos exemplos de circuit.c)
+#define MS_NL_SW_RON        0.01f
+#define MS_NL_SW_ROFF       1e6f
+#define MS_NL_SW_VTH        0.5f
+#define MS_NL_D_RON         0.1f
+#define MS_NL_D_ROFF        10e6f
+#define MS_NL_D_VF          0.1f
+
+// ======================================================
+// FUNÇÕES AUXILIARES
+// ======================================================
+
+static int ms_nl_error(ms_netlist_t *p, int status, const char *msg, const char *tok)
+{
+    p->errors++;
+    if (tok)
+        snprintf(p->diag, sizeof p->diag, "linha %d: %s '%s'", p->line, msg, tok);
+    else
+        snprintf(p->diag, sizeof p->diag, "linha %d: %s", p->line, msg);
+    return status;
+}
+
+// Comparação sem diferenciar maiúsculas/minúsculas
+static int ms_nl_eq(const char *a, const char *b)
+{
+    while (*a && *b) {
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) return 0;
+        a++; b++;
+    }
+    return *a == *b;
+}
+
+// Separa a linha em tokens (espaço, tab e ',' separam; '(' e ')' viram
+// tokens próprios). Comentários com ';' terminam a linha.
+static int ms_nl_tokenize(char *s, char *tok[], int max)
+{
+    int n = 0;
+
+    while (*s) {
+        while (*s == ' ' || *s == '\t' || *s == ',' || *s == '=' || *s == '\r')
+            *s++ = '\0';
+        if (*s == '\0' || *s == ';') break;
+        if (n >= max) return -1;
+
+        if (*s == '(' || *s == ')') {
+            // Guarda o parêntese em uma string estática de 1 caractere
+            tok[n++] = (*s == '(') ? "(" : ")";
+            *s++ = '\0';
+            continue;
+        }
+
+        tok[n++] = s;
+        while (*s && *s != ' ' && *s != '\t' && *s != ',' && *s != '=' &&
+               *s != '(' && *s != ')' && *s != ';' && *s != '\r')
+            s++;
+        if (*s == ';') { *s = '\0'; break; }
+    }
+    return n;
+}
+
+// Converte valor com sufixo SPICE (10k, 4.7u, 1meg, 100nF, ...)
+static int ms_nl_value(const char *s, float *out)
+{
+    char *end;
+    float v = strtof(s, &end);
+    if (end == s) return 0;
+
+    switch (tolower((unsigned char)*end)) {
+    case 't': v *= 1e12f; break;
+    case 'g': v *= 1e9f;  break;
+    case 'k': v *= 1e3f;  break;
+    case 'u': v *= 1e-6f; break;
+    case 'n': v *= 1e-9f; break;
+    case 'p': v *= 1e-12f; break;
+    case 'f': v *= 1e-15f; break;
+    case 'm':
+        if (tolower((unsigned char)end[1]) == 'e' &&
+            tolower((unsigned char)end[2]) == 'g') v *= 1e6f;
+        else v *= 1e-3f;
+        break;
+    default:
+        // Sem sufixo: o restante só pode ser unidade (V, A, Ohm, Hz, s)
+        if (*end && !isalpha((unsigned char)*end)) return 0;
+        break;
+    }
+
+    if (!isfinite(v)) return 0;
+    *out = v;
+    return 1;
+}
+
+// Nome de nó -> número (0 = terra). Cria o nó se ainda não existir.
+static int ms_nl_node(ms_netlist_t *p, const char *name)
+{
+    if (ms_nl_eq(name, "0") || ms_nl_eq(name, "gnd")) return 0;
+
+    for (int i = 0; i < p->nodes; i++)
+        if (ms_nl_eq(p->node_name[i], name)) return i + 1;
+
+    if (p->nodes >= MS_MAX_NODES) return -1;
+    strncpy(p->node_name[p->nodes], name, MS_NL_NAME_LEN - 1);
+    p->node_name[p->nodes][MS_NL_NAME_LEN - 1] = '\0';
+    p->nodes++;
+
+    // O circuito cresce junto com os nós nomeados
+    if (p->c->nodes < p->nodes) {
+        p->c->nodes = p->nodes;
+        p->c->system_size = p->nodes;
+    }
+    return p->nodes;
+}
+
+// Nome de nó -> número, sem criar (-1 se o nó ainda não apareceu)
+static int ms_nl_node_find(const ms_netlist_t *p, const char *name)
+{
+    if (ms_nl_eq(name, "0") || ms_nl_eq(name, "gnd")) return 0;
+
+    for (int i = 0; i < p->nodes; i++)
+        if (ms_nl_eq(p->node_name[i], name)) return i + 1;
+    return -1;
+}
+
+// Nome de elemento -> índice (ou -1)
+static int ms_nl_elem(const ms_netlist_t *p, const char *name)
+{
+    for (int i = 0; i < p->c->elems; i++)
+        if (ms_nl_eq(p->elem_name[i], name)) return i;
+    return -1;
+}
+
+// Lê n valores a partir de tok[first]; os que faltarem ficam com def[]
+static int ms_nl_values(char *tok[], int ntok, int first, int n,
+                        float *out, const float *def, int required)
+{
+    for (int i = 0; i < n; i++) {
+        int k = first + i;
+        if (k >= ntok || tok[k][0] == ')') {
+            if (i < required) return -1;
+            out[i] = def ? def[i] : 0.0f;
+            continue;
+        }
+        if (!ms_nl_value(tok[k], &out[i])) return k;
+    }
+    return 0;
+}
+
+// ======================================================
+// FONTES INDEPENDENTES (V e I)
+// ======================================================
+
+static int ms_nl_source(ms_netlist_t *p, char *tok[], int ntok, int a, int b)
+{
+    ms_circuit_t *c = p->c;
+    int is_v = (tolower((unsigned char)tok[0][0]) == 'v');
+    float v[7];
+    int r;
+
+    // Forma DC: Vxxx n+ n- [DC] valor
+    int k = 3;
+    if (k < ntok && ms_nl_eq(tok[k], "dc")) k++;
+    if (k < ntok && tok[k][0] != '(' && ms_nl_value(tok[k], &v[0])) {
+        if (k + 1 != ntok) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "campos demais", NULL);
+        return is_v ? ms_add_voltage_source(c, a, b, v[0])
+                    : ms_add_current_source(c, a, b, v[0]);
+    }
+
+    // Formas com parênteses: KEYWORD ( ... )
+    if (ntok < 6 || tok[4][0] != '(' || tok[ntok - 1][0] != ')')
+        return ms_nl_error(p, MS_NL_ERR_SYNTAX, "fonte invalida", tok[0]);
+
+    int idx = is_v ? ms_add_voltage_source(c, a, b, 0.0f)
+                   : ms_add_current_source(c, a, b, 0.0f);
+    if (idx < 0) return idx;
+
+    if (ms_nl_eq(tok[3], "sin")) {
+        static const float def[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        r = ms_nl_values(tok, ntok, 5, 6, v, def, 3);
+        if (r != 0) goto bad_value;
+        // O motor não modela atraso nem amortecimento
+        if (v[3] != 0.0f || v[4] != 0.0f)
+            goto unsupported;
+        ms_set_source_sine(c, idx, v[0], v[1], v[2], v[5] * (float)M_PI / 180.0f);
+    }
+    else if (ms_nl_eq(tok[3], "pulse")) {
+        r = ms_nl_values(tok, ntok, 5, 7, v, NULL, 7);
+        if (r != 0) goto bad_value;
+        ms_set_source_pulse(c, idx, v[0], v[1], v[2], v[3], v[4], v[5], v[6]);
+    }
+    else if (ms_nl_eq(tok[3], "ext")) {
+        static const float def[3] = { 0.0f, 1.0f, 0.0f };
+        r = ms_nl_values(tok, ntok, 5, 3, v, def, 1);
+        if (r != 0) goto bad_value;
+        int in = (int)v[0];
+        if (in < 0 || in >= MS_NL_MAX_EXT || p->ext[in] == NULL || (float)in != v[0]) {
+            c->elems--;
+            return ms_nl_error(p, MS_NL_ERR_REF, "entrada externa inexistente", tok[5]);
+        }
+        ms_set_source_external(c, idx, p->ext[in], v[1], v[2]);
+    }
+    else {
+        c->elems--;
+        return ms_nl_error(p, MS_NL_ERR_UNKNOWN, "tipo de fonte desconhecido", tok[3]);
+    }
+    return idx;
+
+bad_value:
+    c->elems--;
+    if (r < 0) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "parametros insuficientes em", tok[3]);
+    return ms_nl_error(p, MS_NL_ERR_VALUE, "valor invalido", tok[r]);
+
+unsupported:
+    c->elems--;
+    return ms_nl_error(p, MS_NL_ERR_SYNTAX, "SIN com td/theta nao suportado", NULL);
+}
+
+// ======================================================
+// ELEMENTOS
+// ======================================================
+
+// ADC(gs [theta]) a partir de tok[k] (chave e diodo de admitância
+// constante). Retorna o índice depois do ')' ou um erro.
+static int ms_nl_adc(ms_netlist_t *p, char *tok[], int ntok, int k, float v[2])
+{
+    static const float def[2] = { 0.0f, MS_ADC_THETA_DEFAULT };
+    int e;
+
+    if (k + 3 >= ntok || tok[k + 1][0] != '(')
+        return ms_nl_error(p, MS_NL_ERR_SYNTAX, "esperado: ADC(gs [theta])", NULL);
+    int r = ms_nl_values(tok, ntok, k + 2, 2, v, def, 1);
+    if (r < 0) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "parametros insuficientes em", tok[k]);
+    if (r > 0) return ms_nl_error(p, MS_NL_ERR_VALUE, "valor invalido", tok[r]);
+    for (e = k + 2; e < ntok && tok[e][0] != ')'; e++) { }
+    if (e >= ntok) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "falta ')' em", tok[0]);
+    if (e - (k + 2) > 2) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "campos demais em", tok[k]);
+    if (v[0] <= 0.0f || v[1] < 0.5f || v[1] > 1.0f)
+        return ms_nl_error(p, MS_NL_ERR_VALUE, "ADC: gs > 0 e theta entre 0.5 e 1 em", tok[0]);
+    return e + 1;
+}
+
+static int ms_nl_element(ms_netlist_t *p, char *tok[], int ntok)
+{
+    ms_circuit_t *c = p->c;
+    char kind = (char)tolower((unsigned char)tok[0][0]);
+    int nodes_needed = (kind == 'e' || kind == 'g' || kind == 's') ? 4 :
+                       (kind == 'a') ? 3 : 2;
+    int n[4];
+    float v[3];
+    int r, idx;
+
+    if (strchr("rlcviegfhsda", kind) == NULL)
+        return ms_nl_error(p, MS_NL_ERR_UNKNOWN, "elemento desconhecido", tok[0]);
+    if (strlen(tok[0]) >= MS_NL_NAME_LEN)
+        return ms_nl_error(p, MS_NL_ERR_SYNTAX, "nome longo demais", tok[0]);
+    if (ms_nl_elem(p, tok[0]) >= 0)
+        return ms_nl_error(p, MS_NL_ERR_REF, "elemento repetido", tok[0]);
+    if (c->elems >= MS_MAX_ELEMS)
+        return ms_nl_error(p, MS_NL_ERR_FULL, "elementos demais em", tok[0]);
+    // Nome + nós + ao menos um valor (S e D têm todos os parâmetros opcionais)
+    if (ntok < 1 + nodes_needed + ((kind == 's' || kind == 'd') ? 0 : 1))
+        return ms_nl_error(p, MS_NL_ERR_SYNTAX, "campos insuficientes em", tok[0]);
+
+    for (int i = 0; i < nodes_needed; i++) {
+        if (strlen(tok[1 + i]) >= MS_NL_NAME_LEN)
+            return ms_nl_error(p, MS_NL_ERR_SYNTAX, "nome longo demais", tok[1 + i]);
+        n[i] = ms_nl_node(p, tok[1 + i]);
+        if (n[i] < 0)
+            return ms_nl_error(p, MS_NL_ERR_NODES, "nos demais em", tok[0]);
+    }
+
+    switch (kind) {
+    case 'r': case 'l': case 'c':
+        if (ntok != 4) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "esperado: nome n1 n2 valor", NULL);
+        if (!ms_nl_value(tok[3], &v[0]) || v[0] <= 0.0f)
+            return ms_nl_error(p, MS_NL_ERR_VALUE, "valor invalido", tok[3]);
+        idx = (kind == 'r') ? ms_add_resistor(c, n[0], n[1], v[0]) :
+              (kind == 'l') ? ms_add_inductor(c, n[0], n[1], v[0]) :
+                              ms_add_capacitor(c, n[0], n[1], v[0]);
+        break;
+
+    case 'v': case 'i':
+        idx = ms_nl_source(p, tok, ntok, n[0], n[1]);
+        if (idx < 0) return idx;
+        break;
+
+    case 'e': case 'g':
+        if (ntok != 6) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "esperado: nome n+ n- nc+ nc- ganho", NULL);
+        if (!ms_nl_value(tok[5], &v[0]))
+            return ms_nl_error(p, MS_NL_ERR_VALUE, "valor invalido", tok[5]);
+        idx = (kind == 'e') ? ms_add_vcvs(c, n[0], n[1], n[2], n[3], v[0])
+                            : ms_add_vccs(c, n[0], n[1], n[2], n[3], v[0]);
+        break;
+
+    case 'f': case 'h': {
+        if (ntok != 5) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "esperado: nome n+ n- Vctrl ganho", NULL);
+        int ctrl = ms_nl_elem(p, tok[3]);
+        // A corrente de controle precisa de variável auxiliar (V, L, E ou H)
+        ms_element_type_t ct = (ctrl >= 0) ? c->elem[ctrl].type : MS_ELEM_R;
+        if (ct != MS_ELEM_V && ct != MS_ELEM_L && ct != MS_ELEM_VCVS && ct != MS_ELEM_CCVS)
+            return ms_nl_error(p, MS_NL_ERR_REF, "controle deve ser V, L, E ou H ja definido:", tok[3]);
+        if (!ms_nl_value(tok[4], &v[0]))
+            return ms_nl_error(p, MS_NL_ERR_VALUE, "valor invalido", tok[4]);
+        idx = (kind == 'f') ? ms_add_cccs(c, n[0], n[1], ctrl, v[0])
+                            : ms_add_ccvs(c, n[0], n[1], ctrl, v[0]);
+        break;
+    }
+
+    case 's': {
+        static const float def[3] = { MS_NL_SW_RON, MS_NL_SW_ROFF, MS_NL_SW_VTH };
+        if (ntok > 5 && ms_nl_eq(tok[5], "adc")) {
+            // Sxxx n1 n2 nc+ nc- ADC(gs [theta]) [vth]
+            float adc[2];
+            int k = ms_nl_adc(p, tok, ntok, 5, adc);
+            if (k < 0) return k;
+            if (ntok - k > 1) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "campos demais em", tok[0]);
+            r = ms_nl_values(tok, ntok, k, 1, v, &def[2], 0);
+            if (r != 0) return ms_nl_error(p, MS_NL_ERR_VALUE, "valor invalido", tok[r]);
+            idx = ms_add_adc_switch(c, n[0], n[1], n[2], n[3], adc[0], v[0]);
+            ms_set_adc_damping(c, idx, adc[1]);
+            break;
+        }
+        if (ntok > 8) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "campos demais em", tok[0]);
+        r = ms_nl_values(tok, ntok, 5, 3, v, def, 0);
+        if (r != 0) return ms_nl_error(p, MS_NL_ERR_VALUE, "valor invalido", tok[r]);
+        idx = ms_add_switch(c, n[0], n[1], n[2], n[3], v[0], v[1], v[2]);
+        break;
+    }
+
+    case 'a': {
+        // Axxx a p c duty|EXT(entrada ganho offset) [L fsw]
+        static const float def_ext[3] = { 0.0f, 1.0f, 0.0f };
+        static const float def_dcm[2] = { 0.0f, 0.0f };
+        float d[3], dcm[2];
+        int k = 5, in = -1;
+
+        if (ms_nl_eq(tok[4], "ext")) {
+            if (ntok < 8 || tok[5][0] != '(')
+                return ms_nl_error(p, MS_NL_ERR_SYNTAX, "esperado: EXT(entrada ganho offset)", NULL);
+            r = ms_nl_values(tok, ntok, 6, 3, d, def_ext, 1);
+            if (r < 0) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "parametros insuficientes em", tok[4]);
+            if (r > 0) return ms_nl_error(p, MS_NL_ERR_VALUE, "valor invalido", tok[r]);
+            for (k = 6; k < ntok && tok[k][0] != ')'; k++) { }
+            if (k >= ntok) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "falta ')' em", tok[0]);
+            k++;
+            in = (int)d[0];
+            if (in < 0 || in >= MS_NL_MAX_EXT || p->ext[in] == NULL || (float)in != d[0])
+                return ms_nl_error(p, MS_NL_ERR_REF, "entrada externa inexistente", tok[6]);
+        } else if (!ms_nl_value(tok[4], &d[0]) || d[0] < 0.0f || d[0] > 1.0f) {
+            return ms_nl_error(p, MS_NL_ERR_VALUE, "razao ciclica invalida", tok[4]);
+        }
+        if (ntok - k > 2) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "campos demais em", tok[0]);
+        r = ms_nl_values(tok, ntok, k, 2, dcm, def_dcm, 0);
+        if (r != 0) return ms_nl_error(p, MS_NL_ERR_VALUE, "valor invalido", tok[r]);
+        if (dcm[0] < 0.0f || dcm[1] < 0.0f)
+            return ms_nl_error(p, MS_NL_ERR_VALUE, "L e fsw devem ser >= 0 em", tok[0]);
+
+        idx = ms_add_avg_switch(c, n[0], n[1], n[2], in < 0 ? d[0] : 0.0f, dcm[0], dcm[1]);
+        if (idx >= 0 && in >= 0)
+            ms_set_source_external(c, idx, p->ext[in], d[1], d[2]);
+        break;
+    }
+
+    case 'd': {
+        static const float def[3] = { MS_NL_D_RON, MS_NL_D_ROFF, MS_NL_D_VF };
+        if (ntok > 3 && ms_nl_eq(tok[3], "adc")) {
+            // Dxxx anodo catodo ADC(gs [theta])
+            float adc[2];
+            int k = ms_nl_adc(p, tok, ntok, 3, adc);
+            if (k < 0) return k;
+            if (k != ntok) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "campos demais em", tok[0]);
+            idx = ms_add_adc_diode(c, n[0], n[1], adc[0]);
+            ms_set_adc_damping(c, idx, adc[1]);
+            break;
+        }
+        if (ntok > 6) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "campos demais em", tok[0]);
+        r = ms_nl_values(tok, ntok, 3, 3, v, def, 0);
+        if (r != 0) return ms_nl_error(p, MS_NL_ERR_VALUE, "valor invalido", tok[r]);
+        idx = ms_add_diode(c, n[0], n[1], v[0], v[1], v[2]);
+        break;
+    }
+
+    default:
+        return ms_nl_error(p, MS_NL_ERR_UNKNOWN, "elemento desconhecido", tok[0]);
+    }
+
+    if (idx < 0)
+        return ms_nl_error(p, MS_NL_ERR_FULL, "elementos demais em", tok[0]);
+
+    strcpy(p->elem_name[idx], tok[0]);
+    return MS_NL_OK;
+}
+
+// ======================================================
+// DIRETIVAS
+// ======================================================
+
+// .probe V(n) | V(n1,n2) | I(elem)  [ganho offset canal]
+static int ms_nl_probe(ms_netlist_t *p, char *tok[], int ntok)
+{
+    ms_probe_def_t d;
+    int k;
+
+    if (ntok < 5 || tok[2][0] != '(')
+        return ms_nl_error(p, MS_NL_ERR_SYNTAX, "esperado: .probe V(n) | V(a,b) | I(elem)", NULL);
+
+    if (ms_nl_eq(tok[1], "v")) {
+        // A sonda só observa: um nó novo aqui ficaria solto e a matriz singular
+        int a = ms_nl_node_find(p, tok[3]);
+        if (a < 0) return ms_nl_error(p, MS_NL_ERR_REF, "no inexistente", tok[3]);
+        if (tok[4][0] == ')') {
+            d.type = MS_PROBE_NODE; d.a = a; d.b = 0; k = 5;
+        } else {
+            if (ntok < 6 || tok[5][0] != ')')
+                return ms_nl_error(p, MS_NL_ERR_SYNTAX, "esperado: V(a,b)", NULL);
+            int b = ms_nl_node_find(p, tok[4]);
+            if (b < 0) return ms_nl_error(p, MS_NL_ERR_REF, "no inexistente", tok[4]);
+            d.type = MS_PROBE_DIFF; d.a = a; d.b = b; k = 6;
+        }
+    }
+    else if (ms_nl_eq(tok[1], "i")) {
+        if (tok[4][0] != ')')
+            return ms_nl_error(p, MS_NL_ERR_SYNTAX, "esperado: I(elem)", NULL);
+        int e = ms_nl_elem(p, tok[3]);
+        if (e < 0) return ms_nl_error(p, MS_NL_ERR_REF, "elemento inexistente", tok[3]);
+        d.type = MS_PROBE_CURRENT; d.a = e; d.b = 0; k = 5;
+    }
+    else {
+        return ms_nl_error(p, MS_NL_ERR_SYNTAX, "sonda deve ser V(...) ou I(...):", tok[1]);
+    }
+
+    // Padrão: ganho 1, offset 0.5 (zero no meio da escala), próximo canal
+    float v[3];
+    const float def[3] = { 1.0f, 0.5f, (float)p->c->probes };
+    if (ntok - k > 3) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "campos demais em .probe", NULL);
+    int r = ms_nl_values(tok, ntok, k, 3, v, def, 0);
+    if (r != 0) return ms_nl_error(p, MS_NL_ERR_VALUE, "valor invalido", tok[r]);
+
+    d.gain    = v[0];
+    d.offset  = v[1];
+    d.channel = (int)v[2];
+
+    if (ms_add_probe(p->c, &d) < 0)
+        return ms_nl_error(p, MS_NL_ERR_FULL, "sondas demais", NULL);
+    return MS_NL_OK;
+}
+
+static int ms_nl_directive(ms_netlist_t *p, char *tok[], int ntok)
+{
+    ms_circuit_t *c = p->c;
+
+    if (ms_nl_eq(tok[0], ".end")) {
+        p->active = 0;
+        if (p->errors) {
+            snprintf(p->diag, sizeof p->diag, "netlist rejeitada: %d erro(s)", p->errors);
+            return MS_NL_ERR_FAILED;
+        }
+        if (c->elems == 0) {
+            snprintf(p->diag, sizeof p->diag, "netlist vazia");
+            return MS_NL_ERR_FAILED;
+        }
+        snprintf(p->diag, sizeof p->diag, "netlist ok: %d nos, %d elementos, %d sondas",
+                 c->nodes, c->elems, c->probes);
+        return MS_NL_DONE;
+    }
+
+    if (ms_nl_eq(tok[0], ".tran")) {
+        float dt;
+        if (ntok < 2 || ntok > 3) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "esperado: .tran passo [tfinal]", NULL);
+        if (!ms_nl_value(tok[1], &dt) || dt <= 0.0f)
+            return ms_nl_error(p, MS_NL_ERR_VALUE, "passo invalido", tok[1]);
+        c->dt = dt;
+        return MS_NL_OK;
+    }
+
+    if (ms_nl_eq(tok[0], ".solver")) {
+        if (ntok < 2 || ntok > 3) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "esperado: .solver gauss|seidel|sor|lu|cg [rb|jacobi|ic]", NULL);
+        int iterative = ms_nl_eq(tok[1], "seidel") || ms_nl_eq(tok[1], "sor");
+        int cg = ms_nl_eq(tok[1], "cg");
+        if (ntok == 3 && iterative && !ms_nl_eq(tok[2], "rb"))
+            return ms_nl_error(p, MS_NL_ERR_SYNTAX, "esperado: rb", tok[2]);
+        if (ntok == 3 && cg && !ms_nl_eq(tok[2], "jacobi") && !ms_nl_eq(tok[2], "ic"))
+            return ms_nl_error(p, MS_NL_ERR_SYNTAX, "esperado: jacobi ou ic", tok[2]);
+        if (ntok == 3 && !iterative && !cg)
+            return ms_nl_error(p, MS_NL_ERR_SYNTAX, "opcao so com seidel, sor ou cg", tok[2]);
+        if      (ms_nl_eq(tok[1], "gauss"))  ms_set_solver(c, MS_SOLVER_GAUSS);
+        else if (ms_nl_eq(tok[1], "lu"))     ms_set_solver(c, MS_SOLVER_LU);
+        else if (iterative) {
+            ms_set_solver(c, MS_SOLVER_GAUSS_SEIDEL);
+            ms_set_sor(c, ms_nl_eq(tok[1], "sor") ? 0.0f : 1.0f, ntok == 3);
+        }
+        else if (cg) {
+            ms_set_solver(c, MS_SOLVER_CG);
+            ms_set_cg(c, (ntok == 3 && ms_nl_eq(tok[2], "ic")) ? MS_CG_IC0 : MS_CG_JACOBI);
+        }
+        else return ms_nl_error(p, MS_NL_ERR_UNKNOWN, "solver desconhecido", tok[1]);
+        return MS_NL_OK;
+    }
+
+    if (ms_nl_eq(tok[0], ".events")) {
+        if (ntok != 2) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "esperado: .events on|off", NULL);
+        if      (ms_nl_eq(tok[1], "on"))  ms_set_events(c, 1);
+        else if (ms_nl_eq(tok[1], "off")) ms_set_events(c, 0);
+        else return ms_nl_error(p, MS_NL_ERR_SYNTAX, "esperado: .events on|off", tok[1]);
+        return MS_NL_OK;
+    }
+
+    if (ms_nl_eq(tok[0], ".inductor")) {
+        if (ntok != 2) return ms_nl_error(p, MS_NL_ERR_SYNTAX, "esperado: .inductor aux|norton", NULL);
+        if      (ms_nl_eq(tok[1], "norton")) ms_set_inductor_norton(c, 1);
+        else if (ms_nl_eq(tok[1], "aux"))    ms_set_inductor_norton(c, 0);
+        else return ms_nl_error(p, MS_NL_ERR_SYNTAX, "esperado: .inductor aux|norton", tok[1]);
+        return MS_NL_OK;
+    }
+
+    if (ms_nl_eq(tok[0], ".probe"))
+        return ms_nl_probe(p, tok, ntok);
+
+    if (ms_nl_eq(tok[0], ".title"))
+        return MS_NL_OK;
+
+    return ms_nl_error(p, MS_NL_ERR_UNKNOWN, "diretiva desconhecida", tok[0]);
+}
+
+// ======================================================
+// API
+// ======================================================
+
+void ms_netlist_begin(ms_netlist_t *p, ms_circuit_t *c,
+                      volatile float *const *ext, int n_ext)
+{
+    p->c      = c;
+    p->line   = 0;
+    p->errors = 0;
+    p->active = 1;
+    p->nodes  = 0;
+    p->diag[0] = '\0';
+
+    for (int i = 0; i < MS_NL_MAX_EXT; i++)
+        p->ext[i] = (ext && i < n_ext) ? ext[i] : NULL;
+
+    // Começa com um nó; o circuito cresce conforme os nomes aparecem
+    ms_circuit_init(c, 1, MS_NL_DEFAULT_DT);
+}
+
+int ms_netlist_line(ms_netlist_t *p, const char *line)
+{
+    char *tok[MS_NL_MAX_TOKENS];
+
+    p->line++;
+    p->diag[0] = '\0';
+
+    size_t len = strlen(line);
+    if (len >= sizeof p->buf)
+        return ms_nl_error(p, MS_NL_ERR_SYNTAX, "linha longa demais", NULL);
+    memcpy(p->buf, line, len + 1);
+
+    int ntok = ms_nl_tokenize(p->buf, tok, MS_NL_MAX_TOKENS);
+    if (ntok < 0)
+        return ms_nl_error(p, MS_NL_ERR_SYNTAX, "campos demais", NULL);
+    if (ntok == 0 || tok[0][0] == '*')
+        return MS_NL_OK;                        // linha vazia ou comentário
+
+    if (tok[0][0] == '.')
+        return ms_nl_directive(p, tok, ntok);
+
+    return ms_nl_element(p, tok, ntok);
+}
+
+const char *ms_netlist_status_str(int status)
+{
+    switch (status) {
+        case MS_NL_OK:          return "OK";
+        case MS_NL_DONE:        return "Netlist completa";
+        case MS_NL_ERR_SYNTAX:  return "Erro de sintaxe";
+        case MS_NL_ERR_VALUE:   return "Valor invalido";
+        case MS_NL_ERR_NODES:   return "Nos demais";
+        case MS_NL_ERR_FULL:    return "Elementos ou sondas demais";
+        case MS_NL_ERR_REF:     return "Referencia invalida";
+        case MS_NL_ERR_UNKNOWN: return "Elemento ou diretiva desconhecida";
+        case MS_NL_ERR_FAILED:  return "Netlist rejeitada";
+        default:                return "Status desconhecido";
+    }
+}
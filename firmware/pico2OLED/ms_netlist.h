@@ -0,0 +1,117 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Carregador de netlist em tempo de execução (subconjunto SPICE).
+ * O texto chega linha a linha (USB/UART) e cada linha é convertida
+ * diretamente em chamadas ms_add_* sobre um ms_circuit_t, sem alocação
+ * dinâmica. Erros geram uma mensagem de diagnóstico com o número da
+ * linha; o circuito só é considerado pronto quando chega ".end" sem
+ * erros.
+ *
+ * Sintaxe suportada (maiúsculas ou minúsculas, '*' inicia comentário de
+ * linha e ';' comentário no fim da linha):
+ *
+ *   Rxxx n1 n2 valor              Lxxx n1 n2 valor       Cxxx n1 n2 valor
+ *   Vxxx n+ n- [DC] valor         Ixxx n+ n- [DC] valor
+ *   Vxxx n+ n- SIN(vo va freq [td theta fase_graus])
+ *   Vxxx n+ n- PULSE(v1 v2 td tr tf pw per)
+ *   Vxxx n+ n- EXT(entrada ganho offset)   ; entrada: 0=adc0 1=adc1 2=adc2 3=io0
+ *                                          4=io1 5=io2 6=io3 (io0..3 = GPIO6..9)
+ *                                          7..10=duty0..3 (razão cíclica medida)
+ *   Exxx n+ n- nc+ nc- ganho      Gxxx n+ n- nc+ nc- ganho
+ *   Fxxx n+ n- Vctrl ganho        Hxxx n+ n- Vctrl transresistencia
+ *   Sxxx n1 n2 nc+ nc- [ron roff vth]
+ *   Dxxx anodo catodo [ron roff vf]
+ *   Sxxx n1 n2 nc+ nc- ADC(gs [theta]) [vth]     Dxxx anodo catodo ADC(gs [theta])
+ *        chave/diodo de admitância constante (ms_add_adc_switch): a
+ *        matriz não muda ao comutar (com .solver lu é fatorada uma vez)
+ *   Axxx a p c duty [L fsw]       Axxx a p c EXT(entrada ganho offset) [L fsw]
+ *        célula PWM média (ms_add_avg_switch): a = chave, p = diodo,
+ *        c = comum (indutor); L e fsw ligam o modelo DCM
+ *
+ *   .tran passo [tfinal]          .solver gauss|seidel|lu
+ *   .solver sor                   (Gauss-Seidel com omega estimado, em
+ *                                 vermelho-preto quando possível, ms_set_sor)
+ *   .solver seidel rb             (Gauss-Seidel simples em vermelho-preto)
+ *   .solver cg [jacobi|ic]        (gradiente conjugado em circuitos só com
+ *                                 condutâncias e fontes ao terra, ms_set_cg)
+ *   .events on|off                (comutação dentro do passo, ms_set_events)
+ *   .inductor aux|norton          (indutores sem linha auxiliar, ms_set_inductor_norton)
+ *   .probe V(n) [ganho offset canal]
+ *   .probe V(n1,n2) [ganho offset canal]
+ *   .probe I(elemento) [ganho offset canal]
+ *   .end
+ *
+ * Valores aceitam sufixos SPICE (f p n u m k meg g t). Os nós são nomes:
+ * "0" e "gnd" são o terra e os demais recebem números na ordem em que
+ * aparecem (ver ms_list_elements). O canal de .probe é o canal do PWMDAC
+ * (0 => GP14 ... 7 => GP21); -1 mantém a sonda só para leitura. Sondas
+ * só referenciam nós e elementos já definidos em linhas anteriores.
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#ifndef MS_NETLIST_H
+#define MS_NETLIST_H
+
+#include "mini_spiceHILv3.h"
+
+// ======================================================
+// CONFIGURAÇÕES
+// ======================================================
+
+#define MS_NL_LINE_LEN      96      // maior linha aceita
+#define MS_NL_NAME_LEN      8       // nomes de nós/elementos (com '\0')
+#define MS_NL_MAX_TOKENS    20
+#define MS_NL_MAX_EXT       11      // entradas externas (EXT)
+#define MS_NL_DIAG_LEN      80
+
+// ======================================================
+// DIAGNÓSTICO
+// ======================================================
+
+typedef enum {
+    MS_NL_OK          =  0,     // linha aceita
+    MS_NL_DONE        =  1,     // .end recebido sem erros: circuito pronto
+    MS_NL_ERR_SYNTAX  = -1,     // número de campos ou formato inválido
+    MS_NL_ERR_VALUE   = -2,     // valor numérico inválido
+    MS_NL_ERR_NODES   = -3,     // nós demais para MS_MAX_NODES
+    MS_NL_ERR_FULL    = -4,     // elementos ou sondas demais
+    MS_NL_ERR_REF     = -5,     // referência a elemento ou nó inexistente
+    MS_NL_ERR_UNKNOWN = -6,     // elemento ou diretiva desconhecida
+    MS_NL_ERR_FAILED  = -7      // .end recebido, mas houve erros antes
+} ms_netlist_status_t;
+
+// ======================================================
+// ESTADO DO CARREGADOR
+// ======================================================
+
+typedef struct {
+    ms_circuit_t *c;                            // circuito em construção
+    volatile float *ext[MS_NL_MAX_EXT];         // entradas para fontes EXT
+
+    int line;                                   // linha atual (1..)
+    int errors;                                 // erros desde o início
+    int active;                                 // recebendo uma netlist
+
+    int  nodes;                                 // nós nomeados
+    char node_name[MS_MAX_NODES][MS_NL_NAME_LEN];
+    char elem_name[MS_MAX_ELEMS][MS_NL_NAME_LEN];
+
+    char buf[MS_NL_LINE_LEN];                   // cópia tokenizada da linha
+    char diag[MS_NL_DIAG_LEN];                  // último diagnóstico
+} ms_netlist_t;
+
+// Inicia uma netlist nova sobre o circuito c (que é reinicializado).
+// ext[] são as entradas associadas a EXT(0..n_ext-1).
+void ms_netlist_begin(ms_netlist_t *p, ms_circuit_t *c,
+                      volatile float *const *ext, int n_ext);
+
+// Processa uma linha (sem '\n'). Retorna ms_netlist_status_t; em caso de
+// erro, p->diag contém a mensagem.
+int ms_netlist_line(ms_netlist_t *p, const char *line);
+
+const char *ms_netlist_status_str(int status);
+
+#endif // MS_NETLIST_H
@@ -42,6 +42,9 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
 #include <math.h>
 #include "pico/stdlib.h"
 #include "hardware/adc.h"
@@ -52,20 +55,25 @@
 #include "hardware/uart.h"
 #include "hardware/pwm.h"
 #include "hardware/watchdog.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
 #include "pico/multicore.h"
+#include "pico/flash.h"
 #include "mini_spiceHILv3.h"
+#include "ms_netlist.h"
+#include "ms_image.h"
+#include "pwmdac.h"
+#include "telemetry.h"
+#include "capture.h"
+#include "scope.h"
+#include "hil_sync.h"
+#include "hil_log.h"
+#include "gpio_edge.h"
 #include "ssd1306/ssd1306.h"
 
 void core1_entry();
 extern void benchmark_matrices();
-
-void setup_pwm(uint pin, uint chan, uint duty) {
-    gpio_set_function(pin, GPIO_FUNC_PWM);
-    uint slice = pwm_gpio_to_slice_num(pin);
-    pwm_set_wrap(slice, PWM_WRAP);
-    pwm_set_chan_level(slice, chan, duty);
-    pwm_set_enabled(slice, true);
-}
+extern void benchmark_step_jitter(ms_circuit_t *c, int steps);
 
 uint32_t millis() {
     return to_ms_since_boot(get_absolute_time());
@@ -114,11 +122,494 @@ extern void setup_circuit(ms_circuit_t *c, volatile float *adc_in, volatile floa
 extern void output_circuit(ms_circuit_t *c);
 extern void update_sources(ms_circuit_t *c, volatile float *adc_in, volatile float *io_in);
 ms_circuit_t circuit;
+// Memória das matrizes do circuito ativo (ms_circuit_finalize). 16 KB
+// cobrem A e a LU de um sistema de até ~45 incógnitas; o pior caso
+// (MS_MEM_MAX_BYTES) passa de 50 KB. Sistemas de até ~13 incógnitas usam
+// a memória rápida no scratch Y, fora da SRAM principal que o core1 usa
+// com o display e o console.
+#define HIL_CIRCUIT_MEM_BYTES   (16u * 1024u)
+#define HIL_CIRCUIT_FAST_BYTES  1536u
+static float circuit_mem[HIL_CIRCUIT_MEM_BYTES / sizeof(float)];
+
+// Scratch Y (4 KB): a arena rápida fica na base e a pilha do core0 desce
+// do topo até ela, sem proteção. Sobram 4096 - 1536 - 32 = 2528 bytes de
+// pilha. O caminho mais fundo do passo (ms_circuit_step > ms_step_once >
+// ms_solve > ms_cg_solve) usa cerca de 1,4 KB; só ms_solve tem 640 bytes
+// de br/xr (MS_MAX_SIZE = 80). Somando o quadro do main (hil_snapshot_t,
+// ~350 bytes) e as interrupções do core0 (USB, gpio_edge), a folga é de
+// algumas centenas de bytes. O canário entre a arena e a pilha acusa
+// quando a pilha chegou a ela (stack_canary_ok, verificado no loop
+// principal).
+#define HIL_STACK_CANARY        0xC0DEF00Du
+#define HIL_STACK_CANARY_WORDS  8
+static struct {
+    float    mem[HIL_CIRCUIT_FAST_BYTES / sizeof(float)];
+    uint32_t canary[HIL_STACK_CANARY_WORDS];   // acima da arena, abaixo da pilha
+} circuit_fast MS_SCRATCH_DATA;
+
+static void stack_canary_init(void)
+{
+    for (int i = 0; i < HIL_STACK_CANARY_WORDS; i++)
+        circuit_fast.canary[i] = HIL_STACK_CANARY;
+}
+
+static bool stack_canary_ok(void)
+{
+    for (int i = 0; i < HIL_STACK_CANARY_WORDS; i++)
+        if (circuit_fast.canary[i] != HIL_STACK_CANARY) return false;
+    return true;
+}
+
+static int circuit_bind(ms_circuit_t *c)
+{
+    if (ms_circuit_mem_size(c) <= sizeof circuit_fast.mem)
+        return ms_circuit_finalize(c, circuit_fast.mem, sizeof circuit_fast.mem);
+    return ms_circuit_finalize(c, circuit_mem, sizeof circuit_mem);
+}
 volatile float adc0_val, adc1_val, adc2_val;
-volatile float io0_val;
+volatile float io0_val, io1_val, io2_val, io3_val;      // GPIO6..GPIO9
+volatile float duty0_val, duty1_val, duty2_val, duty3_val;  // razão medida
+
+// Entradas digitais na ordem de gpio_edge_t.input
+static volatile float *const io_inputs[GPIO_EDGE_PIN_COUNT] = {
+    &io0_val, &io1_val, &io2_val, &io3_val
+};
+static volatile float *const duty_inputs[GPIO_EDGE_PIN_COUNT] = {
+    &duty0_val, &duty1_val, &duty2_val, &duty3_val
+};
+
+// Estado do core0 publicado a cada passo para o core1 (seqlock): o core1
+// sempre lê uma versão consistente e o core0 nunca espera.
+typedef struct {
+    uint32_t step;              // passos desde o início
+    float    t;                 // tempo de simulação
+    int      status;            // retorno de ms_circuit_step()
+    uint32_t step_cost_us;      // custo do último passo
+    uint32_t overruns;          // passos iniciados com mais de 1 dt de atraso
+    int      size;              // entradas válidas em x[]
+    float    x[MS_MAX_SIZE];    // solução do último passo
+} hil_snapshot_t;
+
+static hil_seqlock_t  snapshot_lock;
+static hil_snapshot_t snapshot_pub;
+
+// core0: publica só a parte usada de x[]
+static void snapshot_publish(const hil_snapshot_t *s)
+{
+    hil_seq_write(&snapshot_lock, &snapshot_pub, s,
+                  offsetof(hil_snapshot_t, x) + (size_t)s->size * sizeof(float));
+}
+
+// core1
+static void snapshot_read(hil_snapshot_t *s)
+{
+    hil_seq_read(&snapshot_lock, s, &snapshot_pub, sizeof *s);
+}
+
+// Entradas disponíveis para fontes EXT(0..10) da netlist e das imagens
+static volatile float *const ext_inputs[MS_NL_MAX_EXT] = {
+    &adc0_val, &adc1_val, &adc2_val, &io0_val, &io1_val, &io2_val, &io3_val,
+    &duty0_val, &duty1_val, &duty2_val, &duty3_val
+};
+
+// Nível atual das entradas digitais (início ou bordas perdidas); no
+// resto do tempo elas mudam só pelas bordas capturadas (gpio_edge.h)
+static void io_inputs_resync(void)
+{
+    for (int i = 0; i < GPIO_EDGE_PIN_COUNT; i++)
+        *io_inputs[i] = (float)gpio_get(GPIO_EDGE_PIN_FIRST + i);
+}
+
+// Circuito ativo não veio do circuit.c (serial ou flash): as fontes do
+// exemplo compilado não devem ser atualizadas.
+static bool circuit_runtime = false;
+
+// ======================================================
+// CARGA DE CIRCUITO DA FLASH (SLOT SELECIONADO POR !boot)
+// ======================================================
+// O slot de partida fica gravado no setor MS_IMG_BOOT_OFFSET (ms_image.h):
+// 0 ou setor apagado mantém o circuito compilado, 1..3 carregam a imagem
+// do slot. GP6..GP9 são entradas do DUT, então a escolha não usa straps.
+#define BOOT_SEL_MAGIC  0x544F4F42u     // "BOOT"
+
+typedef struct {
+    uint32_t magic;                     // BOOT_SEL_MAGIC
+    uint32_t slot;                      // 0..MS_IMG_SLOTS
+    uint32_t check;                     // ~slot
+} boot_sel_t;
+
+static int circuit_boot_slot(void)
+{
+    const boot_sel_t *sel = (const boot_sel_t *)(uintptr_t)(XIP_BASE +
+                            MS_IMG_BOOT_OFFSET(PICO_FLASH_SIZE_BYTES));
+
+    if (sel->magic != BOOT_SEL_MAGIC || sel->check != ~sel->slot ||
+        sel->slot > MS_IMG_SLOTS)
+        return 0;
+    return (int)sel->slot;
+}
+
+// Roda com o core0 travado pelo flash_safe_execute (sem XIP nos dois cores)
+static void boot_sel_program(void *page)
+{
+    uint32_t off = MS_IMG_BOOT_OFFSET(PICO_FLASH_SIZE_BYTES);
+    flash_range_erase(off, FLASH_SECTOR_SIZE);
+    flash_range_program(off, (const uint8_t *)page, FLASH_PAGE_SIZE);
+}
+
+static int circuit_boot_slot_store(int slot)
+{
+    static uint8_t page[FLASH_PAGE_SIZE];
+    boot_sel_t sel = { BOOT_SEL_MAGIC, (uint32_t)slot, ~(uint32_t)slot };
+
+    memset(page, 0xFF, sizeof page);
+    memcpy(page, &sel, sizeof sel);
+    return flash_safe_execute(boot_sel_program, page, 100);
+}
+
+static bool circuit_load_slot(ms_circuit_t *c, int slot)
+{
+    const void *img = (const void *)(uintptr_t)(XIP_BASE +
+                      MS_IMG_SLOT_OFFSET(PICO_FLASH_SIZE_BYTES, slot));
+
+    uint64_t t0 = micros();
+    int st = ms_image_load(c, img, MS_IMG_SLOT_SIZE, ext_inputs, MS_NL_MAX_EXT);
+    uint32_t cost = (uint32_t)(micros() - t0);
+
+    if (st != MS_IMG_OK) {
+        printf("Slot %d: %s (%d), usando circuito compilado\n",
+               slot, ms_image_status_str(st), st);
+        return false;
+    }
+    printf("Slot %d: '%.*s' carregado em %luus\n", slot, MS_IMG_NAME_LEN,
+           ((const ms_img_header_t *)img)->name, cost);
+    return true;
+}
+
+// Circuito de partida: imagem do slot ou o exemplo compilado do circuit.c
+static void circuit_boot(int slot)
+{
+    if (slot > 0 && circuit_load_slot(&circuit, slot))
+        circuit_runtime = true;
+    else
+        setup_circuit(&circuit, &adc0_val, &io0_val);
+    if (circuit_bind(&circuit) != 0)
+        printf("Circuito: %u bytes de matrizes, max %u\n",
+               (unsigned)ms_circuit_mem_size(&circuit), (unsigned)sizeof circuit_mem);
+}
+
+// ======================================================
+// CONSOLE SERIAL (USB) - RODA NO CORE1
+// ======================================================
+// Linhas iniciadas por '!' são comandos; as demais formam uma netlist.
+// A netlist é montada em um circuito separado enquanto o circuito ativo
+// continua rodando; ao receber ".end" sem erros ela é entregue ao core0,
+// que faz a troca entre dois passos.
+static ms_circuit_t circuit_rx;
+static ms_netlist_t netlist;
+static volatile bool circuit_rx_ready = false;     // core1 -> core0
+static volatile float presim_request = 0.0f;       // core1 -> core0: segundos a pré-simular
+static char console_line[MS_NL_LINE_LEN];
+static int  console_len;
+static bool console_overflow;       // linha passou de MS_NL_LINE_LEN - 1
+
+static const char *const capture_state_str[] = {
+    "desarmada", "armada", "disparada", "pronta"
+};
+
+// !cap <p0..p7|adc0..adc2|io0> <rise|fall|high|low> <nivel> [pre] [pos]
+// !cap dump  |  !cap off  |  !cap
+static void console_capture(char *arg)
+{
+    static const char *const modes[] = { "rise", "fall", "high", "low" };
+    char src[8], mode[8];
+    float level;
+    unsigned long pre = CAPTURE_DEPTH / 4, post = CAPTURE_DEPTH - CAPTURE_DEPTH / 4 - 1;
+
+    while (*arg == ' ') arg++;
+    if (*arg == '\0') {
+        printf("cap: %s\n", capture_state_str[capture_state()]);
+        return;
+    }
+    if (strncmp(arg, "off", 3) == 0) {
+        capture_disarm();
+        printf("cap: desarmada\n");
+        return;
+    }
+    if (strncmp(arg, "dump", 4) == 0) {
+        uint32_t sat[CAPTURE_MAX_CH];
+        int n = capture_dump(sat);
+        if (n == 0) printf("cap: nada para despejar (%s)\n", capture_state_str[capture_state()]);
+        // Fora de 0..1 depois de ganho/offset o despejo corta no limite
+        for (int i = 0; i < CAPTURE_MAX_CH; i++)
+            if (sat[i])
+                printf("cap: sonda %d saturada em %lu de %d amostras (ajuste ganho/offset)\n",
+                       i, (unsigned long)sat[i], n);
+        return;
+    }
+
+    if (sscanf(arg, "%7s %7s %f %lu %lu", src, mode, &level, &pre, &post) < 3) {
+        printf("cap: uso !cap <p0..p7|adc0..2|io0> <rise|fall|high|low> <nivel> [pre] [pos]\n");
+        return;
+    }
+
+    const volatile float *s = NULL;
+    if (src[0] == 'p' && src[1] >= '0' && src[1] < '0' + circuit.probes && src[2] == '\0')
+        s = &circuit.probe[src[1] - '0'].value;
+    else if (strncmp(src, "adc", 3) == 0 && src[3] >= '0' && src[3] <= '2' && src[4] == '\0')
+        s = ext_inputs[src[3] - '0'];
+    else if (strcmp(src, "io0") == 0)
+        s = ext_inputs[3];
+
+    int m = 0;
+    while (m < 4 && strcmp(mode, modes[m]) != 0) m++;
+
+    int st = (s == NULL || m == 4) ? -1 :
+             capture_arm(s, (capture_mode_t)m, level, (uint32_t)pre, (uint32_t)post);
+    if (st == -2) {
+        printf("cap: pedido anterior ainda nao aplicado, repita\n");
+        return;
+    }
+    if (st != 0) {
+        printf("cap: parametros invalidos (pre + 1 + pos <= %d)\n", CAPTURE_DEPTH);
+        return;
+    }
+    printf("cap: armada em %s %s %g, pre %lu, pos %lu\n", src, modes[m], level, pre, post);
+}
+
+// !scope on|off
+// !scope ch <sonda> [sonda ...]                  (até 4 traços)
+// !scope tb <passos por coluna>
+// !scope trig <traço 1..4> <rise|fall|off> <nivel> [auto|normal]
+static void console_scope(char *arg)
+{
+    char *end;
+
+    while (*arg == ' ') arg++;
+    if (strncmp(arg, "on", 2) == 0 || strncmp(arg, "off", 3) == 0) {
+        scope_enable(arg[1] == 'n');
+        printf("scope: %s\n", scope.enabled ? "ligado" : "desligado");
+        return;
+    }
+    if (strncmp(arg, "ch", 2) == 0) {
+        uint8_t probe[SCOPE_MAX_TRACES];
+        int n = 0;
+        arg += 2;
+        while (n < SCOPE_MAX_TRACES) {
+            while (*arg == ' ' || *arg == 'p') arg++;
+            unsigned long v = strtoul(arg, &end, 10);
+            if (end == arg) break;
+            probe[n++] = (uint8_t)v;
+            arg = end;
+        }
+        if (scope_set_channels(probe, n, &circuit) != 0)
+            printf("scope: sondas invalidas (0..%d)\n", circuit.probes - 1);
+        return;
+    }
+    if (strncmp(arg, "tb", 2) == 0) {
+        if (scope_set_timebase((uint32_t)strtoul(arg + 2, NULL, 0)) != 0)
+            printf("scope: base de tempo invalida\n");
+        return;
+    }
+    if (strncmp(arg, "trig", 4) == 0) {
+        char edge[8] = "rise", mode[8] = "auto";
+        int trace = 1;
+        float level = 0.0f;
+        sscanf(arg + 4, "%d %7s %f %7s", &trace, edge, &level, mode);
+        scope_edge_t e = !strcmp(edge, "fall") ? SCOPE_TRIG_FALL :
+                         !strcmp(edge, "off")  ? SCOPE_TRIG_OFF  : SCOPE_TRIG_RISE;
+        if (scope_set_trigger(trace - 1, e, level, strcmp(mode, "normal") != 0) != 0)
+            printf("scope: traco invalido\n");
+        return;
+    }
+    printf("scope: %s, %lu tracos, %lu amostras perdidas\n",
+           scope.enabled ? "ligado" : "desligado",
+           (unsigned long)scope.ntraces, (unsigned long)scope.dropped);
+}
+
+// !stream <decim> [mascara]  |  !stream off
+static void console_command(char *cmd)
+{
+    char *arg = cmd + 1;
+    char *end;
+
+    if (strncmp(arg, "stream", 6) == 0) {
+        arg += 6;
+        while (*arg == ' ') arg++;
+        if (strncmp(arg, "off", 3) == 0) {
+            hil_snapshot_t snap;
+            snapshot_read(&snap);
+            telemetry_stop();
+            printf("stream: parado (%lu amostras perdidas, %lu passos atrasados)\n",
+                   (unsigned long)telemetry.dropped, (unsigned long)snap.overruns);
+            return;
+        }
+        uint32_t decim = (uint32_t)strtoul(arg, &end, 0);
+        uint32_t mask  = (end != arg) ? (uint32_t)strtoul(end, &end, 0) : 0;
+        if (mask == 0) mask = ~0u;              // todas, também após trocar de circuito
+        if (decim == 0) decim = 1;
+        printf("stream: decim %lu, sondas 0x%02lx\n",
+               (unsigned long)decim, (unsigned long)telemetry_mask(&circuit, mask));
+        telemetry_start(decim, mask);
+        return;
+    }
+
+    if (strncmp(arg, "cap", 3) == 0) {
+        console_capture(arg + 3);
+        return;
+    }
+
+    if (strncmp(arg, "scope", 5) == 0) {
+        console_scope(arg + 5);
+        return;
+    }
+
+    // !presim <segundos>: avança o circuito mais rápido que o tempo real
+    if (strncmp(arg, "presim", 6) == 0) {
+        float secs = strtof(arg + 6, NULL);
+        if (secs <= 0.0f) {
+            printf("presim: uso !presim <segundos>\n");
+            return;
+        }
+        printf("presim: %g s com passo adaptativo...\n", secs);
+        presim_request = secs;
+        return;
+    }
+
+    // !boot [0..3]: slot carregado no próximo reset (0 = circuit.c)
+    if (strncmp(arg, "boot", 4) == 0) {
+        long slot = strtol(arg + 4, &end, 0);
+        if (end == arg + 4) {
+            printf("boot: slot %d\n", circuit_boot_slot());
+            return;
+        }
+        if (slot < 0 || slot > MS_IMG_SLOTS) {
+            printf("boot: uso !boot <0..%d>\n", MS_IMG_SLOTS);
+            return;
+        }
+        // O core0 fica parado durante o apagamento do setor
+        int rc = circuit_boot_slot_store((int)slot);
+        if (rc != PICO_OK)
+            printf("boot: falha ao gravar a flash (%d)\n", rc);
+        else
+            printf("boot: slot %ld no proximo reset\n", slot);
+        return;
+    }
+
+    printf("comando desconhecido: %s\n", cmd);
+}
+
+// Entrega circuit_rx ao core0. A cópia "circuit = circuit_rx" não é
+// atômica: telemetria, captura e scope leem o circuito ativo (sondas,
+// definições, dt), então param antes e o core1 espera a troca terminar
+// sem tocar em circuit. A telemetria volta sozinha, com as sondas novas.
+static void circuit_handoff(void)
+{
+    bool     stream = telemetry.enabled;
+    uint32_t decim  = telemetry.decim, mask = telemetry.req_mask;
+
+    // As sondas mudam com o circuito: reconfigurar com !scope ch e !cap
+    scope_enable(false);
+    telemetry_stop();
+    capture_disarm();           // aplicado pelo core0 já com o circuito novo
+    __dmb();
+    circuit_rx_ready = true;
+    while (circuit_rx_ready)
+        tight_loop_contents();
+    __dmb();
+
+    if (stream) telemetry_start(decim, mask);
+}
+
+static void console_poll(void)
+{
+    int ch;
+
+    while ((ch = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+        if (ch != '\n' && ch != '\r') {
+            if (console_len < MS_NL_LINE_LEN - 1)
+                console_line[console_len++] = (char)ch;
+            else
+                console_overflow = true;
+            continue;
+        }
+        // Linha truncada mudaria o significado: descarta inteira. Dentro
+        // de uma netlist conta como erro, para o .end rejeitá-la.
+        if (console_overflow) {
+            console_overflow = false;
+            console_len = 0;
+            if (netlist.active) netlist.errors++;
+            printf("console: linha com mais de %d caracteres, descartada\n",
+                   MS_NL_LINE_LEN - 1);
+            continue;
+        }
+        if (console_len == 0) continue;
+        console_line[console_len] = '\0';
+        console_len = 0;
+
+        if (console_line[0] == '!') {
+            console_command(console_line);
+            continue;
+        }
+
+        if (!netlist.active) {
+            ms_netlist_begin(&netlist, &circuit_rx, ext_inputs, MS_NL_MAX_EXT);
+            printf("netlist: recebendo...\n");
+        }
+
+        int st = ms_netlist_line(&netlist, console_line);
+        if (st < 0) {
+            printf("netlist: %s\n", netlist.diag);
+        } else if (st == MS_NL_DONE) {
+            printf("netlist: %s\n", netlist.diag);
+            size_t need = ms_circuit_mem_size(&circuit_rx);
+            if (need > sizeof circuit_mem) {
+                printf("netlist: sistema %d precisa de %u bytes de matrizes (max %u), descartada\n",
+                       circuit_rx.system_size, (unsigned)need, (unsigned)sizeof circuit_mem);
+                continue;
+            }
+            ms_list_elements(&circuit_rx);
+            circuit_handoff();
+        }
+    }
+}
+
+// ======================================================
+// PRÉ-SIMULAÇÃO (CORE0)
+// ======================================================
+// Avança "secs" de tempo simulado o mais rápido possível, com passo
+// adaptativo (LTE) entre dt/10 e 100*dt, por exemplo para passar o
+// transitório de partida antes de entrar em tempo real. As entradas
+// externas ficam congeladas nos últimos valores lidos.
+#define PRESIM_DT_MIN_DIV   10.0f
+#define PRESIM_DT_MAX_MUL   100.0f
+
+static void presim_run(ms_circuit_t *c, float secs)
+{
+    static ms_adaptive_t ad;
+    float dt_fixed = c->dt;
+    float done = 0.0f;
+    int status = 0;
+    uint64_t t0 = micros();
 
-volatile uint32_t    u32_circuitStepCost_cpu1;
-volatile int i_circuitStatus;
+    ms_adaptive_init(&ad, dt_fixed / PRESIM_DT_MIN_DIV, dt_fixed * PRESIM_DT_MAX_MUL);
+    ad.dt = dt_fixed;
+
+    while (done < secs) {
+        watchdog_update();
+        float t_before = c->t;
+        status = ms_circuit_step_adaptive(c, &ad);
+        if (status != 0) break;
+        if (!circuit_runtime)
+            update_sources(c, &adc0_val, &io0_val);
+        done += c->t - t_before;
+        if (c->t >= 10.0f) c->t = 0.0f;         // mesmo reinício do laço principal
+    }
+    c->dt = dt_fixed;
+
+    HIL_LOG("presim: %lu passos (%lu rejeitados) em %lu ms, status %d\n",
+            ad.accepted, ad.rejected, (uint32_t)((micros() - t0) / 1000), status);
+}
 
 int main()
 {
@@ -140,8 +631,13 @@ int main()
     gpio_set_function(UART_TX_PIN, GPIO_FUNC_UART);
     gpio_set_function(UART_RX_PIN, GPIO_FUNC_UART);
 
-    // Lança core1 
+    // Lança core1 (display, console e telemetria)
+    telemetry_init();
+    scope_init();
+    hil_log_init();
     multicore_launch_core1(core1_entry);
+    // O core1 grava a flash (!boot): o core0 precisa aceitar ser travado
+    flash_safe_execute_core_init();
 
     // Use some the various UART functions to send out data
     // In a default system, printf will also output via the default UART  
@@ -157,15 +653,8 @@ int main()
     adc_gpio_init(27); // ADC1
     adc_gpio_init(28); // ADC2
 
-    // ✅ Configura todos os PWMs para a PCB.
-    setup_pwm(14, PWM_CHAN_A, 0); // PWM7A
-    setup_pwm(15, PWM_CHAN_B, 0); // PWM7B
-    setup_pwm(16, PWM_CHAN_A, 0); // PWM0A
-    setup_pwm(17, PWM_CHAN_B, 0); // PWM0B
-    setup_pwm(18, PWM_CHAN_A, 0); // PWM1A
-    setup_pwm(19, PWM_CHAN_B, 0); // PWM1B
-    setup_pwm(20, PWM_CHAN_A, 0); // PWM2A
-    setup_pwm(21, PWM_CHAN_B, 0); // PWM2B
+    // ✅ Configura todos os PWMs para a PCB (GP14..GP21) com saída via DMA.
+    pwmdac_init(PWM_WRAP);
 
     // Interpolator example code
     interp_config cfg = interp_default_config();
@@ -194,15 +683,29 @@ int main()
     // ✅ Benchmark inicial
     benchmark_matrices();
 
-    // ✅ Configura circuito RLC
-    setup_circuit(&circuit, &adc0_val, &io0_val);
+    stack_canary_init();
+
+    // ✅ Configura circuito: imagem da flash (slot gravado por !boot) ou o
+    // exemplo compilado do circuit.c
+    int slot = circuit_boot_slot();
+    circuit_boot(slot);
+
+#if HIL_BENCH_AT_BOOT
+    // ✅ Jitter do passo com o circuito montado (-DHIL_BENCH_AT_BOOT=ON);
+    // depois recarrega, porque o benchmark avança a simulação
+    benchmark_step_jitter(&circuit, 2000);
+    circuit_boot(slot);
+#endif
 
     // Depois de montar o circuito exibe.
     ms_list_elements(&circuit);
     // 
-    int status;
+    int status = 0;
+    hil_snapshot_t snap = { 0 };
     uint32_t blink_update = millis();
     uint64_t last_step = micros();
+    uint32_t edges_dropped = gpio_edge_dropped();
+    io_inputs_resync();
     while (true) {
         watchdog_update();
         // Leitura ADC0 e normalizacao
@@ -215,24 +718,80 @@ int main()
         adc_select_input(2);
         adc2_val = (float)adc_read() / 4095.0f;
 
-        io0_val =  (float)gpio_get(GPIO6_INPUT);
+        // Netlist nova recebida pelo core1: troca entre dois passos e
+        // reinicia a base de tempo
+        if (circuit_rx_ready) {
+            circuit = circuit_rx;
+            circuit_bind(&circuit);
+            circuit_runtime = true;
+            telemetry_circuit_changed();
+            __dmb();
+            circuit_rx_ready = false;
+            last_step = micros();
+        }
        
+        // Pré-simulação pedida pelo console: o tempo real recomeça depois
+        if (presim_request > 0.0f) {
+            presim_run(&circuit, presim_request);
+            presim_request = 0.0f;
+            last_step = micros();
+        }
+
         // Controle de passo em tempo real
         uint64_t circuit_stepcost, now = micros();
         if (now - last_step >= (uint64_t)(circuit.dt * 1e6)) {
+            if (now - last_step >= 2 * (uint64_t)(circuit.dt * 1e6))
+                snap.overruns++;
             last_step += (uint64_t)(circuit.dt * 1e6); // avanço fixo
             //last_step = now;
 
+            // Publica as saídas calculadas no passo anterior: entram no
+            // próximo wrap do PWM, sempre exatamente um passo depois.
+            pwmdac_commit();
+
+            // Bordas de GPIO6..9 do intervalo que acabou de passar: com
+            // eventos cada uma divide o passo no instante em que ocorreu
+            uint32_t dt_us = (uint32_t)(circuit.dt * 1e6f);
+            uint32_t win_end = (uint32_t)last_step;
+            gpio_edge_t edge;
+            while (gpio_edge_take(win_end, &edge)) {
+                int32_t rel = (int32_t)(edge.t_us - (win_end - dt_us));
+                if (rel < 0) rel = 0;       // atrasada: vale no início do passo
+                ms_ext_edge(&circuit, io_inputs[edge.input], (float)rel * 1e-6f,
+                            (float)edge.level);
+            }
+            if (gpio_edge_dropped() != edges_dropped) {
+                edges_dropped = gpio_edge_dropped();
+                io_inputs_resync();
+            }
+            // Razão cíclica medida, para a célula PWM média
+            for (int i = 0; i < GPIO_EDGE_PIN_COUNT; i++) {
+                float d = gpio_edge_duty(i, win_end);
+                *duty_inputs[i] = (d < 0.0f) ? *io_inputs[i] : d;
+            }
+
             // Passo de simulação
             gpio_put(GPIO22_MONITOR_OUTPUT, true);
             uint64_t step_start = micros();
             status = ms_circuit_step(&circuit);
-            // Para o exemplo setup_three_phase_rl2()
-            update_sources(&circuit, &adc0_val, &io0_val);
+            // Para o exemplo setup_three_phase_rl2(); uma netlist
+            // carregada pela serial não usa as fontes do exemplo.
+            if (!circuit_runtime)
+                update_sources(&circuit, &adc0_val, &io0_val);
             output_circuit(&circuit);
+            telemetry_push(&circuit);
+            capture_push(&circuit);
+            scope_push(&circuit);
             circuit_stepcost = micros() - step_start;
             gpio_put(GPIO22_MONITOR_OUTPUT, false);
-            u32_circuitStepCost_cpu1 = (uint32_t)circuit_stepcost;
+
+            snap.step++;
+            snap.t            = circuit.t;
+            snap.status       = status;
+            snap.step_cost_us = (uint32_t)circuit_stepcost;
+            snap.size         = circuit.system_size;
+            memcpy(snap.x, circuit.x, (size_t)snap.size * sizeof(float));
+            snapshot_publish(&snap);
         }
 
         if (circuit.t >= 10.0f) circuit.t = 0.0f;       
@@ -248,28 +807,46 @@ int main()
         if(now_millis - blink_update > 250)
         {   blink_update = now_millis;
             gpio_put(LED_PIN, !gpio_get(LED_PIN));
-            
+            //multicore_fifo_push_timeout_us(now_millis, 1000);
+
+            // Com a telemetria ativa a USB fica com os quadros binários
+            if (telemetry.enabled) continue;
+
+            // Log diferido: o core0 só grava registros; o core1 formata e
+            // envia pela USB (hil_log_task), sem travar o passo
             if (status != 0) {
-                printf("Falha na simulação (código %d): %s\n",
+                HIL_LOG("Falha na simulação (código %d): %s\n",
                 status, ms_system_status_str(status));
             }
-            i_circuitStatus = status;
-            //multicore_fifo_push_timeout_us(now_millis, 1000);
+            if (!stack_canary_ok())
+                HIL_LOG0("Pilha do core0 chegou na arena do scratch Y: matrizes corrompidas\n");
 
-            printf("picoHIL[%08dms]>> t:%0.4f steplen: %ldus adc0-2: %0.4f %0.4f %0.4f io0: %01d\n", 
-                millis(),
+            HIL_LOG("picoHIL[%08dms]>> t:%0.4f steplen: %ldus adc0-2: %0.4f %0.4f %0.4f io0: %01d\n", 
+                now_millis,
                 circuit.t,
-                circuit_stepcost,
+                snap.step_cost_us,
                 adc0_val, adc1_val, adc2_val,
-                io0_val);
+                (int)io0_val);
+
+            if (circuit.solver == MS_SOLVER_GAUSS_SEIDEL) {
+                HIL_LOG("sor: %lu iter/passo (max %lu), omega %0.3f%s, %lu sem convergir\n",
+                    (unsigned long)circuit.iters, (unsigned long)circuit.iters_max,
+                    circuit.sor_omega, circuit.sor_colored ? " rb" : "",
+                    (unsigned long)circuit.noconv);
+            } else if (circuit.solver == MS_SOLVER_CG && circuit.cg_active) {
+                HIL_LOG("cg%s: %lu iter/passo (max %lu), %lu sem convergir\n",
+                    circuit.cg_ic ? " ic" : " jacobi",
+                    (unsigned long)circuit.iters, (unsigned long)circuit.iters_max,
+                    (unsigned long)circuit.noconv);
+            }
 
-            printf("io0: %0.4f, Vswitch:%0.4f\r\n",
+            HIL_LOG("io0: %0.4f, Vswitch:%0.4f\r\n",
                 io0_val,
                 ms_get_node_voltage(&circuit, 4)
                 );
             // Descomentar as linhas abaixo para observar os valores nos nós
             // ou elementos para validacao de simulacao.
-            //printf("picoHIL[%08dms]>> %0.4f, %0.4f\n",
+            //HIL_LOG("picoHIL[%08dms]>> %0.4f, %0.4f\n",
             //    millis(),
             //    ms_get_node_voltage(&circuit, 1),
             //    ms_get_resistor_current(&circuit, 2));
@@ -286,8 +863,8 @@ extern font_t FONT_8x8;
 extern font_t FONT_5x7;
 void core1_entry() {
     char buf[32];
-    // I2C Initialisation. Using it at 400Khz.
-    i2c_init(I2C_PORT, 400*1000);
+    // I2C a 1 MHz: o display é atualizado por DMA, só as páginas alteradas
+    i2c_init(I2C_PORT, SSD1306_I2C_HZ);
     
     gpio_set_function(I2C_SDA, GPIO_FUNC_I2C);
     gpio_set_function(I2C_SCL, GPIO_FUNC_I2C);
@@ -307,17 +884,39 @@ void core1_entry() {
     ssd1306_show(&disp);
     sleep_ms(200);
     // Loop aguardando mensagens do core0
+    // Bordas de GPIO6..9: a IRQ fica neste core, longe do passo
+    gpio_edge_init();
+
     volatile uint32_t u32_OLEDUpd = millis();
     #define DEF_OLED_UPDATE     250
+    capture_state_t cap_last = CAPTURE_IDLE;
     while (true) {
+        console_poll();
+        telemetry_task(&circuit);
+        hil_log_task();
+
+        // Avisa uma vez quando a captura dispara e congela
+        capture_state_t cap_now = capture_state();
+        if (cap_now == CAPTURE_DONE && cap_last != CAPTURE_DONE)
+            printf("cap: disparou, use !cap dump\n");
+        cap_last = cap_now;
+
+        // Modo osciloscópio: a tela é toda do scope
+        if (scope.enabled) {
+            scope_task(&circuit, &disp);
+            continue;
+        }
+
         volatile uint32_t now_millis = millis();
         if(now_millis - u32_OLEDUpd > DEF_OLED_UPDATE){
             u32_OLEDUpd = now_millis;
+            hil_snapshot_t snap;
+            snapshot_read(&snap);
             ssd1306_clear(&disp);
             sprintf(buf, "%+01d[%0.2fs]Step:%luus", 
-                i_circuitStatus,
+                snap.status,
                 (float)(now_millis / 1000.0f),
-                u32_circuitStepCost_cpu1);
+                (unsigned long)snap.step_cost_us);
             ssd1306_draw_string_font(&disp, 0, 0, buf, &FONT_5x7);
 
             ssd1306_show(&disp);
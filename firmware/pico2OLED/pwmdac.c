@@ -0,0 +1,126 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Estágio de saída PWMDAC alimentado por DMA (ver pwmdac.h).
+ *
+ * Cada slice guarda os dois canais (A nos 16 bits baixos, B nos altos) em
+ * um único registrador CC, então basta uma palavra de 32 bits por slice
+ * e por período de PWM. Os slices da PCB (7, 0, 1, 2) não são contíguos
+ * no mapa de registradores, por isso usa-se um canal DMA por slice,
+ * disparado pelo DREQ de "wrap" do próprio slice, lendo em anel a
+ * sequência de dithering do slice.
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include "pwmdac.h"
+#include "pico/stdlib.h"
+#include "hardware/pwm.h"
+#include "hardware/dma.h"
+
+// Contagem do DMA: o anel roda continuamente; se um dia a contagem
+// esgotar (~7 min a 586 kHz), pwmdac_commit() religa o canal.
+#define PWMDAC_DMA_COUNT    0x0FFFFFFFu
+
+// Sequências duplas: [buffer][slice][período], cada linha alinhada ao
+// tamanho do anel do DMA.
+static uint32_t pwmdac_seq[2][PWMDAC_SLICES][PWMDAC_SEQ_LEN]
+    __attribute__((aligned(PWMDAC_SEQ_LEN * sizeof(uint32_t))));
+static int pwmdac_back = 0;
+
+// Códigos estendidos por canal (escritos pelo passo de simulação)
+static uint16_t pwmdac_code[PWMDAC_CHANNELS];
+
+// Máscara de "+1" por período para cada parte fracionária
+static uint32_t pwmdac_mask[PWMDAC_SEQ_LEN];
+
+static uint pwmdac_slice[PWMDAC_SLICES];
+static int  pwmdac_dma[PWMDAC_SLICES];
+
+void pwmdac_init(uint16_t wrap)
+{
+    uint32_t mask = 0;
+
+    // Tabela de padrões: sequência do código "0.frac" vira máscara de bits
+    for (uint32_t f = 0; f < PWMDAC_SEQ_LEN; f++) {
+        uint16_t seq[PWMDAC_SEQ_LEN];
+        pwmdac_dither_seq(f, seq);
+        pwmdac_mask[f] = 0;
+        for (int i = 0; i < PWMDAC_SEQ_LEN; i++)
+            pwmdac_mask[f] |= (uint32_t)seq[i] << i;
+    }
+
+    for (int s = 0; s < PWMDAC_SLICES; s++) {
+        uint pin   = PWMDAC_FIRST_GPIO + 2 * s;   // pino A; pin + 1 é o B
+        uint slice = pwm_gpio_to_slice_num(pin);
+
+        gpio_set_function(pin,     GPIO_FUNC_PWM);
+        gpio_set_function(pin + 1, GPIO_FUNC_PWM);
+        pwm_set_wrap(slice, wrap);
+        pwm_set_chan_level(slice, PWM_CHAN_A, 0);
+        pwm_set_chan_level(slice, PWM_CHAN_B, 0);
+        pwm_set_counter(slice, 0);
+
+        pwmdac_slice[s] = slice;
+        for (int i = 0; i < PWMDAC_SEQ_LEN; i++) {
+            pwmdac_seq[0][s][i] = 0;
+            pwmdac_seq[1][s][i] = 0;
+        }
+        mask |= 1u << slice;
+
+        // 1 palavra por wrap, lendo em anel a sequência do slice
+        int ch = dma_claim_unused_channel(true);
+        dma_channel_config cfg = dma_channel_get_default_config(ch);
+        channel_config_set_transfer_data_size(&cfg, DMA_SIZE_32);
+        channel_config_set_read_increment(&cfg, true);
+        channel_config_set_write_increment(&cfg, false);
+        channel_config_set_ring(&cfg, false, PWMDAC_DITHER_BITS + 2);
+        channel_config_set_dreq(&cfg, pwm_get_dreq(slice));
+        dma_channel_configure(ch, &cfg,
+                              &pwm_hw->slice[slice].cc,
+                              pwmdac_seq[0][s],
+                              PWMDAC_DMA_COUNT, true);
+        pwmdac_dma[s] = ch;
+    }
+
+    for (int i = 0; i < PWMDAC_CHANNELS; i++)
+        pwmdac_code[i] = 0;
+
+    // Habilita todos juntos para que as viradas fiquem alinhadas
+    pwm_set_mask_enabled(mask);
+}
+
+void __not_in_flash_func(pwmdac_set)(int channel, uint16_t level)
+{
+    if (channel < 0 || channel >= PWMDAC_CHANNELS) return;
+    pwmdac_code[channel] = level;
+}
+
+void __not_in_flash_func(pwmdac_commit)(void)
+{
+    uint32_t (*back)[PWMDAC_SEQ_LEN] = pwmdac_seq[pwmdac_back];
+
+    // Expande os códigos nas sequências do buffer de trás (custo fixo)
+    for (int s = 0; s < PWMDAC_SLICES; s++) {
+        uint32_t ca = pwmdac_code[2 * s];
+        uint32_t cb = pwmdac_code[2 * s + 1];
+        uint32_t base = (ca >> PWMDAC_DITHER_BITS) |
+                        ((cb >> PWMDAC_DITHER_BITS) << 16);
+        uint32_t ma = pwmdac_mask[ca & (PWMDAC_SEQ_LEN - 1)];
+        uint32_t mb = pwmdac_mask[cb & (PWMDAC_SEQ_LEN - 1)];
+
+        for (int i = 0; i < PWMDAC_SEQ_LEN; i++) {
+            back[s][i] = base + (((ma >> i) & 1u) | (((mb >> i) & 1u) << 16));
+        }
+    }
+
+    // Troca o anel lido pelo DMA: vale a partir do próximo wrap
+    for (int s = 0; s < PWMDAC_SLICES; s++) {
+        dma_channel_set_read_addr(pwmdac_dma[s], back[s], false);
+        if (!dma_channel_is_busy(pwmdac_dma[s]))
+            dma_channel_set_trans_count(pwmdac_dma[s], PWMDAC_DMA_COUNT, true);
+    }
+
+    pwmdac_back ^= 1;
+}
@@ -0,0 +1,84 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Estágio de saída PWMDAC (PWM + RC 2k2/10nF) alimentado por DMA.
+ * O passo de simulação apenas escreve os códigos de saída em um
+ * buffer "de trás"; pwmdac_commit() publica esse buffer e um canal DMA
+ * por slice o copia para o registrador CC na próxima virada do PWM.
+ * A latência de saída fica fixa em exatamente um passo.
+ *
+ * Resolução estendida por dithering com realimentação de erro: cada
+ * canal recebe um código de (8 + PWMDAC_DITHER_BITS) bits. Os bits
+ * extras são distribuídos em uma sequência de PWMDAC_SEQ_LEN períodos
+ * de PWM (base ou base + 1), que o DMA repete em anel a cada wrap.
+ * Com wrap = 255 (~586 kHz) e 4 bits extras a sequência se repete a
+ * ~36 kHz ou mais, bem acima do corte do RC 2k2/10nF (~7.2 kHz).
+ * Os 12 bits valem para o valor médio: a portadora de PWM passa pelo RC
+ * com ~65 mV pp (~80 LSB), igual com ou sem dithering (tools/pwmdac_model.c).
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#ifndef PWMDAC_H
+#define PWMDAC_H
+
+#include <stdint.h>
+
+// ======================================================
+// CANAIS DE SAÍDA DA PCB
+// ======================================================
+// Canal 0..7 => GP14..GP21 (PWM7A, PWM7B, PWM0A, PWM0B, PWM1A, PWM1B, PWM2A, PWM2B)
+
+#define PWMDAC_CHANNELS     8
+#define PWMDAC_FIRST_GPIO   14
+#define PWMDAC_SLICES       (PWMDAC_CHANNELS / 2)
+
+// Converte número do GPIO da PCB para o canal do PWMDAC
+#define PWMDAC_CH(gpio)     ((gpio) - PWMDAC_FIRST_GPIO)
+
+// ======================================================
+// DITHERING (RESOLUÇÃO ESTENDIDA)
+// ======================================================
+
+#ifndef PWMDAC_DITHER_BITS
+#define PWMDAC_DITHER_BITS  4       // 8 + 4 = 12 bits com PWM_WRAP = 255
+#endif
+#define PWMDAC_SEQ_LEN      (1 << PWMDAC_DITHER_BITS)
+
+// Maior código aceito por pwmdac_set() para um dado wrap
+#define PWMDAC_LEVEL_MAX(wrap) ((((wrap) + 1) << PWMDAC_DITHER_BITS) - 1)
+
+// Modulador de 1ª ordem com realimentação de erro: gera os níveis dos
+// PWMDAC_SEQ_LEN períodos para o código dado. A parte fracionária é
+// espalhada o mais uniformemente possível, empurrando o erro para a
+// frequência mais alta disponível (função pura, usada também no host).
+static inline void pwmdac_dither_seq(uint32_t code, uint16_t seq[PWMDAC_SEQ_LEN])
+{
+    uint32_t base = code >> PWMDAC_DITHER_BITS;
+    uint32_t frac = code & (PWMDAC_SEQ_LEN - 1);
+    uint32_t acc  = PWMDAC_SEQ_LEN / 2;     // erro inicial centrado
+
+    for (int i = 0; i < PWMDAC_SEQ_LEN; i++) {
+        acc += frac;
+        seq[i] = (uint16_t)(base + (acc >> PWMDAC_DITHER_BITS));
+        acc &= PWMDAC_SEQ_LEN - 1;
+    }
+}
+
+// ======================================================
+// API
+// ======================================================
+
+// Configura os 4 slices (em fase) e os canais DMA. Chamar uma vez no boot.
+void pwmdac_init(uint16_t wrap);
+
+// Escreve o código de um canal (0..PWMDAC_LEVEL_MAX) no buffer de trás
+// (não toca no hardware).
+void pwmdac_set(int channel, uint16_t level);
+
+// Publica o buffer de trás: os valores entram na próxima virada do PWM.
+// Chamar no início de cada passo para latência determinística de 1 passo.
+void pwmdac_commit(void);
+
+#endif // PWMDAC_H
@@ -0,0 +1,282 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Modo osciloscópio no display (ver scope.h).
+ * O core0 só grava no anel; aquisição, disparo, decimação e desenho
+ * ficam no core1, que é o único a tocar no framebuffer.
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "hil_sync.h"
+#include "scope.h"
+
+extern font_t FONT_5x7;
+
+typedef struct {
+    float v[SCOPE_MAX_TRACES];
+} scope_sample_t;
+
+typedef enum {
+    SCOPE_WAIT,         // aguardando disparo
+    SCOPE_FILL,         // preenchendo colunas
+    SCOPE_HOLD          // quadro completo, aguardando o desenho
+} scope_acq_t;
+
+scope_ctl_t scope;
+
+static scope_sample_t scope_buf[SCOPE_RING_LEN];
+static hil_ring_t     scope_ring;
+
+// Configuração do core1
+static uint32_t     scope_spc = 1;          // passos por coluna
+static int          scope_trig_trace;
+static scope_edge_t scope_edge = SCOPE_TRIG_RISE;
+static float        scope_level;
+static bool         scope_auto = true;
+
+// Aquisição (core1)
+static scope_acq_t  scope_acq;
+static uint32_t     scope_wait_ms;
+static float        scope_prev;             // amostra anterior do traço de disparo
+static int          scope_col;              // coluna em preenchimento
+static uint32_t     scope_n;                // amostras na coluna atual
+static float        scope_min[SCOPE_MAX_TRACES], scope_max[SCOPE_MAX_TRACES];
+
+// Envelope de cada coluna em linhas da tela (lo <= hi)
+static uint8_t      scope_lo[SCOPE_COLS][SCOPE_MAX_TRACES];
+static uint8_t      scope_hi[SCOPE_COLS][SCOPE_MAX_TRACES];
+
+static uint32_t     scope_frame_ms;
+
+// ======================================================
+// CORE0
+// ======================================================
+
+void scope_push(const ms_circuit_t *c)
+{
+    if (!scope.enabled) return;
+
+    scope_sample_t *s = hil_ring_claim(&scope_ring);
+    if (s == NULL) {
+        scope.dropped++;
+        return;
+    }
+    uint32_t n = scope.ntraces;
+    for (uint32_t i = 0; i < n; i++)
+        s->v[i] = c->probe[scope.probe[i]].value;
+    hil_ring_publish(&scope_ring);
+}
+
+// ======================================================
+// CONFIGURAÇÃO (CORE1)
+// ======================================================
+
+static void scope_rearm(void)
+{
+    scope_acq = SCOPE_WAIT;
+    scope_wait_ms = to_ms_since_boot(get_absolute_time());
+    scope_col = 0;
+    scope_n = 0;
+}
+
+void scope_init(void)
+{
+    memset(&scope, 0, sizeof scope);
+    scope.ntraces = 1;
+    hil_ring_init(&scope_ring, scope_buf, sizeof scope_buf[0], SCOPE_RING_LEN);
+    memset(scope_lo, SCOPE_ROWS - 1, sizeof scope_lo);
+    memset(scope_hi, SCOPE_ROWS - 1, sizeof scope_hi);
+    scope_rearm();
+}
+
+void scope_enable(bool on)
+{
+    if (on && !scope.enabled) {
+        hil_ring_drop_all(&scope_ring);
+        scope_rearm();
+    }
+    __dmb();
+    scope.enabled = on;
+}
+
+int scope_set_channels(const uint8_t *probe, int n, const ms_circuit_t *c)
+{
+    if (n < 1 || n > SCOPE_MAX_TRACES) return -1;
+    for (int i = 0; i < n; i++)
+        if (probe[i] >= c->probes) return -1;
+
+    uint32_t was = scope.enabled;
+    scope.enabled = 0;
+    __dmb();
+    for (int i = 0; i < n; i++) scope.probe[i] = probe[i];
+    scope.ntraces = (uint32_t)n;
+    if (scope_trig_trace >= n) scope_trig_trace = 0;
+    hil_ring_drop_all(&scope_ring);
+    memset(scope_lo, SCOPE_ROWS - 1, sizeof scope_lo);
+    memset(scope_hi, SCOPE_ROWS - 1, sizeof scope_hi);
+    scope_rearm();
+    __dmb();
+    scope.enabled = was;
+    return 0;
+}
+
+int scope_set_timebase(uint32_t steps_per_col)
+{
+    if (steps_per_col == 0) return -1;
+    scope_spc = steps_per_col;
+    scope_rearm();
+    return 0;
+}
+
+int scope_set_trigger(int trace, scope_edge_t edge, float level, bool auto_mode)
+{
+    if (trace < 0 || trace >= (int)scope.ntraces) return -1;
+    scope_trig_trace = trace;
+    scope_edge  = edge;
+    scope_level = level;
+    scope_auto  = auto_mode;
+    scope_rearm();
+    return 0;
+}
+
+// ======================================================
+// AQUISIÇÃO (CORE1)
+// ======================================================
+
+// Valor físico -> linha do gráfico (0 = topo da área de traços)
+static uint8_t scope_row(const ms_probe_def_t *d, float v)
+{
+    float y = v * d->gain + d->offset;
+    if (y < 0.0f) y = 0.0f;
+    if (y > 1.0f) y = 1.0f;
+    return (uint8_t)((SCOPE_ROWS - 1) - (int)(y * (SCOPE_ROWS - 1) + 0.5f));
+}
+
+static void scope_close_column(const ms_circuit_t *c, int nt)
+{
+    for (int i = 0; i < nt; i++) {
+        const ms_probe_def_t *d = &c->probe[scope.probe[i]].def;
+        // Máximo vira a linha de cima (lo) e mínimo a de baixo (hi)
+        uint8_t lo = scope_row(d, scope_max[i]);
+        uint8_t hi = scope_row(d, scope_min[i]);
+        // Liga à coluna anterior para o traço não ficar pontilhado
+        if (scope_col > 0) {
+            uint8_t plo = scope_lo[scope_col - 1][i], phi = scope_hi[scope_col - 1][i];
+            if (lo > phi) lo = phi;
+            if (hi < plo) hi = plo;
+        }
+        scope_lo[scope_col][i] = lo;
+        scope_hi[scope_col][i] = hi;
+    }
+    scope_n = 0;
+    if (++scope_col >= SCOPE_COLS) scope_acq = SCOPE_HOLD;
+}
+
+static void scope_acquire(const ms_circuit_t *c, uint32_t now)
+{
+    int nt = (int)scope.ntraces;
+    uint32_t avail = hil_ring_count(&scope_ring);
+    uint32_t k = 0;
+
+    for (; k < avail && scope_acq != SCOPE_HOLD; k++) {
+        const scope_sample_t *s = hil_ring_peek(&scope_ring, k);
+
+        if (scope_acq == SCOPE_WAIT) {
+            float x = s->v[scope_trig_trace], prev = scope_prev;
+            scope_prev = x;
+            bool hit;
+            switch (scope_edge) {
+                case SCOPE_TRIG_RISE: hit = (prev <  scope_level) && (x >= scope_level); break;
+                case SCOPE_TRIG_FALL: hit = (prev >  scope_level) && (x <= scope_level); break;
+                default:              hit = true; break;
+            }
+            if (!hit && !(scope_auto && now - scope_wait_ms >= SCOPE_AUTO_MS)) continue;
+            scope_acq = SCOPE_FILL;
+        }
+
+        if (scope_n == 0) {
+            for (int i = 0; i < nt; i++) scope_min[i] = scope_max[i] = s->v[i];
+        } else {
+            for (int i = 0; i < nt; i++) {
+                float v = s->v[i];
+                if (v < scope_min[i]) scope_min[i] = v;
+                if (v > scope_max[i]) scope_max[i] = v;
+            }
+        }
+        if (++scope_n >= scope_spc) scope_close_column(c, nt);
+    }
+
+    // Quadro completo aguardando desenho: o resto é descartado
+    hil_ring_consume(&scope_ring, scope_acq == SCOPE_HOLD ? avail : k);
+}
+
+// ======================================================
+// DESENHO (CORE1)
+// ======================================================
+
+// Linha vertical na coluna x, das linhas y0 a y1 da tela, byte a byte
+static void scope_vline(ssd1306_t *disp, int x, int y0, int y1)
+{
+    for (int page = y0 >> 3; page <= (y1 >> 3); page++) {
+        int a = (page << 3) > y0 ? 0 : (y0 & 7);
+        int b = (page << 3) + 7 < y1 ? 7 : (y1 & 7);
+        disp->buffer[page * SSD1306_WIDTH + x] |= (uint8_t)((0xFFu << a) & (0xFFu >> (7 - b)));
+    }
+}
+
+static void scope_format_time(char *buf, size_t len, float t)
+{
+    if (t < 1e-3f)      snprintf(buf, len, "%.0fus", t * 1e6f);
+    else if (t < 1.0f)  snprintf(buf, len, "%.3gms", t * 1e3f);
+    else                snprintf(buf, len, "%.3gs", t);
+}
+
+static void scope_draw(const ms_circuit_t *c, ssd1306_t *disp)
+{
+    char buf[32], tdiv[12];
+    int nt = (int)scope.ntraces;
+
+    ssd1306_clear(disp);
+
+    // Retícula: um ponto a cada divisão
+    for (int x = 0; x < SCOPE_COLS; x += SCOPE_DIV_COLS)
+        for (int y = SCOPE_TOP; y < SSD1306_HEIGHT; y += 7)
+            disp->buffer[(y >> 3) * SSD1306_WIDTH + x] |= (uint8_t)(1u << (y & 7));
+
+    // Em varredura lenta mostra as colunas novas e, depois do cursor, as
+    // do quadro anterior
+    for (int x = 0; x < SCOPE_COLS; x++) {
+        if (scope_acq == SCOPE_FILL && x == scope_col) continue;    // cursor
+        for (int i = 0; i < nt; i++)
+            scope_vline(disp, x, SCOPE_TOP + scope_lo[x][i], SCOPE_TOP + scope_hi[x][i]);
+    }
+
+    scope_format_time(tdiv, sizeof tdiv, (float)SCOPE_DIV_COLS * (float)scope_spc * c->dt);
+    const char edge = scope_edge == SCOPE_TRIG_RISE ? '/' : scope_edge == SCOPE_TRIG_FALL ? '\\' : '-';
+    snprintf(buf, sizeof buf, "%s/d T%d%c%.2g%s", tdiv, scope_trig_trace + 1, edge,
+             scope_level, scope_acq == SCOPE_WAIT ? " ?" : "");
+    ssd1306_draw_string_font(disp, 0, 0, buf, &FONT_5x7);
+}
+
+bool scope_task(const ms_circuit_t *c, ssd1306_t *disp)
+{
+    if (!scope.enabled) return false;
+
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    scope_acquire(c, now);
+
+    if (now - scope_frame_ms < SCOPE_FRAME_MS) return false;
+    scope_frame_ms = now;
+
+    scope_draw(c, disp);
+    ssd1306_show(disp);
+
+    if (scope_acq == SCOPE_HOLD) scope_rearm();
+    return true;
+}
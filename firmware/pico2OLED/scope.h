@@ -0,0 +1,75 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Modo osciloscópio no display SSD1306 (core1).
+ * A cada passo o core0 copia as sondas escolhidas (até 4 traços) para um
+ * anel SPSC (hil_sync.h); o core1 esvazia o anel, agrupa "passos por
+ * coluna" amostras em cada uma das 128 colunas guardando mínimo e máximo
+ * (envelope: nenhum pico se perde na decimação) e redesenha a tela a cada
+ * SCOPE_FRAME_MS.
+ *
+ * Escala vertical: a mesma saída normalizada do PWMDAC (valor * ganho +
+ * offset, 0..1), então o traço na tela corresponde ao sinal na saída.
+ * Disparo por borda (subida/descida) em um dos traços, modo automático
+ * (varre sozinho sem disparo após SCOPE_AUTO_MS) ou normal.
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#ifndef SCOPE_H
+#define SCOPE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "mini_spiceHILv3.h"
+#include "ssd1306/ssd1306.h"
+
+// ======================================================
+// CONFIGURAÇÕES
+// ======================================================
+
+#define SCOPE_MAX_TRACES    4
+#define SCOPE_RING_LEN      1024        // amostras (potência de 2), ~100 ms a 10 kHz
+#define SCOPE_COLS          SSD1306_WIDTH
+#define SCOPE_TOP           8           // linhas reservadas para o texto
+#define SCOPE_ROWS          (SSD1306_HEIGHT - SCOPE_TOP)
+#define SCOPE_DIV_COLS      16          // colunas por divisão
+#define SCOPE_FRAME_MS      40          // 25 quadros/s
+#define SCOPE_AUTO_MS       100         // sem disparo: varre assim mesmo
+
+typedef enum {
+    SCOPE_TRIG_RISE,
+    SCOPE_TRIG_FALL,
+    SCOPE_TRIG_OFF      // varredura livre
+} scope_edge_t;
+
+// Escrito pelo core1, lido pelo core0
+typedef struct {
+    volatile uint32_t enabled;
+    volatile uint32_t ntraces;
+    volatile uint8_t  probe[SCOPE_MAX_TRACES];  // sonda de cada traço
+    volatile uint32_t dropped;                  // amostras perdidas (anel cheio)
+} scope_ctl_t;
+
+extern scope_ctl_t scope;
+
+// ======================================================
+// API
+// ======================================================
+
+// core1: configuração (pode ser chamada com o osciloscópio ligado)
+void scope_init(void);
+void scope_enable(bool on);
+int  scope_set_channels(const uint8_t *probe, int n, const ms_circuit_t *c);
+int  scope_set_timebase(uint32_t steps_per_col);
+int  scope_set_trigger(int trace, scope_edge_t edge, float level, bool auto_mode);
+
+// core0, uma vez por passo, depois de output_circuit()
+void scope_push(const ms_circuit_t *c);
+
+// core1: consome o anel e redesenha quando é hora. Retorna true se a
+// tela foi atualizada.
+bool scope_task(const ms_circuit_t *c, ssd1306_t *disp);
+
+#endif // SCOPE_H
@@ -1,59 +1,124 @@
 #include "ssd1306.h"
+#include "hardware/dma.h"
 
-// Função auxiliar para enviar comando
-static void ssd1306_send_cmd(ssd1306_t *disp, uint8_t cmd) {
-    uint8_t buf[2] = {0x00, cmd}; // 0x00 = próximo byte é comando
-    i2c_write_blocking(disp->i2c, disp->addr, buf, 2, false);
-}
-
-// Função auxiliar para enviar dados
-static void ssd1306_send_data(ssd1306_t *disp, uint8_t *data, size_t len) {
-    uint8_t buf[len + 1];
-    buf[0] = 0x40; // 0x40 = próximo byte(s) são dados
-    memcpy(&buf[1], data, len);
-    i2c_write_blocking(disp->i2c, disp->addr, buf, len + 1, false);
+// Função auxiliar para enviar comandos (uma transação, 0x00 = seguem comandos)
+static void ssd1306_send_cmds(ssd1306_t *disp, const uint8_t *cmds, size_t len) {
+    i2c_write_blocking(disp->i2c, disp->addr, cmds, len, false);
 }
 
 // Inicialização básica
 void ssd1306_init(ssd1306_t *disp, i2c_inst_t *i2c, uint8_t addr) {
+    static const uint8_t init_cmds[] = {
+        0x00,               // seguem comandos
+        0xAE,               // Display OFF
+        0xA8, 0x3F,         // Multiplex ratio
+        0xD3, 0x00,         // Display offset
+        0x40,               // Start line = 0
+        0xA1,               // Segment remap
+        0xC8,               // COM scan direction
+        0xDA, 0x12,         // COM pins
+        0x81, 0x7F,         // Contrast
+        0xA4,               // Resume RAM content
+        0xA6,               // Normal display
+        0xD5, 0x80,         // Clock
+        0x8D, 0x14,         // Charge pump
+        0x20, 0x00,         // Endereçamento horizontal (janela 0x21/0x22)
+        0xAF,               // Display ON
+    };
+
     disp->i2c = i2c;
     disp->addr = addr;
+    disp->synced = false;
     memset(disp->buffer, 0, sizeof(disp->buffer));
 
-    // Sequência mínima de init
-    ssd1306_send_cmd(disp, 0xAE); // Display OFF
-    ssd1306_send_cmd(disp, 0xA8); ssd1306_send_cmd(disp, 0x3F); // Multiplex ratio
-    ssd1306_send_cmd(disp, 0xD3); ssd1306_send_cmd(disp, 0x00); // Display offset
-    ssd1306_send_cmd(disp, 0x40); // Start line = 0
-    ssd1306_send_cmd(disp, 0xA1); // Segment remap
-    ssd1306_send_cmd(disp, 0xC8); // COM scan direction
-    ssd1306_send_cmd(disp, 0xDA); ssd1306_send_cmd(disp, 0x12); // COM pins
-    ssd1306_send_cmd(disp, 0x81); ssd1306_send_cmd(disp, 0x7F); // Contrast
-    ssd1306_send_cmd(disp, 0xA4); // Resume RAM content
-    ssd1306_send_cmd(disp, 0xA6); // Normal display
-    ssd1306_send_cmd(disp, 0xD5); ssd1306_send_cmd(disp, 0x80); // Clock
-    ssd1306_send_cmd(disp, 0x8D); ssd1306_send_cmd(disp, 0x14); // Charge pump
-    ssd1306_send_cmd(disp, 0xAF); // Display ON
+    // Dados: buffer -> IC_DATA_CMD, no ritmo do FIFO do I2C. Ao terminar
+    // encadeia o canal que escreve o último byte com o bit de STOP.
+    volatile void *data_cmd = &i2c_get_hw(i2c)->data_cmd;
+    disp->dma_data = dma_claim_unused_channel(true);
+    disp->dma_stop = dma_claim_unused_channel(true);
+
+    dma_channel_config cfg = dma_channel_get_default_config(disp->dma_stop);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_16);
+    channel_config_set_read_increment(&cfg, false);
+    channel_config_set_write_increment(&cfg, false);
+    channel_config_set_dreq(&cfg, i2c_get_dreq(i2c, true));
+    dma_channel_configure(disp->dma_stop, &cfg, data_cmd, &disp->stop_word, 1, false);
+
+    cfg = dma_channel_get_default_config(disp->dma_data);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_16);
+    channel_config_set_read_increment(&cfg, true);
+    channel_config_set_write_increment(&cfg, false);
+    channel_config_set_dreq(&cfg, i2c_get_dreq(i2c, true));
+    channel_config_set_chain_to(&cfg, disp->dma_stop);
+    dma_channel_configure(disp->dma_data, &cfg, data_cmd, disp->buffer, 0, false);
+
+    ssd1306_send_cmds(disp, init_cmds, sizeof(init_cmds));
+}
+
+// Transferência anterior ainda em andamento (DMA ou FIFO do I2C)
+bool ssd1306_busy(ssd1306_t *disp) {
+    if (dma_channel_is_busy(disp->dma_data) || dma_channel_is_busy(disp->dma_stop))
+        return true;
+    i2c_hw_t *hw = i2c_get_hw(disp->i2c);
+    return !(hw->status & I2C_IC_STATUS_TFE_BITS) || (hw->status & I2C_IC_STATUS_ACTIVITY_BITS);
+}
+
+void ssd1306_wait(ssd1306_t *disp) {
+    while (ssd1306_busy(disp))
+        tight_loop_contents();
+    (void)i2c_get_hw(disp->i2c)->clr_tx_abrt;   // display ausente: limpa o NACK
 }
 
-// Atualiza tela com conteúdo do buffer
+// Envia as páginas que mudaram desde o último envio em uma única janela
+// (páginas first..last, largura total). Volta sem esperar o fim do DMA.
 void ssd1306_show(ssd1306_t *disp) {
-    for (uint8_t page = 0; page < 8; page++) {
-        ssd1306_send_cmd(disp, 0xB0 + page); // Page address
-        ssd1306_send_cmd(disp, 0x00);        // Lower column
-        ssd1306_send_cmd(disp, 0x10);        // Higher column
-        ssd1306_send_data(disp, &disp->buffer[SSD1306_WIDTH * page], SSD1306_WIDTH);
+    int first = -1, last = -1;
+
+    ssd1306_wait(disp);
+
+    for (int page = 0; page < SSD1306_PAGES; page++) {
+        const uint16_t *src = &disp->buffer[SSD1306_WIDTH * page];
+        const uint8_t *old = &disp->shadow[SSD1306_WIDTH * page];
+        bool changed = !disp->synced;
+        for (int x = 0; x < SSD1306_WIDTH && !changed; x++)
+            changed = (uint8_t)src[x] != old[x];
+        if (!changed) continue;
+        if (first < 0) first = page;
+        last = page;
     }
+    if (first < 0) return;
+
+    int start = SSD1306_WIDTH * first;
+    int count = SSD1306_WIDTH * (last - first + 1);
+    for (int i = start; i < start + count; i++)
+        disp->shadow[i] = (uint8_t)disp->buffer[i];
+    disp->synced = true;
+
+    const uint8_t window[] = {
+        0x00,
+        0x21, 0x00, SSD1306_WIDTH - 1,          // colunas
+        0x22, (uint8_t)first, (uint8_t)last,    // páginas
+    };
+    ssd1306_send_cmds(disp, window, sizeof(window));
+
+    // Byte de controle pela CPU (FIFO vazio), dados pelo DMA
+    disp->stop_word = disp->buffer[start + count - 1] | I2C_IC_DATA_CMD_STOP_BITS;
+    i2c_get_hw(disp->i2c)->data_cmd = 0x40;     // 0x40 = próximos bytes são dados
+    dma_channel_set_trans_count(disp->dma_data, count - 1, false);
+    dma_channel_set_read_addr(disp->dma_data, &disp->buffer[start], true);
 }
 
 // Limpa tela
 void ssd1306_clear(ssd1306_t *disp) {
+    ssd1306_wait(disp);
     memset(disp->buffer, 0, sizeof(disp->buffer));
 }
 
 // Seta a tela
 void ssd1306_showall(ssd1306_t *disp) {
-    memset(disp->buffer, 0xFF, sizeof(disp->buffer));
+    ssd1306_wait(disp);
+    for (size_t i = 0; i < sizeof(disp->buffer) / sizeof(disp->buffer[0]); i++)
+        disp->buffer[i] = 0xFF;
 }
 
 // Desenha um pixel
@@ -66,11 +131,40 @@ void ssd1306_draw_pixel(ssd1306_t *disp, int x, int y, bool color) {
         disp->buffer[byte_index] &= ~(1 << (y & 7));
 }
 
+// Glifo inteiro por colunas: cada coluna da fonte (até 8 linhas) cai em no
+// máximo duas páginas do buffer; o fundo do glifo é apagado como no
+// desenho pixel a pixel. Exige o glifo dentro da tela na vertical.
+static void ssd1306_blit_glyph(ssd1306_t *disp, int x, int y, const uint8_t *bitmap, const font_t *font) {
+    int shift = y & 7;
+    uint16_t mask = (uint16_t)(((1u << font->height) - 1u) << shift);
+    uint16_t *lo = &disp->buffer[(y >> 3) * SSD1306_WIDTH];
+    uint16_t *hi = (shift + font->height > 8) ? lo + SSD1306_WIDTH : NULL;
+    int i0 = x < 0 ? -x : 0;
+    int i1 = x + font->width > SSD1306_WIDTH ? SSD1306_WIDTH - x : font->width;
+
+    for (int i = i0; i < i1; i++) {
+        uint16_t bits = (uint16_t)(bitmap[i] << shift) & mask;
+        lo[x + i] = (lo[x + i] & ~mask & 0xFF) | (bits & 0xFF);
+        if (hi) hi[x + i] = (hi[x + i] & ~(mask >> 8)) | (bits >> 8);
+    }
+}
+
+static inline bool ssd1306_glyph_fits(int y, const font_t *font) {
+    return font->height <= 8 && y >= 0 && y + font->height <= SSD1306_HEIGHT;
+}
+
 void ssd1306_draw_char_font(ssd1306_t *disp, int x, int y, char ch, const font_t *font) {
     if (ch < 32 || ch > 127) return;
     int index = (ch) * font->width; // posição do caractere na tabela
     const uint8_t *bitmap = &font->data[index];
 
+    if (ssd1306_glyph_fits(y, font)) {
+        if (x < SSD1306_WIDTH && x + font->width > 0)
+            ssd1306_blit_glyph(disp, x, y, bitmap, font);
+        return;
+    }
+
+    // Glifo cortado na vertical: pixel a pixel
     for (int i = 0; i < font->width; i++) {
         for (int j = 0; j < font->height; j++) {
             bool pixel = bitmap[i] & (1 << j);
@@ -80,9 +174,21 @@ void ssd1306_draw_char_font(ssd1306_t *disp, int x, int y, char ch, const font_t
 }
 
 void ssd1306_draw_string_font(ssd1306_t *disp, int x, int y, const char *str, const font_t *font) {
+    int advance = font->width + font->spacing;
+
+    // Linha de status: testa o corte vertical uma vez e para no fim da tela
+    if (ssd1306_glyph_fits(y, font)) {
+        for (; *str && x < SSD1306_WIDTH; str++, x += advance) {
+            char ch = *str;
+            if (ch < 32 || ch > 127 || x + font->width <= 0) continue;
+            ssd1306_blit_glyph(disp, x, y, &font->data[ch * font->width], font);
+        }
+        return;
+    }
+
     while (*str) {
         ssd1306_draw_char_font(disp, x, y, *str++, font);
-        x += font->width + font->spacing;
+        x += advance;
     }
 }
 
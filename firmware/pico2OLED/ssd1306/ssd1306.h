@@ -1,3 +1,6 @@
+#ifndef SSD1306_H
+#define SSD1306_H
+
 #include "hardware/i2c.h"
 #include "pico/stdlib.h"
 #include <string.h>
@@ -7,10 +10,23 @@
 #define SSD1306_WIDTH 128
 #define SSD1306_HEIGHT 64
 
+#define SSD1306_PAGES (SSD1306_HEIGHT / 8)
+#define SSD1306_I2C_HZ (1000 * 1000) // acima dos 400 kHz do datasheet; a maioria dos módulos aceita
+
+// O framebuffer guarda cada byte do display em 16 bits, no formato do
+// registrador IC_DATA_CMD do I2C: o DMA envia direto do buffer, sem cópia.
+// Os bits 8..15 ficam sempre em zero (escrita de dado, sem STOP).
+// ssd1306_show() só envia as páginas que mudaram e volta antes do fim da
+// transferência; quem escreve direto em buffer[] deve chamar antes
+// ssd1306_clear() ou ssd1306_wait().
 typedef struct {
     i2c_inst_t *i2c;
     uint8_t addr;
-    uint8_t buffer[SSD1306_WIDTH * SSD1306_HEIGHT / 8];
+    int dma_data, dma_stop;                         // canais: dados e último byte com STOP
+    uint16_t stop_word;                             // último byte | STOP
+    bool synced;                                    // shadow reflete o que está no display
+    uint16_t buffer[SSD1306_WIDTH * SSD1306_PAGES];
+    uint8_t shadow[SSD1306_WIDTH * SSD1306_PAGES];  // último conteúdo enviado
 } ssd1306_t;
 
 typedef struct {
@@ -24,6 +40,10 @@ typedef struct {
 //extern static void ssd1306_send_cmd(ssd1306_t *disp, uint8_t cmd);
 extern void ssd1306_init(ssd1306_t *disp, i2c_inst_t *i2c, uint8_t addr);
 extern void ssd1306_show(ssd1306_t *disp);
+extern bool ssd1306_busy(ssd1306_t *disp);
+extern void ssd1306_wait(ssd1306_t *disp);
 extern void ssd1306_clear(ssd1306_t *disp);
 extern void ssd1306_showall(ssd1306_t *disp);
 extern void ssd1306_draw_string_font(ssd1306_t *disp, int x, int y, const char *str, const font_t *font);
+
+#endif // SSD1306_H
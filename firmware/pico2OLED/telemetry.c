@@ -0,0 +1,264 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Telemetria binária pela USB (ver telemetry.h).
+ * As amostras passam do core0 para o core1 por um anel SPSC (hil_sync.h).
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include "hardware/sync.h"
+#include "hil_sync.h"
+#include "telemetry.h"
+
+typedef struct {
+    uint32_t step;                  // número do passo
+    uint32_t mask;                  // sondas gravadas (para descartar trocas)
+    int16_t  v[TELEM_MAX_CH];
+} telem_sample_t;
+
+telemetry_ctl_t telemetry;
+
+static telem_sample_t telem_buf[TELEM_RING_LEN];
+static hil_ring_t     telem_ring;
+
+// Estado do core0
+static uint32_t telem_step;
+static uint32_t telem_div;
+
+// Estado do core1
+static volatile uint32_t telem_desc_pending;
+static uint32_t telem_desc_ms;
+static uint32_t telem_flush_ms;
+static uint32_t telem_dropped_sent;
+static uint8_t  telem_seq;
+
+static uint8_t  telem_frame[TELEM_FRAME_MAX];
+static uint8_t  telem_cobs[1 + TELEM_COBS_MAX(TELEM_FRAME_MAX)];
+
+// ======================================================
+// CORE0 (PASSO DE SIMULAÇÃO)
+// ======================================================
+
+void telemetry_push(const ms_circuit_t *c)
+{
+    uint32_t step = telem_step++;
+
+    if (!telemetry.enabled) return;
+    if (++telem_div < telemetry.decim) return;
+    telem_div = 0;
+
+    telem_sample_t *s = hil_ring_claim(&telem_ring);
+    if (s == NULL) {
+        telemetry.dropped++;
+        return;
+    }
+
+    uint32_t mask = telemetry.mask;
+    int n = 0;
+
+    s->step = step;
+    s->mask = mask;
+    for (int i = 0; i < c->probes; i++) {
+        if (!(mask & (1u << i))) continue;
+        s->v[n++] = telemetry_quantize(&c->probe[i].def, c->probe[i].value);
+    }
+
+    hil_ring_publish(&telem_ring);
+}
+
+void telemetry_circuit_changed(void)
+{
+    telem_desc_pending = 1;
+}
+
+// ======================================================
+// CORE1 (ENVIO)
+// ======================================================
+
+void telemetry_init(void)
+{
+    memset(&telemetry, 0, sizeof telemetry);
+    telemetry.decim = 1;
+    hil_ring_init(&telem_ring, telem_buf, sizeof telem_buf[0], TELEM_RING_LEN);
+}
+
+void telemetry_start(uint32_t decim, uint32_t mask)
+{
+    telemetry.enabled = 0;
+    __dmb();
+    telemetry.decim   = decim ? decim : 1;
+    telemetry.req_mask = mask & ((1u << TELEM_MAX_CH) - 1);
+    telemetry.mask    = 0;          // cortada no primeiro DESC (telemetry_task)
+    telemetry.dropped = 0;
+    telem_dropped_sent = 0;
+    hil_ring_drop_all(&telem_ring); // descarta o que sobrou
+    telem_desc_pending = 1;
+    __dmb();
+    telemetry.enabled = 1;
+}
+
+void telemetry_stop(void)
+{
+    telemetry.enabled = 0;
+}
+
+static void put16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put32(uint8_t *p, uint32_t v) { put16(p, (uint16_t)v); put16(p + 2, (uint16_t)(v >> 16)); }
+
+// Fecha o quadro (CRC), codifica em COBS e envia direto pelo driver USB,
+// sem a conversão CRLF do stdio. Sem host conectado, o quadro é perdido.
+static void telem_send(uint8_t type, size_t payload)
+{
+    telem_frame[0] = type;
+    telem_frame[1] = telem_seq++;
+    size_t len = 2 + payload;
+    put16(&telem_frame[len], telemetry_crc16(telem_frame, len));
+    len += 2;
+
+    // 0x00 antes e depois: texto solto na mesma porta (printf) nunca se
+    // cola a um quadro
+    telem_cobs[0] = 0x00;
+    size_t n = 1 + telemetry_cobs_encode(telem_frame, len, &telem_cobs[1]);
+    telem_cobs[n++] = 0x00;
+
+    if (stdio_usb_connected())
+        stdio_usb.out_chars((const char *)telem_cobs, (int)n);
+}
+
+static uint8_t *telem_desc_begin(float dt, uint32_t decim)
+{
+    uint8_t *p = &telem_frame[2];
+
+    memcpy(p, &dt, 4);
+    put16(p + 4, (uint16_t)decim);
+    p[6] = 0;
+    p[7] = 0;
+    return p + 8;
+}
+
+static uint8_t *telem_desc_put(uint8_t *p, const ms_probe_def_t *d)
+{
+    p[0] = (uint8_t)d->type;
+    p[1] = (uint8_t)d->a;
+    p[2] = (uint8_t)d->b;
+    p[3] = (uint8_t)d->channel;
+    memcpy(p + 4, &d->gain, 4);
+    memcpy(p + 8, &d->offset, 4);
+    telem_frame[2 + 6]++;           // nch
+    return p + 12;
+}
+
+void telemetry_send_desc(const ms_circuit_t *c, uint32_t mask, uint32_t decim)
+{
+    uint8_t *p = telem_desc_begin(c->dt, decim);
+
+    for (int i = 0; i < c->probes; i++)
+        if (mask & (1u << i)) p = telem_desc_put(p, &c->probe[i].def);
+
+    telem_send(TELEM_FRAME_DESC, (size_t)(p - &telem_frame[2]));
+}
+
+void telemetry_send_desc_defs(const ms_probe_def_t *def, int n, float dt, uint32_t decim)
+{
+    uint8_t *p = telem_desc_begin(dt, decim);
+
+    for (int i = 0; i < n; i++)
+        p = telem_desc_put(p, &def[i]);
+
+    telem_send(TELEM_FRAME_DESC, (size_t)(p - &telem_frame[2]));
+}
+
+void telemetry_send_data(uint32_t first_step, uint32_t dropped,
+                         int nch, int n, const int16_t *v)
+{
+    uint8_t *hdr = &telem_frame[2];
+
+    if (n > TELEM_BATCH) n = TELEM_BATCH;
+    put32(hdr, first_step);
+    put16(hdr + 4, (uint16_t)dropped);
+    hdr[6] = (uint8_t)nch;
+    hdr[7] = (uint8_t)n;
+    memcpy(hdr + 8, v, (size_t)(n * nch) * 2);
+
+    telem_send(TELEM_FRAME_DATA, 8 + (size_t)(n * nch) * 2);
+}
+
+void telemetry_send_trigger(uint32_t step, uint16_t pre, uint16_t post)
+{
+    uint8_t *p = &telem_frame[2];
+
+    put32(p, step);
+    put16(p + 4, pre);
+    put16(p + 6, post);
+    telem_send(TELEM_FRAME_TRIG, 8);
+}
+
+// Monta um quadro DATA com amostras consecutivas (mesma máscara, sem
+// buracos). Retorna o número de amostras consumidas.
+static int telem_send_data(uint32_t avail)
+{
+    uint8_t *hdr = &telem_frame[2];
+    uint8_t *p = hdr + 8;
+    uint32_t mask = telemetry.mask, decim = telemetry.decim;
+    int nch = 0, n = 0;
+    uint32_t first = 0;
+
+    for (int i = 0; i < TELEM_MAX_CH; i++) nch += (mask >> i) & 1u;
+
+    while ((uint32_t)n < avail && n < TELEM_BATCH) {
+        const telem_sample_t *s = hil_ring_peek(&telem_ring, (uint32_t)n);
+        if (s->mask != mask) {
+            // Amostra de uma configuração anterior: descarta
+            if (n == 0) { hil_ring_consume(&telem_ring, 1); avail--; continue; }
+            break;
+        }
+        if (n == 0) first = s->step;
+        else if (s->step != first + (uint32_t)n * decim) break;
+        memcpy(p, s->v, (size_t)nch * 2);
+        p += nch * 2;
+        n++;
+    }
+    if (n == 0) return 0;
+
+    uint32_t dropped = telemetry.dropped;
+    put32(hdr, first);
+    put16(hdr + 4, (uint16_t)(dropped - telem_dropped_sent));
+    hdr[6] = (uint8_t)nch;
+    hdr[7] = (uint8_t)n;
+    telem_dropped_sent = dropped;
+
+    telem_send(TELEM_FRAME_DATA, (size_t)(p - hdr));
+
+    hil_ring_consume(&telem_ring, (uint32_t)n);
+    return n;
+}
+
+void telemetry_task(const ms_circuit_t *c)
+{
+    if (!telemetry.enabled) return;
+
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    if (telem_desc_pending || now - telem_desc_ms >= TELEM_DESC_MS) {
+        telem_desc_pending = 0;
+        telem_desc_ms = now;
+        // Recorta a cada descritor (e logo após a troca de circuito): com
+        // bits acima de c->probes o DATA teria canais que o core0 não grava.
+        // Amostras gravadas com a máscara anterior são descartadas.
+        telemetry.mask = telemetry_mask(c, telemetry.req_mask);
+        telemetry_send_desc(c, telemetry.mask, telemetry.decim);
+    }
+
+    // Quadros cheios sempre; um parcial a cada 20 ms em taxas baixas
+    for (;;) {
+        uint32_t avail = hil_ring_count(&telem_ring);
+        if (avail == 0) break;
+        if (avail < TELEM_BATCH && now - telem_flush_ms < 20) break;
+        if (telem_send_data(avail) == 0) break;
+        telem_flush_ms = now;
+    }
+}
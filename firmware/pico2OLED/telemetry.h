@@ -0,0 +1,164 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Telemetria binária de alta taxa pela USB (CDC).
+ * O core0 grava, a cada passo (ou a cada N passos), as sondas
+ * selecionadas em um anel sem travas; o core1 esvazia o anel, monta
+ * quadros binários (COBS + CRC-16) e os envia pela USB. O core0 nunca
+ * espera: se o anel encher, a amostra é descartada e contada.
+ *
+ * Quadro (antes do COBS; depois de codificado vai entre dois 0x00):
+ *
+ *   [tipo u8][seq u8][payload ...][crc16 u16]
+ *
+ *   TELEM_FRAME_DESC : dt f32, decim u16, nch u8, rsv u8,
+ *                      nch x { tipo u8, a u8, b u8, canal i8, ganho f32, offset f32 }
+ *   TELEM_FRAME_DATA : passo u32, perdidas u16, nch u8, n u8,
+ *                      n x nch x amostra i16
+ *   TELEM_FRAME_TRIG : passo do disparo u32, pre u16, pos u16
+ *                      (abre o despejo de uma captura, ver capture.h)
+ *
+ * Cada amostra é a saída normalizada da sonda (valor * ganho + offset,
+ * a mesma escala do PWMDAC) em 16 bits: q = round(y * 65535) - 32768.
+ * O host recupera o valor físico com o ganho/offset do descritor.
+ * O CRC-16 é o CCITT (0x1021, inicial 0xFFFF), little-endian no quadro.
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mini_spiceHILv3.h"
+
+// ======================================================
+// CONFIGURAÇÕES
+// ======================================================
+
+#define TELEM_MAX_CH        MS_MAX_PROBES
+#define TELEM_RING_LEN      512         // amostras (potência de 2), ~50 ms a 10 kHz
+#define TELEM_BATCH         16          // amostras por quadro DATA
+#define TELEM_DESC_MS       1000        // reenvio periódico do descritor
+
+#define TELEM_FRAME_DESC    0x01
+#define TELEM_FRAME_DATA    0x02
+#define TELEM_FRAME_TRIG    0x03
+
+// Maior quadro antes da codificação (DATA cheio)
+#define TELEM_FRAME_MAX     (2 + 8 + TELEM_BATCH * TELEM_MAX_CH * 2 + 2)
+// COBS acrescenta 1 byte a cada 254, mais o delimitador
+#define TELEM_COBS_MAX(n)   ((n) + (n) / 254 + 2)
+
+// ======================================================
+// CODIFICAÇÃO (FUNÇÕES PURAS, USADAS TAMBÉM NO HOST)
+// ======================================================
+
+static inline uint16_t telemetry_crc16(const uint8_t *p, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    while (len--) {
+        crc ^= (uint16_t)(*p++) << 8;
+        for (int k = 0; k < 8; k++)
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+// Codifica len bytes em out (sem o 0x00 final). Retorna o tamanho.
+static inline size_t telemetry_cobs_encode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t code_at = 0, o = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_at] = code;
+            code_at = o++;
+            code = 1;
+        } else {
+            out[o++] = in[i];
+            if (++code == 0xFF) {
+                out[code_at] = code;
+                code_at = o++;
+                code = 1;
+            }
+        }
+    }
+    out[code_at] = code;
+    return o;
+}
+
+// Decodifica um quadro COBS (sem o 0x00). Retorna o tamanho ou 0 se inválido.
+static inline size_t telemetry_cobs_decode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t i = 0, o = 0;
+
+    while (i < len) {
+        uint8_t code = in[i++];
+        if (code == 0 || i + code - 1 > len) return 0;
+        for (int k = 1; k < code; k++) out[o++] = in[i++];
+        if (code != 0xFF && i < len) out[o++] = 0;
+    }
+    return o;
+}
+
+// Saída normalizada da sonda (escala do PWMDAC) em 16 bits
+static inline int16_t telemetry_quantize(const ms_probe_def_t *d, float value)
+{
+    float y = value * d->gain + d->offset;
+    if (y < 0.0f) y = 0.0f;
+    if (y > 1.0f) y = 1.0f;
+    return (int16_t)((int32_t)(y * 65535.0f + 0.5f) - 32768);
+}
+
+// ======================================================
+// API DO FIRMWARE
+// ======================================================
+
+// Estado compartilhado: escrito pelo core1 (configuração), lido pelo core0.
+typedef struct {
+    volatile uint32_t enabled;      // 0 = parado
+    volatile uint32_t decim;        // grava 1 a cada decim passos
+    volatile uint32_t req_mask;     // sondas pedidas no telemetry_start
+    volatile uint32_t mask;         // req_mask cortada em c->probes (a cada DESC)
+    volatile uint32_t dropped;      // amostras descartadas (anel cheio)
+} telemetry_ctl_t;
+
+extern telemetry_ctl_t telemetry;
+
+void telemetry_init(void);
+
+// core1: inicia/para o envio (decim >= 1, mask de sondas). Bits de sondas
+// que o circuito não tem são ignorados (telemetry_mask), também depois de
+// trocar de circuito.
+void telemetry_start(uint32_t decim, uint32_t mask);
+void telemetry_stop(void);
+
+// Máscara efetiva: só as sondas que existem em c (DESC e DATA usam esta)
+static inline uint32_t telemetry_mask(const ms_circuit_t *c, uint32_t mask)
+{
+    return mask & ((1u << c->probes) - 1u);
+}
+
+// core0: o circuito ativo mudou (novas sondas => novo descritor)
+void telemetry_circuit_changed(void);
+
+// core0, uma vez por passo, depois de output_circuit()
+void telemetry_push(const ms_circuit_t *c);
+
+// core1: esvazia o anel e envia os quadros pela USB
+void telemetry_task(const ms_circuit_t *c);
+
+// core1: envio direto de quadros (usado também pelo despejo de capturas).
+// v[] tem n amostras de nch canais (n <= TELEM_BATCH).
+void telemetry_send_desc(const ms_circuit_t *c, uint32_t mask, uint32_t decim);
+// Mesmo descritor a partir de uma cópia das definições (n sondas, todas)
+void telemetry_send_desc_defs(const ms_probe_def_t *def, int n, float dt, uint32_t decim);
+void telemetry_send_data(uint32_t first_step, uint32_t dropped,
+                         int nch, int n, const int16_t *v);
+void telemetry_send_trigger(uint32_t step, uint16_t pre, uint16_t post);
+
+#endif // TELEMETRY_H
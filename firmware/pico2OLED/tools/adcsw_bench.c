@@ -0,0 +1,176 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Custo do passo com chaves de admitância constante (ADC) contra as
+ * chaves resistivas (ron/roff), no host e com o mesmo motor do firmware.
+ * O circuito é um boost de 20 kHz com filtro LC de entrada (N seções,
+ * para o sistema ter um tamanho realista), em passo fixo de 1 us:
+ *   . resistivo + eventos, Gauss: referência (a matriz muda a cada
+ *     comutação e o diodo precisa dos eventos)
+ *   . resistivo + eventos, LU: refatora a cada passo
+ *   . ADC, Gauss: eliminação completa a cada passo
+ *   . ADC, LU: matriz constante, fatorada uma vez (só substituição)
+ * e, para o ADC com LU, o efeito do amortecimento theta na saída e na
+ * oscilação numérica da tensão na chave.
+ *
+ * Compilação (no diretório firmware/pico2OLED):
+ *   gcc -O2 -DMS_HOST_BUILD -I. tools/adcsw_bench.c mini_spiceHILv3.c \
+ *       -lm -o adcsw_bench
+ *
+ * Uso:
+ *   ./adcsw_bench [-n secoes] [-g gs]     (gs padrão: sqrt(C/L) do boost)
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "mini_spiceHILv3.h"
+
+// Boost de referência
+#define BENCH_VIN       5.0f
+#define BENCH_L         1e-3f
+#define BENCH_C         22e-6f
+#define BENCH_R         20.0f
+#define BENCH_DUTY      0.3f
+#define BENCH_FSW       20e3f
+#define BENCH_DT        1e-6f
+#define BENCH_T_END     0.040f
+#define BENCH_T_AVG     0.030f      // média da saída a partir daqui
+
+// Filtro de entrada: seções L série + C paralelo
+#define BENCH_LF        10e-6f
+#define BENCH_CF        10e-6f
+#define BENCH_RF        0.05f       // amortecimento do filtro (em série com L)
+
+typedef enum { SW_RESISTIVE, SW_ADC } bench_sw_t;
+
+typedef struct {
+    const char      *name;
+    bench_sw_t       sw;
+    ms_solver_type_t solver;
+    int              events;
+    float            theta;
+} bench_case_t;
+
+static const bench_case_t cases[] = {
+    { "resistiva+eventos Gauss", SW_RESISTIVE, MS_SOLVER_GAUSS, 1, 1.0f  },
+    { "resistiva+eventos LU",    SW_RESISTIVE, MS_SOLVER_LU,    1, 1.0f  },
+    { "ADC Gauss",               SW_ADC,       MS_SOLVER_GAUSS, 0, 1.0f  },
+    { "ADC LU (fatora 1x)",      SW_ADC,       MS_SOLVER_LU,    0, 1.0f  },
+    { "ADC LU theta=0.75",       SW_ADC,       MS_SOLVER_LU,    0, 0.75f },
+    { "ADC LU theta=0.5",        SW_ADC,       MS_SOLVER_LU,    0, 0.5f  },
+};
+
+static ms_circuit_t circuit;
+static float circuit_mem[MS_MEM_MAX_BYTES / sizeof(float)];
+static int n_sw, n_out;
+
+static void build(ms_circuit_t *c, const bench_case_t *k, int sections, float gs)
+{
+    // Nós: 1 = fonte, 2..sections+1 = filtro, depois chave, saída e gate
+    int n_in   = sections + 1;
+    n_sw       = sections + 2;
+    n_out      = sections + 3;
+    int n_gate = sections + 4;
+
+    ms_circuit_init(c, n_gate, BENCH_DT);
+    ms_set_solver(c, k->solver);
+    ms_set_events(c, k->events);
+
+    ms_add_voltage_source(c, 1, 0, BENCH_VIN);
+    for (int s = 1; s <= sections; s++) {
+        ms_add_series_rl_helper(c, s, s + 1, BENCH_RF, BENCH_LF);
+        ms_add_capacitor(c, s + 1, 0, BENCH_CF);
+    }
+    ms_add_inductor(c, n_in, n_sw, BENCH_L);
+
+    int g = ms_add_voltage_source(c, n_gate, 0, 0.0f);
+    ms_set_source_pulse(c, g, 0.0f, 5.0f, 0.0f, 0.0f, 0.0f,
+                        BENCH_DUTY / BENCH_FSW, 1.0f / BENCH_FSW);
+    ms_add_resistor(c, n_gate, 0, 1e3f);
+
+    if (k->sw == SW_ADC) {
+        int s = ms_add_adc_switch(c, n_sw, 0, n_gate, 0, gs, 2.5f);
+        int d = ms_add_adc_diode(c, n_sw, n_out, gs);
+        ms_set_adc_damping(c, s, k->theta);
+        ms_set_adc_damping(c, d, k->theta);
+    } else {
+        ms_add_switch(c, n_sw, 0, n_gate, 0, 0.05f, 100e3f, 2.5f);
+        // Diodo ideal: conduz enquanto v(sw) > v(out)
+        ms_add_switch(c, n_sw, n_out, n_sw, n_out, 0.05f, 100e3f, 0.0f);
+    }
+
+    ms_add_capacitor(c, n_out, 0, BENCH_C);
+    ms_add_resistor(c, n_out, 0, BENCH_R);
+}
+
+static int run_case(const bench_case_t *k, int sections, float gs)
+{
+    build(&circuit, k, sections, gs);
+    ms_circuit_finalize(&circuit, circuit_mem, sizeof circuit_mem);
+
+    uint32_t steps = 0;
+    double acc = 0.0, over = 0.0;
+    int n = 0, status = 0;
+
+    clock_t t0 = clock();
+    while (circuit.t < BENCH_T_END - 0.5f * BENCH_DT) {
+        status = ms_circuit_step(&circuit);
+        if (status != 0) break;
+        steps++;
+        if (circuit.t >= BENCH_T_AVG) {
+            float vo = ms_get_node_voltage(&circuit, n_out);
+            float vs = ms_get_node_voltage(&circuit, n_sw);
+            acc += vo;
+            if (vs - vo > over) over = vs - vo;
+            n++;
+        }
+    }
+    double cpu = (double)(clock() - t0) / CLOCKS_PER_SEC;
+
+    if (status != 0) {
+        printf("%-24s  t=%g: %s\n", k->name, (double)circuit.t, ms_system_status_str(status));
+        return status;
+    }
+    printf("%-24s %3d %7lu %6lu %7lu %8.3f %7.3f %7.3f %7.3f\n", k->name,
+           circuit.reduced_size, (unsigned long)steps,
+           (unsigned long)circuit.event_splits, (unsigned long)circuit.factorizations,
+           cpu * 1e6 / steps, acc / n, acc / n - BENCH_VIN / (1.0f - BENCH_DUTY), over);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int sections = 4;
+    float gs = sqrtf(BENCH_C / BENCH_L);
+
+    for (int i = 1; i < argc; i++) {
+        if      (!strcmp(argv[i], "-n") && i + 1 < argc) sections = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-g") && i + 1 < argc) gs = strtof(argv[++i], NULL);
+        else {
+            fprintf(stderr, "uso: adcsw_bench [-n secoes] [-g gs]\n");
+            return 2;
+        }
+    }
+    // Cada seção usa dois nós (o do capacitor e o interno do RL)
+    if (sections < 0 || 2 * sections + 4 > MS_MAX_NODES || !(gs > 0.0f)) {
+        fprintf(stderr, "secoes entre 0 e %d, gs > 0\n", (MS_MAX_NODES - 4) / 2);
+        return 2;
+    }
+
+    printf("boost %g V -> %g V ideal (d=%g, %g kHz), filtro de %d secoes, dt=%g us, gs=%g S\n",
+           (double)BENCH_VIN, (double)(BENCH_VIN / (1.0f - BENCH_DUTY)), (double)BENCH_DUTY,
+           (double)(BENCH_FSW * 1e-3f), sections, (double)(BENCH_DT * 1e6f), (double)gs);
+    printf("%-24s %3s %7s %6s %7s %8s %7s %7s %7s\n", "caso", "n", "passos",
+           "evento", "fatora", "us/passo", "v(out)", "erro", "sobre");
+
+    int status = 0;
+    for (size_t i = 0; i < sizeof cases / sizeof cases[0] && status == 0; i++)
+        status = run_case(&cases[i], sections, gs);
+    return status != 0;
+}
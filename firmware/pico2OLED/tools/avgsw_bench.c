@@ -0,0 +1,200 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Comparação da célula PWM média (ms_add_avg_switch) com o modelo
+ * chaveado do mesmo boost, no host e com o mesmo motor do firmware.
+ * O modelo chaveado usa interruptor + diodo ideal (interruptor
+ * controlado pela própria tensão) com eventos e passo de 1 us; o médio
+ * roda com o passo do firmware (100 us). Em cada caso a razão cíclica
+ * sofre um degrau depois do regime e, a partir dele, a saída média do
+ * chaveado (média em cada passo do modelo médio) é comparada com a do
+ * modelo médio. Uma carga leve leva o conversor ao DCM.
+ *
+ * Compilação (no diretório firmware/pico2OLED):
+ *   gcc -O2 -DMS_HOST_BUILD -I. tools/avgsw_bench.c mini_spiceHILv3.c \
+ *       -lm -o avgsw_bench
+ *
+ * Uso:
+ *   ./avgsw_bench                 (tabela resumida)
+ *   ./avgsw_bench -o boost.csv    (formas de onda: t, chaveado, médio)
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "mini_spiceHILv3.h"
+
+// Boost de referência
+#define BENCH_VIN       5.0f
+#define BENCH_L         1e-3f
+#define BENCH_C         22e-6f
+#define BENCH_FSW       20e3f
+#define BENCH_DT_SW     1e-6f       // modelo chaveado
+#define BENCH_DT_AVG    100e-6f     // modelo médio (passo do firmware)
+#define BENCH_T_STEP    0.040f      // degrau de razão cíclica (após o regime)
+#define BENCH_T_END     0.070f
+
+// Nós
+#define N_IN    1
+#define N_SW    2
+#define N_OUT   3
+#define N_GATE  4
+
+typedef struct {
+    const char *name;
+    float rload;
+    float d0, d1;
+} bench_case_t;
+
+static const bench_case_t cases[] = {
+    { "CCM", 20.0f,  0.30f, 0.50f },
+    { "DCM", 500.0f, 0.20f, 0.30f },
+};
+
+static ms_circuit_t sw, avg;
+static float sw_mem[MS_MEM_MAX_BYTES / sizeof(float)];
+static float avg_mem[MS_MEM_MAX_BYTES / sizeof(float)];
+
+// Modelo chaveado. Retorna o índice da fonte de gate.
+static int build_switching(ms_circuit_t *c, float rload, float d)
+{
+    ms_circuit_init(c, 4, BENCH_DT_SW);
+    ms_set_solver(c, MS_SOLVER_GAUSS);
+    ms_set_events(c, 1);
+
+    ms_add_voltage_source(c, N_IN, 0, BENCH_VIN);
+    ms_add_inductor(c, N_IN, N_SW, BENCH_L);
+
+    int g = ms_add_voltage_source(c, N_GATE, 0, 0.0f);
+    ms_set_source_pulse(c, g, 0.0f, 5.0f, 0.0f, 0.0f, 0.0f,
+                        d / BENCH_FSW, 1.0f / BENCH_FSW);
+    ms_add_resistor(c, N_GATE, 0, 1e3f);
+    ms_add_switch(c, N_SW, 0, N_GATE, 0, 0.05f, 100e3f, 2.5f);
+
+    // Diodo ideal: conduz enquanto v(sw) > v(out)
+    ms_add_switch(c, N_SW, N_OUT, N_SW, N_OUT, 0.05f, 100e3f, 0.0f);
+
+    ms_add_capacitor(c, N_OUT, 0, BENCH_C);
+    ms_add_resistor(c, N_OUT, 0, rload);
+    return g;
+}
+
+// Modelo médio. Retorna o índice da célula.
+static int build_average(ms_circuit_t *c, float rload, float d)
+{
+    ms_circuit_init(c, 3, BENCH_DT_AVG);
+    ms_set_solver(c, MS_SOLVER_GAUSS);
+
+    ms_add_voltage_source(c, N_IN, 0, BENCH_VIN);
+    ms_add_inductor(c, N_IN, N_SW, BENCH_L);
+    // a = chave ativa (terra), p = diodo (saída), c = indutor
+    int cell = ms_add_avg_switch(c, 0, N_OUT, N_SW, d, BENCH_L, BENCH_FSW);
+    ms_add_capacitor(c, N_OUT, 0, BENCH_C);
+    ms_add_resistor(c, N_OUT, 0, rload);
+    return cell;
+}
+
+static int run_case(const bench_case_t *k, FILE *csv)
+{
+    int g    = build_switching(&sw, k->rload, k->d0);
+    int cell = build_average(&avg, k->rload, k->d0);
+    ms_circuit_finalize(&sw, sw_mem, sizeof sw_mem);
+    ms_circuit_finalize(&avg, avg_mem, sizeof avg_mem);
+
+    uint32_t sw_steps = 0, avg_steps = 0;
+    double sw_cpu = 0.0, avg_cpu = 0.0;
+    double err2 = 0.0, err_max = 0.0;
+    int n = 0, status = 0;
+    float v_prev = 0.0f;
+
+    while (avg.t < BENCH_T_END - 0.5f * BENCH_DT_AVG) {
+        float t_end = avg.t + BENCH_DT_AVG;
+        float d = t_end > BENCH_T_STEP ? k->d1 : k->d0;
+        sw.elem[g].src.width  = d / BENCH_FSW;
+        avg.elem[cell].src.dc = d;
+
+        // Chaveado até o fim do passo médio, com a média da saída
+        clock_t c0 = clock();
+        double acc = 0.0, tacc = 0.0;
+        while (sw.t < t_end - 0.5f * BENCH_DT_SW) {
+            float t0 = sw.t;
+            status = ms_circuit_step(&sw);
+            if (status != 0) break;
+            acc  += (double)ms_get_node_voltage(&sw, N_OUT) * (sw.t - t0);
+            tacc += sw.t - t0;
+            sw_steps++;
+        }
+        clock_t c1 = clock();
+        if (status == 0) status = ms_circuit_step(&avg);
+        clock_t c2 = clock();
+        if (status != 0) {
+            fprintf(stderr, "%s: t=%g: %s\n", k->name, (double)avg.t,
+                    ms_system_status_str(status));
+            return status;
+        }
+        avg_steps++;
+        sw_cpu  += (double)(c1 - c0) / CLOCKS_PER_SEC;
+        avg_cpu += (double)(c2 - c1) / CLOCKS_PER_SEC;
+
+        // Média do médio no mesmo intervalo (trapézio)
+        float v_avg  = ms_get_node_voltage(&avg, N_OUT);
+        double m_sw  = tacc > 0.0 ? acc / tacc : 0.0;
+        double m_avg = 0.5 * (v_prev + v_avg);
+        v_prev = v_avg;
+
+        if (avg.t > BENCH_T_STEP) {
+            double e = fabs(m_sw - m_avg);
+            err2 += e * e;
+            if (e > err_max) err_max = e;
+            n++;
+        }
+
+        if (csv) fprintf(csv, "%s,%.6g,%.6g,%.6g,%.4g\n", k->name,
+                         (double)avg.t, m_sw, m_avg, (double)avg.elem[cell].state);
+    }
+
+    // Valor final e referência de regime (CCM: Vin / (1 - d))
+    float v_end = ms_get_node_voltage(&avg, N_OUT);
+    float v_ccm = BENCH_VIN / (1.0f - k->d1);
+    float kdcm  = 2.0f * BENCH_L * BENCH_FSW / k->rload;
+    float v_dcm = BENCH_VIN * 0.5f * (1.0f + sqrtf(1.0f + 4.0f * k->d1 * k->d1 / kdcm));
+    int   dcm   = kdcm < k->d1 * (1.0f - k->d1) * (1.0f - k->d1);
+
+    printf("%s  R=%gohm  d %.2f->%.2f  (%s, regime %.3f V)\n", k->name,
+           (double)k->rload, (double)k->d0, (double)k->d1,
+           dcm ? "DCM" : "CCM", (double)(dcm ? v_dcm : v_ccm));
+    printf("  chaveado: %7lu passos + %lu eventos  cpu %.3f s\n",
+           (unsigned long)sw_steps, (unsigned long)sw.event_splits, sw_cpu);
+    printf("  medio:    %7lu passos               cpu %.4f s  (mu=%.3f)\n",
+           (unsigned long)avg_steps, avg_cpu, (double)avg.elem[cell].state);
+    printf("  v(out) final %.3f V   erro após o degrau: rms %.4f V  max %.4f V\n",
+           (double)v_end, sqrt(err2 / n), err_max);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *csv = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            csv = fopen(argv[++i], "w");
+            if (!csv) { perror(argv[i]); return 1; }
+            fprintf(csv, "caso,t,v_chaveado,v_medio,mu\n");
+        } else {
+            fprintf(stderr, "uso: avgsw_bench [-o ondas.csv]\n");
+            return 2;
+        }
+    }
+
+    int status = 0;
+    for (size_t i = 0; i < sizeof cases / sizeof cases[0] && status == 0; i++)
+        status = run_case(&cases[i], csv);
+
+    if (csv) fclose(csv);
+    return status != 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Conferência e custo dos núcleos dos solvers (ms_kernels.h) no host.
+ *   1. núcleos isolados: axpy e produto escalar, versão rápida contra a
+ *      portátil (diferença máxima relativa e tempo por elemento);
+ *   2. solvers completos (Gauss e LU do motor, com os núcleos escolhidos
+ *      na compilação) em sistemas do tipo MNA: diagonal dominante, com
+ *      uma fração de termos fora da diagonal. O resíduo ||A x - b|| /
+ *      ||b|| é calculado em double contra a matriz original.
+ * Compilar as duas versões e comparar as tabelas.
+ *
+ * Compilação (no diretório firmware/pico2OLED):
+ *   gcc -O2 -DMS_HOST_BUILD -I. tools/kernel_bench.c mini_spiceHILv3.c \
+ *       -lm -o kernel_bench                                   (portátil)
+ *   gcc -O2 -mfma -DMS_HOST_BUILD -DMS_KERNELS_FAST -I. tools/kernel_bench.c \
+ *       mini_spiceHILv3.c -lm -o kernel_bench_fast            (rápida)
+ *   Sem -mfma (x86) a fmaf é uma chamada de biblioteca: o resultado
+ *   confere, mas o tempo não representa o M33.
+ *
+ * Uso:
+ *   ./kernel_bench [-d densidade]     (fração fora da diagonal, padrão 0.2)
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "mini_spiceHILv3.h"
+#include "ms_kernels.h"
+
+#define BENCH_N_MAX     MS_MAX_SIZE
+
+static float  mem_a[BENCH_N_MAX * BENCH_N_MAX];
+static float  mem_w[BENCH_N_MAX * BENCH_N_MAX];
+static float *A[BENCH_N_MAX], *W[BENCH_N_MAX];
+static float  b[BENCH_N_MAX], bw[BENCH_N_MAX], x[BENCH_N_MAX];
+
+static uint32_t rng = 12345u;
+static float frand(void)                // [-1, 1)
+{
+    rng = rng * 1664525u + 1013904223u;
+    return (float)(rng >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ======================================================
+// NÚCLEOS ISOLADOS
+// ======================================================
+
+static void bench_kernels(void)
+{
+    enum { LEN = 64, REPS = 200000 };
+    static float xa[LEN], ya[LEN], yr[LEN], yf[LEN];
+    for (int j = 0; j < LEN; j++) { xa[j] = frand(); ya[j] = frand(); }
+
+    double err_axpy = 0.0, err_dot = 0.0;
+    for (int n = 0; n <= LEN; n++) {
+        memcpy(yr, ya, sizeof yr);
+        memcpy(yf, ya, sizeof yf);
+        ms_k_axpy_ref(yr, xa, 0.37f, n);
+        ms_k_axpy_fast(yf, xa, 0.37f, n);
+        for (int j = 0; j < n; j++) {
+            double e = fabs((double)yr[j] - yf[j]) / (fabs((double)yr[j]) + 1e-30);
+            if (e > err_axpy) err_axpy = e;
+        }
+        double ref = 0.0, mag = 0.0;
+        for (int j = 0; j < n; j++) {
+            ref += (double)xa[j] * ya[j];
+            mag += fabs((double)xa[j] * ya[j]);
+        }
+        double e = fabs(ms_k_dot_fast(xa, ya, n) - ref) / (mag + 1e-30);
+        if (e > err_dot) err_dot = e;
+        e = fabs(ms_k_dot_ref(xa, ya, n) - ref) / (mag + 1e-30);
+        if (e > err_dot) err_dot = e;
+    }
+
+    volatile float sink = 0.0f;
+    double t0 = seconds();
+    for (int r = 0; r < REPS; r++) ms_k_axpy_ref(yr, xa, 1e-7f, LEN);
+    double t1 = seconds();
+    for (int r = 0; r < REPS; r++) ms_k_axpy_fast(yf, xa, 1e-7f, LEN);
+    double t2 = seconds();
+    for (int r = 0; r < REPS; r++) sink += ms_k_dot_ref(xa, ya, LEN);
+    double t3 = seconds();
+    for (int r = 0; r < REPS; r++) sink += ms_k_dot_fast(xa, ya, LEN);
+    double t4 = seconds();
+    (void)sink;
+
+    double k = 1e9 / ((double)REPS * LEN);
+    printf("nucleos (n=%d): axpy ref %.2f ns/elem, rapido %.2f (dif. rel. max %.1e)\n",
+           LEN, (t1 - t0) * k, (t2 - t1) * k, err_axpy);
+    printf("                dot  ref %.2f ns/elem, rapido %.2f (erro rel. max %.1e)\n",
+           (t3 - t2) * k, (t4 - t3) * k, err_dot);
+}
+
+// ======================================================
+// SOLVERS
+// ======================================================
+
+static void make_system(int n, float density)
+{
+    for (int i = 0; i < n; i++) {
+        A[i] = &mem_a[i * n];
+        W[i] = &mem_w[i * n];
+        float off = 0.0f;
+        for (int j = 0; j < n; j++) {
+            float v = 0.0f;
+            if (j != i && (frand() + 1.0f) * 0.5f < density) v = frand();
+            A[i][j] = v;
+            off += fabsf(v);
+        }
+        A[i][i] = off + 0.5f + (frand() + 1.0f);
+        b[i] = frand();
+    }
+}
+
+static void copy_system(int n)
+{
+    for (int i = 0; i < n; i++) {
+        memcpy(W[i], A[i], (size_t)n * sizeof(float));
+        bw[i] = b[i];
+        x[i] = 0.0f;
+    }
+}
+
+static double residual(int n)
+{
+    double r = 0.0, nb = 0.0;
+    for (int i = 0; i < n; i++) {
+        double s = -(double)b[i];
+        for (int j = 0; j < n; j++) s += (double)A[i][j] * x[j];
+        r  += s * s;
+        nb += (double)b[i] * b[i];
+    }
+    return sqrt(r / nb);
+}
+
+static void bench_solvers(float density)
+{
+    static const int sizes[] = { 4, 8, 16, 32, 48, 64, BENCH_N_MAX };
+
+    printf("%4s %12s %10s %12s %10s\n", "n", "Gauss us", "residuo", "LU us", "residuo");
+    for (size_t s = 0; s < sizeof sizes / sizeof sizes[0]; s++) {
+        int n = sizes[s];
+        int reps = 200000 / (n * n) + 10;
+        make_system(n, density);
+
+        double tg = 0.0, tl = 0.0, rg, rl;
+        for (int r = 0; r < reps; r++) {
+            copy_system(n);
+            double t0 = seconds();
+            ms_gauss_solve(n, W, bw, x);
+            tg += seconds() - t0;
+        }
+        rg = residual(n);
+
+        for (int r = 0; r < reps; r++) {
+            copy_system(n);
+            double t0 = seconds();
+            ms_lu_factor(n, W);
+            ms_lu_subst(n, W, bw, x);
+            tl += seconds() - t0;
+        }
+        rl = residual(n);
+
+        printf("%4d %12.3f %10.2e %12.3f %10.2e\n", n,
+               tg * 1e6 / reps, rg, tl * 1e6 / reps, rl);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    float density = 0.2f;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-d") && i + 1 < argc) density = strtof(argv[++i], NULL);
+        else {
+            fprintf(stderr, "uso: kernel_bench [-d densidade]\n");
+            return 2;
+        }
+    }
+
+#ifdef MS_KERNELS_FAST
+    printf("solvers com os nucleos rapidos (fmaf, desenrolados)\n");
+#else
+    printf("solvers com os nucleos portateis\n");
+#endif
+    bench_kernels();
+    bench_solvers(density);
+    return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Gera imagens binárias de circuito (ms_image.h) para gravar nos slots
+ * da flash. A origem é o próprio circuit.c (setup_circuit() com o
+ * EXEMPLO_* selecionado, exatamente como no firmware) ou uma netlist em
+ * texto no formato do ms_netlist.h.
+ *
+ * Compilação (no diretório firmware/pico2OLED):
+ *   gcc -O2 -DMS_HOST_BUILD -I. tools/ms_imgtool.c ms_image.c ms_netlist.c \
+ *       mini_spiceHILv3.c circuit.c -lm -o ms_imgtool
+ *
+ * Uso:
+ *   ./ms_imgtool -o rlc.bin [-n nome] [-s slot]        (a partir do circuit.c)
+ *   ./ms_imgtool -i boost.cir -o boost.bin [-s slot]   (a partir de netlist)
+ *   ./ms_imgtool -c rlc.bin                            (confere e lista)
+ *
+ * Gravação no slot escolhido (Pico 2, flash de 4 MB; ver -f):
+ *   picotool load -o <endereço impresso> rlc.bin
+ * O slot carregado no boot é escolhido pelo console com !boot 1..3 (fica
+ * gravado na flash); !boot 0 volta ao circuito compilado.
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ms_image.h"
+#include "ms_netlist.h"
+
+#define XIP_BASE_ADDR   0x10000000u
+
+extern void setup_circuit(ms_circuit_t *c, volatile float *adc_in, volatile float *io_in);
+
+// output_circuit() do circuit.c escreve no PWMDAC; no host não há saída
+void pwmdac_set(int channel, uint16_t level) { (void)channel; (void)level; }
+
+// Entradas externas com a mesma numeração do firmware: adc0..2, io0
+static volatile float ext_val[MS_NL_MAX_EXT];
+static volatile float *const ext_in[MS_NL_MAX_EXT] = {
+    &ext_val[0], &ext_val[1], &ext_val[2], &ext_val[3],
+    &ext_val[4], &ext_val[5], &ext_val[6], &ext_val[7],
+    &ext_val[8], &ext_val[9], &ext_val[10]
+};
+
+static ms_circuit_t  circuit;
+static ms_netlist_t  netlist;
+static uint8_t       image[MS_IMG_SLOT_SIZE];
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "uso: ms_imgtool [-i netlist.cir] -o saida.bin [-n nome] [-s slot] [-f flash_mb]\n"
+        "     ms_imgtool -c imagem.bin\n");
+    exit(2);
+}
+
+static size_t read_file(const char *path, void *buf, size_t cap)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) { perror(path); exit(1); }
+    size_t n = fread(buf, 1, cap, f);
+    fclose(f);
+    return n;
+}
+
+// Lê a netlist inteira em memória (para medir só o parsing)
+static char text[32768];
+
+static int parse_netlist(const char *src, int verbose)
+{
+    char line[MS_NL_LINE_LEN + 2];
+    const char *p = src;
+    int st = MS_NL_OK;
+
+    ms_netlist_begin(&netlist, &circuit, ext_in, MS_NL_MAX_EXT);
+    while (*p) {
+        size_t n = strcspn(p, "\n");
+        size_t k = n < sizeof line - 1 ? n : sizeof line - 1;
+        memcpy(line, p, k);
+        line[k] = '\0';
+        p += n + (p[n] == '\n');
+
+        st = ms_netlist_line(&netlist, line);
+        if (st < 0 && verbose) fprintf(stderr, "%s\n", netlist.diag);
+        if (st == MS_NL_DONE || st == MS_NL_ERR_FAILED) break;
+    }
+    return st;
+}
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+    const char *in = NULL, *out = NULL, *check = NULL, *name = NULL;
+    int slot = 0, flash_mb = 4;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) usage();
+        if      (!strcmp(argv[i], "-i")) in    = argv[++i];
+        else if (!strcmp(argv[i], "-o")) out   = argv[++i];
+        else if (!strcmp(argv[i], "-c")) check = argv[++i];
+        else if (!strcmp(argv[i], "-n")) name  = argv[++i];
+        else if (!strcmp(argv[i], "-s")) slot  = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-f")) flash_mb = atoi(argv[++i]);
+        else usage();
+    }
+
+    // --------------------------------------------------
+    // Conferência de uma imagem existente
+    // --------------------------------------------------
+    if (check) {
+        size_t n = read_file(check, image, sizeof image);
+        int st = ms_image_load(&circuit, image, n, ext_in, MS_NL_MAX_EXT);
+        if (st != MS_IMG_OK) {
+            fprintf(stderr, "%s: %s\n", check, ms_image_status_str(st));
+            return 1;
+        }
+        const ms_img_header_t *h = (const ms_img_header_t *)image;
+        printf("%s: '%s' %u bytes, CRC %08X, dt=%g s, solver %u%s%s, %d sondas\n",
+               check, h->name, h->total_size, h->crc32, h->dt,
+               h->solver & ~MS_IMG_SOLVER_FLAGS,
+               circuit.events ? " +eventos" : "",
+               circuit.l_norton ? " +norton" : "", circuit.probes);
+        ms_list_elements(&circuit);
+        return 0;
+    }
+
+    if (!out) usage();
+
+    // --------------------------------------------------
+    // Monta o circuito: netlist em texto ou circuit.c
+    // --------------------------------------------------
+    if (in) {
+        size_t n = read_file(in, text, sizeof text - 1);
+        text[n] = '\0';
+        if (parse_netlist(text, 1) != MS_NL_DONE) {
+            fprintf(stderr, "%s: %s\n", in, netlist.diag);
+            return 1;
+        }
+        if (!name) {
+            const char *b = strrchr(in, '/');
+            name = b ? b + 1 : in;
+        }
+    } else {
+        setup_circuit(&circuit, ext_in[0], ext_in[3]);
+        if (!name) name = "circuit.c";
+    }
+
+    int size = ms_image_build(&circuit, ext_in, MS_NL_MAX_EXT, name, image, sizeof image);
+    if (size < 0) {
+        fprintf(stderr, "erro ao gerar imagem: %s\n", ms_image_status_str(size));
+        return 1;
+    }
+
+    FILE *f = fopen(out, "wb");
+    if (!f || fwrite(image, 1, (size_t)size, f) != (size_t)size) { perror(out); return 1; }
+    fclose(f);
+
+    const ms_img_header_t *h = (const ms_img_header_t *)image;
+    printf("%s: %d bytes (%d elementos, %d sondas), CRC %08X\n",
+           out, size, circuit.elems, circuit.probes, h->crc32);
+
+    // Comparação de tempo de carga: texto x imagem (host). As duas cargas
+    // começam com ms_circuit_init(), que limpa a estrutura do circuito;
+    // esse custo comum é medido à parte para mostrar só a decodificação.
+    if (in) {
+        const int reps = 2000;
+        double t0 = seconds();
+        for (int i = 0; i < reps; i++) parse_netlist(text, 0);
+        double t1 = seconds();
+        for (int i = 0; i < reps; i++)
+            ms_image_load(&circuit, image, (size_t)size, ext_in, MS_NL_MAX_EXT);
+        double t2 = seconds();
+        for (int i = 0; i < reps; i++) ms_circuit_init(&circuit, 1, 1e-4f);
+        double t3 = seconds();
+        double init = (t3 - t2) * 1e6 / reps;
+        double txt  = (t1 - t0) * 1e6 / reps - init;
+        double img  = (t2 - t1) * 1e6 / reps - init;
+        printf("decodificacao no host: texto %.3f us, imagem %.3f us (%.0fx)"
+               " + ms_circuit_init %.2f us\n", txt, img, txt / img, init);
+    }
+
+    if (slot >= 1 && slot <= MS_IMG_SLOTS) {
+        uint32_t addr = XIP_BASE_ADDR +
+                        MS_IMG_SLOT_OFFSET((uint32_t)flash_mb << 20, slot);
+        printf("slot %d: picotool load -o 0x%08X %s\n", slot, addr, out);
+    }
+    return 0;
+}
@@ -0,0 +1,332 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Redução de Kron no host: elimina os nós internos de sub-redes
+ * resistivas (escadas de carga, divisores de medição) e grava o circuito
+ * reduzido como imagem binária (ms_image.h). No alvo o custo da solução
+ * passa a depender dos nós de interface e dos estados, não da contagem
+ * original de nós.
+ *
+ * Um nó é eliminado quando só toca resistores e não é sondado, não é
+ * controle de fonte/chave nem terminal comum de célula PWM, nem foi
+ * mantido com -k. A matriz de condutâncias desses resistores (com o
+ * terra como linha comum) é reduzida nó a nó pelo complemento de Schur,
+ *   G' = G_pp - G_pi G_ii^-1 G_ip,
+ * em double. O resultado continua sendo uma rede resistiva: cada
+ * G'[i][j] < 0 vira um resistor -1/G'[i][j] entre os nós de interface i e
+ * j (j = 0 é o terra). Os demais elementos e as sondas são copiados com os
+ * nós renumerados. Resistores sondados com I(R) ficam como estão.
+ *
+ * Compilação (no diretório firmware/pico2OLED):
+ *   gcc -O2 -DMS_HOST_BUILD -I. tools/ms_kron.c ms_image.c ms_netlist.c \
+ *       mini_spiceHILv3.c -lm -o ms_kron
+ *
+ * Uso:
+ *   ./ms_kron -i escada.cir -o escada.bin [-k nó]... [-n nome]
+ *   ./ms_kron -i escada.cir -o escada.bin -T 0.1   (confere: simula as duas)
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "ms_image.h"
+#include "ms_netlist.h"
+
+// Condutância relativa à maior diagonal abaixo da qual o ramo é descartado
+#define KRON_G_RELTOL   1e-9
+
+static volatile float ext_val[MS_NL_MAX_EXT];
+static volatile float *const ext_in[MS_NL_MAX_EXT] = {
+    &ext_val[0], &ext_val[1], &ext_val[2], &ext_val[3],
+    &ext_val[4], &ext_val[5], &ext_val[6], &ext_val[7],
+    &ext_val[8], &ext_val[9], &ext_val[10]
+};
+
+static ms_circuit_t  full, reduced;
+static float         full_mem[MS_MEM_MAX_BYTES / sizeof(float)];
+static float         reduced_mem[MS_MEM_MAX_BYTES / sizeof(float)];
+static ms_netlist_t  netlist;
+static uint8_t       image[MS_IMG_SLOT_SIZE];
+
+// Laplaciano da sub-rede resistiva (índice 0 = terra)
+static double G[MS_MAX_NODES + 1][MS_MAX_NODES + 1];
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "uso: ms_kron -i netlist.cir -o saida.bin [-k no]... [-n nome] [-T tfinal]\n");
+    exit(2);
+}
+
+static int load_netlist(const char *path)
+{
+    char line[256];
+    FILE *f = fopen(path, "r");
+    if (!f) { perror(path); return -1; }
+
+    ms_netlist_begin(&netlist, &full, ext_in, MS_NL_MAX_EXT);
+    int st = MS_NL_OK;
+    while (st == MS_NL_OK && fgets(line, sizeof line, f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        st = ms_netlist_line(&netlist, line);
+        if (st < 0) fprintf(stderr, "%s: %s\n", path, netlist.diag);
+    }
+    fclose(f);
+    if (st != MS_NL_DONE) {
+        if (st >= 0) fprintf(stderr, "%s: falta .end\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+// ======================================================
+// ESCOLHA DOS NÓS
+// ======================================================
+
+// keep[n] != 0: o nó fica no circuito reduzido
+static void mark_kept(const ms_circuit_t *c, int *keep)
+{
+    int only_r[MS_MAX_NODES + 1];
+    for (int n = 0; n <= c->nodes; n++) only_r[n] = 1;
+
+    for (int i = 0; i < c->elems; i++) {
+        const ms_element_t *e = &c->elem[i];
+        if (e->type != MS_ELEM_R || e->value <= 0.0f) {
+            only_r[e->a] = only_r[e->b] = 0;
+        }
+        // Nós de controle (E, G, S) e terminal comum da célula PWM
+        only_r[e->c1] = only_r[e->c2] = 0;
+    }
+
+    for (int i = 0; i < c->probes; i++) {
+        const ms_probe_def_t *d = &c->probe[i].def;
+        if (d->type == MS_PROBE_CURRENT) {
+            if (d->a >= 0 && d->a < c->elems)
+                only_r[c->elem[d->a].a] = only_r[c->elem[d->a].b] = 0;
+        } else {
+            if (d->a >= 0 && d->a <= c->nodes) only_r[d->a] = 0;
+            if (d->type == MS_PROBE_DIFF && d->b >= 0 && d->b <= c->nodes) only_r[d->b] = 0;
+        }
+    }
+
+    keep[0] = 1;
+    for (int n = 1; n <= c->nodes; n++)
+        keep[n] = keep[n] || !only_r[n];
+}
+
+// ======================================================
+// REDUÇÃO
+// ======================================================
+
+// Elimina os nós não mantidos do laplaciano G, um por vez
+static int kron_eliminate(int nodes, const int *keep)
+{
+    int removed = 0;
+    for (int k = 1; k <= nodes; k++) {
+        if (keep[k]) continue;
+        double pivot = G[k][k];
+        if (pivot > 0.0) {
+            for (int i = 0; i <= nodes; i++) {
+                if (i == k || G[i][k] == 0.0) continue;
+                double f = G[i][k] / pivot;
+                for (int j = 0; j <= nodes; j++)
+                    if (j != k) G[i][j] -= f * G[k][j];
+            }
+        }
+        // Sem ligação (pivô nulo): o nó não influencia nada, só sai
+        for (int i = 0; i <= nodes; i++) G[i][k] = G[k][i] = 0.0;
+        removed++;
+    }
+    return removed;
+}
+
+// Monta o circuito reduzido. Retorna o número de resistores equivalentes
+// ou -1 se não couber em MS_MAX_ELEMS.
+static int build_reduced(const ms_circuit_t *c, const int *keep, ms_circuit_t *r)
+{
+    int map[MS_MAX_NODES + 1];
+    int emap[MS_MAX_ELEMS];
+    int n_new = 0;
+
+    for (int n = 0; n <= c->nodes; n++)
+        map[n] = keep[n] ? (n == 0 ? 0 : ++n_new) : -1;
+
+    ms_circuit_init(r, n_new, c->dt);
+    ms_set_solver(r, c->solver);
+    ms_set_sor(r, c->sor_auto ? 0.0f : c->sor_omega, c->sor_redblack);
+    ms_set_cg(r, (ms_cg_precond_t)c->cg_precond);
+    ms_set_events(r, c->events);
+    ms_set_inductor_norton(r, c->l_norton);
+
+    // Elementos fora da sub-rede reduzida, com os nós renumerados
+    for (int i = 0; i < c->elems; i++) {
+        const ms_element_t *e = &c->elem[i];
+        emap[i] = -1;
+        if (e->type == MS_ELEM_R && (!keep[e->a] || !keep[e->b])) continue;
+        if (r->elems >= MS_MAX_ELEMS) return -1;
+
+        ms_element_t *d = &r->elem[r->elems];
+        *d = *e;
+        d->a  = map[e->a];
+        d->b  = map[e->b];
+        d->c1 = map[e->c1];
+        d->c2 = map[e->c2];
+        emap[i] = r->elems++;
+    }
+    for (int i = 0; i < r->elems; i++) {
+        ms_element_t *d = &r->elem[i];
+        if (d->type == MS_ELEM_CCCS || d->type == MS_ELEM_CCVS)
+            d->ctrl_elem = emap[d->ctrl_elem];
+    }
+
+    // Resistores equivalentes entre os nós de interface
+    double gmax = 0.0;
+    for (int i = 1; i <= c->nodes; i++)
+        if (G[i][i] > gmax) gmax = G[i][i];
+
+    int added = 0;
+    for (int i = 1; i <= c->nodes; i++) {
+        for (int j = 0; j < i; j++) {
+            double g = -G[i][j];
+            if (!keep[i] || !keep[j] || g <= KRON_G_RELTOL * gmax) continue;
+            if (ms_add_resistor(r, map[i], map[j], (float)(1.0 / g)) < 0) return -1;
+            added++;
+        }
+    }
+
+    for (int i = 0; i < c->probes; i++) {
+        ms_probe_def_t d = c->probe[i].def;
+        if (d.type == MS_PROBE_CURRENT) {
+            d.a = emap[d.a];
+        } else {
+            d.a = map[d.a];
+            if (d.type == MS_PROBE_DIFF) d.b = map[d.b];
+        }
+        ms_add_probe(r, &d);
+    }
+    return added;
+}
+
+// ======================================================
+// CONFERÊNCIA
+// ======================================================
+
+// Simula o circuito até tstop; grava as sondas de cada passo em out[]
+static double run(ms_circuit_t *c, float tstop, float *out, int max_rows, int *rows)
+{
+    int n = 0;
+    clock_t t0 = clock();
+    while (c->t < tstop - 0.5f * c->dt && n < max_rows) {
+        int st = ms_circuit_step(c);
+        if (st != 0) {
+            fprintf(stderr, "t=%g: %s\n", (double)c->t, ms_system_status_str(st));
+            break;
+        }
+        ms_probes_eval(c, NULL, 0);
+        for (int p = 0; p < c->probes; p++)
+            out[n * MS_MAX_PROBES + p] = c->probe[p].value;
+        n++;
+    }
+    *rows = n;
+    return (double)(clock() - t0) / CLOCKS_PER_SEC;
+}
+
+#define KRON_MAX_ROWS   200000
+
+static float rows_full[KRON_MAX_ROWS * MS_MAX_PROBES];
+static float rows_red[KRON_MAX_ROWS * MS_MAX_PROBES];
+
+static void compare(float tstop)
+{
+    int nf, nr;
+    ms_circuit_finalize(&full, full_mem, sizeof full_mem);
+    ms_circuit_finalize(&reduced, reduced_mem, sizeof reduced_mem);
+    double cf = run(&full, tstop, rows_full, KRON_MAX_ROWS, &nf);
+    double cr = run(&reduced, tstop, rows_red, KRON_MAX_ROWS, &nr);
+    int n = nf < nr ? nf : nr;
+
+    printf("conferencia ate t=%g s (%d passos)\n", (double)tstop, n);
+    printf("  original: sistema %2d, %.3f us/passo\n",
+           full.reduced_size, nf ? cf * 1e6 / nf : 0.0);
+    printf("  reduzido: sistema %2d, %.3f us/passo\n",
+           reduced.reduced_size, nr ? cr * 1e6 / nr : 0.0);
+
+    for (int p = 0; p < full.probes; p++) {
+        double err = 0.0, mag = 0.0;
+        for (int i = 0; i < n; i++) {
+            double a = rows_full[i * MS_MAX_PROBES + p];
+            double b = rows_red[i * MS_MAX_PROBES + p];
+            if (fabs(a - b) > err) err = fabs(a - b);
+            if (fabs(a) > mag) mag = fabs(a);
+        }
+        printf("  sonda %d: erro max %.3g (pico %.3g)\n", p, err, mag);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *in = NULL, *out = NULL, *name = NULL;
+    float tstop = 0.0f;
+    int keep[MS_MAX_NODES + 1] = { 0 };
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) usage();
+        if      (!strcmp(argv[i], "-i")) in    = argv[++i];
+        else if (!strcmp(argv[i], "-o")) out   = argv[++i];
+        else if (!strcmp(argv[i], "-n")) name  = argv[++i];
+        else if (!strcmp(argv[i], "-T")) tstop = strtof(argv[++i], NULL);
+        else if (!strcmp(argv[i], "-k")) {
+            int n = atoi(argv[++i]);
+            if (n < 1 || n > MS_MAX_NODES) usage();
+            keep[n] = 1;
+        } else usage();
+    }
+    if (!in || !out) usage();
+    if (load_netlist(in) != 0) return 1;
+    if (!name) {
+        const char *b = strrchr(in, '/');
+        name = b ? b + 1 : in;
+    }
+
+    mark_kept(&full, keep);
+
+    // Laplaciano só dos resistores que tocam um nó eliminado
+    for (int i = 0; i < full.elems; i++) {
+        const ms_element_t *e = &full.elem[i];
+        if (e->type != MS_ELEM_R || (keep[e->a] && keep[e->b])) continue;
+        double g = 1.0 / e->value;
+        G[e->a][e->a] += g;
+        G[e->b][e->b] += g;
+        G[e->a][e->b] -= g;
+        G[e->b][e->a] -= g;
+    }
+
+    int removed = kron_eliminate(full.nodes, keep);
+    int added = build_reduced(&full, keep, &reduced);
+    if (added < 0) {
+        fprintf(stderr, "circuito reduzido excede %d elementos\n", MS_MAX_ELEMS);
+        return 1;
+    }
+
+    printf("%s: %d nos -> %d (%d eliminados), %d elementos -> %d (%d resistores equivalentes)\n",
+           in, full.nodes, reduced.nodes, removed, full.elems, reduced.elems, added);
+    ms_list_elements(&reduced);
+
+    int size = ms_image_build(&reduced, ext_in, MS_NL_MAX_EXT, name, image, sizeof image);
+    if (size < 0) {
+        fprintf(stderr, "erro ao gerar imagem: %s\n", ms_image_status_str(size));
+        return 1;
+    }
+    FILE *f = fopen(out, "wb");
+    if (!f || fwrite(image, 1, (size_t)size, f) != (size_t)size) { perror(out); return 1; }
+    fclose(f);
+    printf("%s: %d bytes, CRC %08X\n", out, size, ((const ms_img_header_t *)image)->crc32);
+
+    if (tstop > 0.0f) compare(tstop);
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Simulação de uma netlist (ms_netlist.h) no host, com o mesmo motor do
+ * firmware, em passo fixo (o da .tran) ou adaptativo (controle por LTE,
+ * ms_circuit_step_adaptive). Grava as sondas em CSV e resume o custo:
+ * passos aceitos, rejeitados e tempo de CPU.
+ *
+ * Compilação (no diretório firmware/pico2OLED):
+ *   gcc -O2 -DMS_HOST_BUILD -I. tools/ms_sim.c ms_netlist.c mini_spiceHILv3.c \
+ *       -lm -o ms_sim
+ *
+ * Uso:
+ *   ./ms_sim -i rlc.cir -T 0.5 -o fixo.csv
+ *   ./ms_sim -i rlc.cir -T 0.5 -a 1u 1m -r 1e-3 -o adapt.csv
+ *   Entradas EXT(n) ficam constantes: -e n valor (0..1, como o ADC)
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ms_netlist.h"
+
+static volatile float ext_val[MS_NL_MAX_EXT];
+static volatile float *const ext_in[MS_NL_MAX_EXT] = {
+    &ext_val[0], &ext_val[1], &ext_val[2], &ext_val[3],
+    &ext_val[4], &ext_val[5], &ext_val[6], &ext_val[7],
+    &ext_val[8], &ext_val[9], &ext_val[10]
+};
+
+static ms_circuit_t  circuit;
+static ms_netlist_t  netlist;
+static ms_adaptive_t adapt;
+static float         circuit_mem[MS_MEM_MAX_BYTES / sizeof(float)];
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "uso: ms_sim -i netlist.cir -T tfinal [-a dtmin dtmax] [-r reltol]\n"
+        "            [-e n valor] [-o saida.csv]\n");
+    exit(2);
+}
+
+// Aceita sufixos de engenharia como a netlist (1u, 10m, ...)
+static float parse_value(const char *s)
+{
+    char *end;
+    float v = strtof(s, &end);
+    switch (*end) {
+    case 'f': v *= 1e-15f; break;
+    case 'p': v *= 1e-12f; break;
+    case 'n': v *= 1e-9f;  break;
+    case 'u': v *= 1e-6f;  break;
+    case 'm': v *= 1e-3f;  break;
+    case 'k': v *= 1e3f;   break;
+    default: break;
+    }
+    return v;
+}
+
+static int load_netlist(const char *path)
+{
+    char line[256];
+    FILE *f = fopen(path, "r");
+    if (!f) { perror(path); return -1; }
+
+    ms_netlist_begin(&netlist, &circuit, ext_in, MS_NL_MAX_EXT);
+    int st = MS_NL_OK;
+    while (st == MS_NL_OK && fgets(line, sizeof line, f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        st = ms_netlist_line(&netlist, line);
+        if (st < 0) fprintf(stderr, "%s: %s\n", path, netlist.diag);
+    }
+    fclose(f);
+    if (st != MS_NL_DONE) {
+        if (st >= 0) fprintf(stderr, "%s: falta .end\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static void write_row(FILE *out)
+{
+    fprintf(out, "%.9g", (double)circuit.t);
+    for (int i = 0; i < circuit.probes; i++)
+        fprintf(out, ",%.7g", (double)circuit.probe[i].value);
+    fprintf(out, "\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *in_path = NULL, *out_path = NULL;
+    float tstop = 0.0f, dt_min = 0.0f, dt_max = 0.0f, reltol = 0.0f;
+
+    for (int i = 1; i < argc; i++) {
+        if      (!strcmp(argv[i], "-i") && i + 1 < argc) in_path  = argv[++i];
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) out_path = argv[++i];
+        else if (!strcmp(argv[i], "-T") && i + 1 < argc) tstop    = parse_value(argv[++i]);
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc) reltol   = parse_value(argv[++i]);
+        else if (!strcmp(argv[i], "-a") && i + 2 < argc) {
+            dt_min = parse_value(argv[++i]);
+            dt_max = parse_value(argv[++i]);
+        } else if (!strcmp(argv[i], "-e") && i + 2 < argc) {
+            int n = atoi(argv[++i]);
+            float v = parse_value(argv[++i]);
+            if (n >= 0 && n < MS_NL_MAX_EXT) ext_val[n] = v;
+        } else usage();
+    }
+    if (!in_path || tstop <= 0.0f) usage();
+    if (load_netlist(in_path) != 0) return 1;
+    ms_circuit_finalize(&circuit, circuit_mem, sizeof circuit_mem);
+
+    FILE *out = NULL;
+    if (out_path) {
+        out = fopen(out_path, "w");
+        if (!out) { perror(out_path); return 1; }
+        fprintf(out, "t");
+        for (int i = 0; i < circuit.probes; i++) fprintf(out, ",p%d", i);
+        fprintf(out, "\n");
+    }
+
+    int adaptive = dt_max > 0.0f;
+    if (adaptive) {
+        if (dt_min <= 0.0f || dt_min > dt_max) usage();
+        ms_adaptive_init(&adapt, dt_min, dt_max);
+        if (reltol > 0.0f) adapt.reltol = reltol;
+    }
+
+    clock_t t0 = clock();
+    uint32_t steps = 0;
+    int status = 0;
+    while (circuit.t < tstop) {
+        status = adaptive ? ms_circuit_step_adaptive(&circuit, &adapt)
+                          : ms_circuit_step(&circuit);
+        if (status != 0) {
+            fprintf(stderr, "t=%g: %s\n", (double)circuit.t, ms_system_status_str(status));
+            break;
+        }
+        steps++;
+        ms_probes_eval(&circuit, NULL, 0);
+        if (out) write_row(out);
+    }
+    double cpu = (double)(clock() - t0) / CLOCKS_PER_SEC;
+    if (out) fclose(out);
+
+    fprintf(stderr, "%s: %lu passos, sistema %d (%d resolvidas)", adaptive ? "adaptativo" : "fixo",
+            (unsigned long)steps, circuit.system_size, circuit.reduced_size);
+    if (adaptive) fprintf(stderr, " (%lu rejeitados)", (unsigned long)adapt.rejected);
+    if (circuit.events) fprintf(stderr, ", %lu eventos", (unsigned long)circuit.event_splits);
+    if (circuit.solver == MS_SOLVER_LU || (circuit.solver == MS_SOLVER_CG && !circuit.cg_active))
+        fprintf(stderr, ", %lu fatoracoes", (unsigned long)circuit.factorizations);
+    if (circuit.solver == MS_SOLVER_GAUSS_SEIDEL && steps > 0)
+        fprintf(stderr, ", %.2f iter/passo (max %lu), omega %.3f%s, %lu sem convergir",
+                (double)circuit.iters_total / steps, (unsigned long)circuit.iters_max,
+                (double)circuit.sor_omega, circuit.sor_colored ? " rb" : "",
+                (unsigned long)circuit.noconv);
+    if (circuit.solver == MS_SOLVER_CG && circuit.cg_active && steps > 0)
+        fprintf(stderr, ", cg %s, %d nao nulos, %.2f iter/passo (max %lu), %lu sem convergir",
+                circuit.cg_ic ? "ic" : "jacobi", circuit.cg_nnz,
+                (double)circuit.iters_total / steps, (unsigned long)circuit.iters_max,
+                (unsigned long)circuit.noconv);
+    fprintf(stderr, ", t=%.6g s, cpu %.3f s\n", (double)circuit.t, cpu);
+    return status != 0;
+}
@@ -0,0 +1,83 @@
+# Projeto: picoHIL - Firmware de simulação de circuitos
+#
+# Descrição:
+# Relatório de posicionamento depois do link: bytes por região de memória
+# do RP2350 (flash XIP, SRAM principal, scratch X e Y) e onde ficou cada
+# símbolo do caminho do passo. Roda como POST_BUILD (CMakeLists.txt); o
+# mapa completo do link fica em <alvo>.elf.map.
+#
+# Uso manual:
+#   cmake -DNM=arm-none-eabi-nm -DELF=build/picoHIL_BETAv0.elf \
+#         -P tools/placement_report.cmake
+#   -DPATTERN=<regex> muda os símbolos listados
+#
+# Licença: ver arquivo LICENSE na raiz do repositório.
+
+if(NOT PATTERN)
+    set(PATTERN "^(ms_|pwmdac_set|pwmdac_commit|output_circuit|circuit$|circuit_mem)")
+endif()
+
+execute_process(COMMAND ${NM} -S -n ${ELF}
+                OUTPUT_VARIABLE syms RESULT_VARIABLE res)
+if(NOT res EQUAL 0)
+    message(WARNING "placement_report: falha ao ler ${ELF}")
+    return()
+endif()
+
+# Regiões do RP2350: [início, fim)
+set(regions flash sram scratch_x scratch_y)
+set(flash_lo     0x10000000)
+set(flash_hi     0x14000000)
+set(sram_lo      0x20000000)
+set(sram_hi      0x20080000)
+set(scratch_x_lo 0x20080000)
+set(scratch_x_hi 0x20081000)
+set(scratch_y_lo 0x20081000)
+set(scratch_y_hi 0x20082000)
+foreach(r IN LISTS regions)
+    math(EXPR ${r}_lo "${${r}_lo}")
+    math(EXPR ${r}_hi "${${r}_hi}")
+    set(${r}_bytes 0)
+endforeach()
+
+set(hot "")
+set(hot_in_flash 0)
+string(REPLACE "\n" ";" lines "${syms}")
+foreach(l IN LISTS lines)
+    if(NOT l MATCHES "^([0-9a-fA-F]+) ([0-9a-fA-F]+) ([A-Za-z]) (.+)$")
+        continue()
+    endif()
+    set(name ${CMAKE_MATCH_4})
+    set(type ${CMAKE_MATCH_3})
+    math(EXPR addr "0x${CMAKE_MATCH_1}")
+    math(EXPR size "0x${CMAKE_MATCH_2}")
+
+    set(where "")
+    foreach(r IN LISTS regions)
+        if(addr GREATER_EQUAL ${r}_lo AND addr LESS ${r}_hi)
+            set(where ${r})
+        endif()
+    endforeach()
+    if(NOT where)
+        continue()
+    endif()
+    math(EXPR ${where}_bytes "${${where}_bytes} + ${size}")
+
+    if(name MATCHES "${PATTERN}")
+        if(where STREQUAL "flash")
+            # Só conta: montagem do circuito, netlist e listagem ficam na flash
+            if(type MATCHES "[tT]")
+                math(EXPR hot_in_flash "${hot_in_flash} + 1")
+            endif()
+        else()
+            string(APPEND hot "  ${where}\t${size} B\t${name}\n")
+        endif()
+    endif()
+endforeach()
+
+message(STATUS "Posicionamento de ${ELF}:")
+foreach(r IN LISTS regions)
+    message(STATUS "  ${r}: ${${r}_bytes} B")
+endforeach()
+message(STATUS "Símbolos fora da flash (${PATTERN}):\n${hot}"
+               "  (${hot_in_flash} funções do mesmo filtro na flash)")
@@ -0,0 +1,191 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Modelo no host do PWMDAC com dithering (pwmdac.h): gera a forma de onda
+ * PWM período a período, com a mesma sequência que o DMA envia, passa
+ * pelo filtro RC da PCB (2k2/10nF) e mede, em regime, o erro médio e o
+ * ripple na saída. Compara com o PWM de 8 bits puro e mostra onde fica
+ * a energia do erro de quantização (formatação de ruído).
+ *
+ * O ripple da portadora (~586 kHz) é o mesmo com ou sem dithering e não
+ * depende do código; a resolução é avaliada pela saída média em cada
+ * período de PWM, que remove a portadora e mantém o ripple do dithering.
+ * Esses bits efetivos valem só para o valor médio (DC e sinais lentos,
+ * ou com um filtro que corte a portadora): a saída do RC da PCB ainda
+ * tem ~65 mV pp de portadora, ~80 LSB de 12 bits, e os bits efetivos
+ * contando a portadora (erro tick a tick) também são mostrados.
+ *
+ * Compilação e uso (no diretório firmware/pico2OLED):
+ *   gcc -O2 -I. tools/pwmdac_model.c -lm -o pwmdac_model
+ *   ./pwmdac_model
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "pwmdac.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define CLK_HZ      150.0e6     // clk_sys do RP2350
+#define WRAP        255         // PWM_WRAP
+#define VREF        3.3
+#define R_FILT      2200.0
+#define C_FILT      10.0e-9
+#define SETTLE_SEQ  400         // sequências descartadas (~20 tau)
+#define MEASURE_SEQ 32          // sequências medidas
+
+typedef struct {
+    double mean;        // média da saída filtrada [V]
+    double ripple;      // ripple pico a pico das médias por período [V]
+    double carrier;     // ripple pico a pico total, com a portadora [V]
+    double sq_err;      // soma dos erros quadráticos das médias por período
+    long   n;           // número de períodos medidos
+    double sq_tick;     // soma dos erros quadráticos tick a tick (com portadora)
+    long   n_tick;      // número de ticks medidos
+} rc_result_t;
+
+// Simula o PWM tick a tick (contador 0..WRAP, saída alta enquanto < CC)
+// com a sequência seq[] repetida e filtra pelo RC (discretização exata).
+static rc_result_t simulate(const uint16_t *seq, int len, double ideal)
+{
+    const double a = 1.0 - exp(-1.0 / (CLK_HZ * R_FILT * C_FILT));
+    double v = 0.0, sum = 0.0, sq = 0.0, sq_tick = 0.0;
+    double vmin = 1e9, vmax = -1e9, pmin = 1e9, pmax = -1e9;
+    long n = 0, n_tick = 0;
+
+    for (int rep = 0; rep < SETTLE_SEQ + MEASURE_SEQ; rep++) {
+        for (int k = 0; k < len; k++) {
+            double psum = 0.0;
+            for (int tick = 0; tick <= WRAP; tick++) {
+                double u = (tick < seq[k]) ? VREF : 0.0;
+                v += (u - v) * a;
+                psum += v;
+                if (rep >= SETTLE_SEQ) {
+                    if (v < vmin) vmin = v;
+                    if (v > vmax) vmax = v;
+                    sq_tick += (v - ideal) * (v - ideal);
+                    n_tick++;
+                }
+            }
+            if (rep >= SETTLE_SEQ) {
+                double pavg = psum / (WRAP + 1);
+                sum += pavg; n++;
+                sq  += (pavg - ideal) * (pavg - ideal);
+                if (pavg < pmin) pmin = pavg;
+                if (pavg > pmax) pmax = pavg;
+            }
+        }
+    }
+
+    rc_result_t r = { sum / (double)n, pmax - pmin, vmax - vmin, sq, n, sq_tick, n_tick };
+    return r;
+}
+
+// Ganho do RC na frequência f
+static double rc_gain(double f)
+{
+    double w = 2.0 * M_PI * f * R_FILT * C_FILT;
+    return 1.0 / sqrt(1.0 + w * w);
+}
+
+int main(void)
+{
+    const int    levels = (WRAP + 1) << PWMDAC_DITHER_BITS;
+    const double lsb    = VREF / (double)levels;
+    const double f_pwm  = CLK_HZ / (WRAP + 1);
+    const double f_seq  = f_pwm / PWMDAC_SEQ_LEN;
+
+    printf("PWM %.1f kHz, sequencia %d periodos (%.1f kHz), RC fc = %.2f kHz\n",
+           f_pwm / 1e3, PWMDAC_SEQ_LEN, f_seq / 1e3,
+           1.0 / (2.0 * M_PI * R_FILT * C_FILT) / 1e3);
+    printf("Codigo de %d bits, 1 LSB = %.3f mV\n\n",
+           8 + PWMDAC_DITHER_BITS, lsb * 1e3);
+
+    // ------------------------------------------------------------------
+    // 1) Formatação de ruído: espectro do erro de cada parte fracionária
+    // ------------------------------------------------------------------
+    // Erro da sequência (em LSB de 8 bits) projetado nas harmônicas de
+    // f_seq e atenuado pelo RC; o dithering deve deixar a 1ª harmônica
+    // (mais próxima do corte) com o mínimo de energia.
+    printf("frac | 1a harm (sem RC) | residuo apos RC [LSB%d]\n",
+           8 + PWMDAC_DITHER_BITS);
+    double worst_res = 0.0;
+    for (int f = 1; f < PWMDAC_SEQ_LEN; f++) {
+        uint16_t seq[PWMDAC_SEQ_LEN];
+        pwmdac_dither_seq((uint32_t)f, seq);
+
+        double mean = (double)f / PWMDAC_SEQ_LEN;
+        double h1 = 0.0, res = 0.0;
+        for (int k = 1; k <= PWMDAC_SEQ_LEN / 2; k++) {
+            double re = 0.0, im = 0.0;
+            for (int i = 0; i < PWMDAC_SEQ_LEN; i++) {
+                double e = (double)seq[i] - mean;
+                re += e * cos(2.0 * M_PI * k * i / PWMDAC_SEQ_LEN);
+                im -= e * sin(2.0 * M_PI * k * i / PWMDAC_SEQ_LEN);
+            }
+            double amp = 2.0 * sqrt(re * re + im * im) / PWMDAC_SEQ_LEN;
+            if (k == 1) h1 = amp;
+            double g = rc_gain(k * f_seq);
+            res += (amp * g) * (amp * g);
+        }
+        res = sqrt(res) * PWMDAC_SEQ_LEN;   // em LSB estendido
+        if (res > worst_res) worst_res = res;
+        printf("%4d | %16.4f | %8.4f\n", f, h1, res);
+    }
+
+    // ------------------------------------------------------------------
+    // 2) Simulação no tempo: erro médio e ripple, com e sem dithering
+    // ------------------------------------------------------------------
+    double err_d = 0.0, rip_d = 0.0, err_8 = 0.0, rip_8 = 0.0, carrier = 0.0;
+    double sq_d = 0.0, sq_8 = 0.0, sqt_d = 0.0, sqt_8 = 0.0;
+    long   n_d = 0, n_8 = 0, nt_d = 0, nt_8 = 0;
+    for (int code = 0; code < levels; code += 37) {
+        uint16_t seq[PWMDAC_SEQ_LEN];
+        double ideal = code * lsb;
+
+        pwmdac_dither_seq((uint32_t)code, seq);
+        rc_result_t d = simulate(seq, PWMDAC_SEQ_LEN, ideal);
+
+        uint16_t base = (uint16_t)(code >> PWMDAC_DITHER_BITS);
+        rc_result_t p = simulate(&base, 1, ideal);
+
+        sq_d += d.sq_err; n_d += d.n;
+        sq_8 += p.sq_err; n_8 += p.n;
+        sqt_d += d.sq_tick; nt_d += d.n_tick;
+        sqt_8 += p.sq_tick; nt_8 += p.n_tick;
+        if (d.carrier > carrier) carrier = d.carrier;
+        if (fabs(d.mean - ideal) > err_d) err_d = fabs(d.mean - ideal);
+        if (d.ripple > rip_d) rip_d = d.ripple;
+        if (fabs(p.mean - ideal) > err_8) err_8 = fabs(p.mean - ideal);
+        if (p.ripple > rip_8) rip_8 = p.ripple;
+    }
+
+    // Bits efetivos pelo erro RMS: um quantizador ideal de N bits tem
+    // erro RMS de LSB/sqrt(12), então ENOB = log2(VREF / (rms * sqrt(12))).
+    // "media" usa a média por período (sem portadora); "c/ port." usa a
+    // saída do RC tick a tick, como um ADC rápido veria.
+    double rms_d  = sqrt(sq_d / (double)n_d);
+    double rms_8  = sqrt(sq_8 / (double)n_8);
+    double rmst_d = sqrt(sqt_d / (double)nt_d);
+    double rmst_8 = sqrt(sqt_8 / (double)nt_8);
+    printf("\n             | erro medio max | ripple pp max | erro RMS  | bits efetivos\n");
+    printf("             |                |               |  (media)  | media | c/ port.\n");
+    printf("PWM 8 bits   | %10.3f mV  | %9.3f mV  | %6.3f mV | %5.2f | %5.2f\n",
+           err_8 * 1e3, rip_8 * 1e3, rms_8 * 1e3, log2(VREF / (rms_8 * sqrt(12.0))),
+           log2(VREF / (rmst_8 * sqrt(12.0))));
+    printf("dithering    | %10.3f mV  | %9.3f mV  | %6.3f mV | %5.2f | %5.2f\n",
+           err_d * 1e3, rip_d * 1e3, rms_d * 1e3, log2(VREF / (rms_d * sqrt(12.0))),
+           log2(VREF / (rmst_d * sqrt(12.0))));
+    printf("(ripple da portadora, igual nos dois casos: %.1f mV pp = %.0f LSB%d;\n"
+           " os bits efetivos pela media valem so para o valor medio)\n",
+           carrier * 1e3, carrier / lsb, 8 + PWMDAC_DITHER_BITS);
+    printf("\npior residuo espectral apos RC: %.3f LSB%d\n",
+           worst_res, 8 + PWMDAC_DITHER_BITS);
+
+    return 0;
+}
@@ -0,0 +1,292 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Custo dos solvers em malhas RC de k x k nós, no host:
+ *   1. motor do firmware: resistores entre vizinhos, capacitor de cada nó
+ *      para o terra, fonte senoidal no canto (nó 1, eliminada) e carga no
+ *      canto oposto. Para cada tamanho e solver: custo por passo,
+ *      iterações por passo (iterativos) e o maior desvio da tensão no
+ *      último nó contra a LU. Com -m entra uma chave do último nó ao
+ *      terra (aberta: o controle nunca chega a vth) e a matriz deixa de
+ *      ser constante, como num circuito que comuta: a cada passo a LU
+ *      refatora, o SOR refaz diagonal e ordem e o CG monta o CSR e refaz
+ *      o precondicionador;
+ *   2. núcleos: ms_gauss_solve contra ms_cg_solve (CSR, Jacobi e IC0) na
+ *      matriz nodal da mesma malha, até 16 x 16, partindo de x = 0 (sem o
+ *      chute do passo anterior), e o menor n em que o CG fica mais barato.
+ *
+ * As malhas passam dos limites do firmware; compilar com limites maiores:
+ *   gcc -O2 -DMS_HOST_BUILD -DMS_MAX_NODES=64 -DMS_MAX_ELEMS=190 -I. \
+ *       tools/solver_bench.c mini_spiceHILv3.c -lm -o solver_bench
+ *
+ * Uso:
+ *   ./solver_bench [-c capacitancia] [-s passos] [-m]
+ *   (C menor deixa a malha mais "resistiva" e os iterativos mais lentos)
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "mini_spiceHILv3.h"
+
+#define BENCH_R         1e3f
+#define BENCH_RLOAD     100e3f
+#define BENCH_RSW_OFF   1e6f        // chave de -m, sempre aberta
+#define BENCH_DT        100e-6f
+#define BENCH_K_MAX     8           // 64 nós
+#define BENCH_KK_MAX    16          // núcleos: 256 incógnitas
+
+typedef struct {
+    const char      *name;
+    ms_solver_type_t solver;
+    float            omega;         // 0 = estimado
+    int              redblack;
+    ms_cg_precond_t  precond;
+} bench_case_t;
+
+static const bench_case_t cases[] = {
+    { "lu",        MS_SOLVER_LU,           1.0f, 0, MS_CG_JACOBI },
+    { "gauss",     MS_SOLVER_GAUSS,        1.0f, 0, MS_CG_JACOBI },
+    { "seidel",    MS_SOLVER_GAUSS_SEIDEL, 1.0f, 0, MS_CG_JACOBI },
+    { "seidel rb", MS_SOLVER_GAUSS_SEIDEL, 1.0f, 1, MS_CG_JACOBI },
+    { "sor",       MS_SOLVER_GAUSS_SEIDEL, 0.0f, 0, MS_CG_JACOBI },     // já em vermelho-preto
+    { "cg jacobi", MS_SOLVER_CG,           1.0f, 0, MS_CG_JACOBI },
+    { "cg ic",     MS_SOLVER_CG,           1.0f, 0, MS_CG_IC0    },
+};
+#define BENCH_CASES ((int)(sizeof cases / sizeof cases[0]))
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ======================================================
+// MOTOR
+// ======================================================
+
+static ms_circuit_t circuit;
+static float        circuit_mem[MS_MEM_MAX_BYTES / sizeof(float)];
+static float       *ref;            // v(último nó) da LU, por passo
+
+static void build(int k, float cap, int renew, const bench_case_t *bc)
+{
+    int n = k * k;
+    ms_circuit_init(&circuit, n, BENCH_DT);
+    ms_set_solver(&circuit, bc->solver);
+    ms_set_sor(&circuit, bc->omega, bc->redblack);
+    ms_set_cg(&circuit, bc->precond);
+
+    for (int r = 0; r < k; r++) {
+        for (int c = 0; c < k; c++) {
+            int node = r * k + c + 1;
+            if (c + 1 < k) ms_add_resistor(&circuit, node, node + 1, BENCH_R);
+            if (r + 1 < k) ms_add_resistor(&circuit, node, node + k, BENCH_R);
+            if (node != 1) ms_add_capacitor(&circuit, node, 0, cap);
+        }
+    }
+    ms_add_resistor(&circuit, n, 0, BENCH_RLOAD);
+    ms_add_sine_source(&circuit, 1, 0, 5.0f, 0.0f, 50.0f, 0.0f);
+    if (renew)      // controlada pela fonte (5 V de pico), vth acima disso
+        ms_add_switch(&circuit, n, 0, 1, 0, 1.0f, BENCH_RSW_OFF, 10.0f);
+    ms_circuit_finalize(&circuit, circuit_mem, sizeof circuit_mem);
+}
+
+static int run_case(int k, float cap, int steps, int renew, const bench_case_t *bc,
+                    int is_ref)
+{
+    build(k, cap, renew, bc);
+
+    int n = k * k, status = 0;
+    double dev = 0.0;
+    double t0 = seconds();
+    for (int s = 0; s < steps; s++) {
+        status = ms_circuit_step(&circuit);
+        if (status != 0) break;
+        float v = ms_get_node_voltage(&circuit, n);
+        if (is_ref) ref[s] = v;
+        else if (fabs(v - ref[s]) > dev) dev = fabs(v - ref[s]);
+    }
+    double us = (seconds() - t0) * 1e6 / steps;
+
+    if (status != 0) {
+        printf("%3d  %-10s t=%g: %s\n", n, bc->name, (double)circuit.t,
+               ms_system_status_str(status));
+        return status;
+    }
+    printf("%3d  %-10s %9.2f", circuit.reduced_size, bc->name, us);
+    if (bc->solver == MS_SOLVER_GAUSS_SEIDEL)
+        printf(" %7.2f %6.3f %6lu", (double)circuit.iters_total / steps,
+               (double)circuit.sor_omega, (unsigned long)circuit.noconv);
+    else if (bc->solver == MS_SOLVER_CG)
+        printf(" %7.2f %6s %6lu", (double)circuit.iters_total / steps, "-",
+               (unsigned long)circuit.noconv);
+    else
+        printf(" %7s %6s %6s", "-", "-", "-");
+    printf(" %9.2e\n", dev);
+    return 0;
+}
+
+// ======================================================
+// NÚCLEOS: GAUSS DENSO x CG EM CSR
+// ======================================================
+
+#define KN_MAX  (BENCH_KK_MAX * BENCH_KK_MAX)
+#define KNZ_MAX (5 * KN_MAX)
+
+static float    kd_mem[KN_MAX * KN_MAX], kw_mem[KN_MAX * KN_MAX];
+static float   *kd[KN_MAX], *kw[KN_MAX];
+static float    kb[KN_MAX], kbw[KN_MAX], kx_ref[KN_MAX], kx[KN_MAX];
+static uint16_t k_row[KN_MAX + 1], k_diag[KN_MAX];
+static uint8_t  k_col[KNZ_MAX];
+static float    k_val[KNZ_MAX], k_l[KNZ_MAX], k_rdiag[KN_MAX], k_work[4 * KN_MAX];
+
+// Matriz nodal da malha k x k (G entre vizinhos, C/dt de cada nó para o
+// terra), densa e em CSR, e um b qualquer
+static ms_csr_t grid_system(int k, float cap)
+{
+    int n = k * k;
+    float g = 1.0f / BENCH_R, gc = cap / BENCH_DT;
+
+    for (int i = 0; i < n; i++) {
+        kd[i] = &kd_mem[i * n];
+        kw[i] = &kw_mem[i * n];
+        for (int j = 0; j < n; j++) kd[i][j] = 0.0f;
+    }
+    for (int i = 0; i < n; i++) {
+        int r = i / k, c = i % k;
+        kd[i][i] += gc;
+        if (c + 1 < k) { kd[i][i] += g; kd[i + 1][i + 1] += g; kd[i][i + 1] = kd[i + 1][i] = -g; }
+        if (r + 1 < k) { kd[i][i] += g; kd[i + k][i + k] += g; kd[i][i + k] = kd[i + k][i] = -g; }
+        kb[i] = gc * 0.1f * (float)(i % 7) + (i == 0 ? 5.0f * g : 0.0f);
+    }
+
+    int p = 0;
+    for (int i = 0; i < n; i++) {
+        k_row[i] = (uint16_t)p;
+        for (int j = 0; j < n; j++) {
+            if (kd[i][j] == 0.0f) continue;
+            if (j == i) k_diag[i] = (uint16_t)p;
+            k_col[p]   = (uint8_t)j;
+            k_val[p++] = kd[i][j];
+        }
+        k_rdiag[i] = 1.0f / kd[i][i];
+    }
+    k_row[n] = (uint16_t)p;
+
+    ms_csr_t m = { .n = n, .row = k_row, .diag = k_diag, .col = k_col, .val = k_val };
+    return m;
+}
+
+// Tempo médio de uma solução com CG partindo de x = 0
+static double time_cg(const ms_csr_t *m, ms_cg_t *s, int reps)
+{
+    double t = 0.0;
+    for (int r = 0; r < reps; r++) {
+        for (int i = 0; i < m->n; i++) kx[i] = 0.0f;
+        double t0 = seconds();
+        ms_cg_solve(m, kb, kx, s);
+        t += seconds() - t0;
+    }
+    return t * 1e6 / reps;
+}
+
+static double max_dev(int n)
+{
+    double d = 0.0;
+    for (int i = 0; i < n; i++)
+        if (fabs((double)kx[i] - kx_ref[i]) > d) d = fabs((double)kx[i] - kx_ref[i]);
+    return d;
+}
+
+static void bench_kernels(float cap)
+{
+    int cross_j = 0, cross_ic = 0;
+
+    printf("nucleos, x = 0 na partida (us por solucao; IC0 fatorado uma vez):\n");
+    printf("%4s %5s %10s %10s %5s %10s %5s %9s %9s\n", "n", "nnz", "Gauss", "CG jacobi",
+           "iter", "CG ic", "iter", "IC0", "desvio");
+    for (int k = 2; k <= BENCH_KK_MAX; k++) {
+        int n = k * k;
+        ms_csr_t m = grid_system(k, cap);
+        int nnz = m.row[n];
+
+        int reps = 2000000 / (n * n) + 10;
+        double tg = 0.0;
+        for (int r = 0; r < reps; r++) {
+            for (int i = 0; i < n; i++) {
+                memcpy(kw[i], kd[i], (size_t)n * sizeof(float));
+                kbw[i] = kb[i];
+            }
+            double t0 = seconds();
+            ms_gauss_solve(n, kw, kbw, kx_ref);
+            tg += seconds() - t0;
+        }
+        tg = tg * 1e6 / reps;
+
+        int reps_cg = 2000000 / (nnz * 20) + 10;
+        ms_cg_t sj = { .m = k_rdiag, .ic = 0, .max_iter = n, .tol = MS_CG_TOL, .work = k_work };
+        double tj = time_cg(&m, &sj, reps_cg);
+        double dev = max_dev(n);
+
+        double t0 = seconds();
+        for (int r = 0; r < reps_cg; r++) ms_ic0_factor(&m, k_l);
+        double tf = (seconds() - t0) * 1e6 / reps_cg;
+        ms_cg_t si = { .m = k_l, .ic = 1, .max_iter = n, .tol = MS_CG_TOL, .work = k_work };
+        double ti = time_cg(&m, &si, reps_cg);
+        if (max_dev(n) > dev) dev = max_dev(n);
+
+        printf("%4d %5d %10.2f %10.2f %5d %10.2f %5d %9.2f %9.2e\n",
+               n, nnz, tg, tj, sj.iters, ti, si.iters, tf, dev);
+        if (!cross_j  && tj < tg) cross_j  = n;
+        if (!cross_ic && ti < tg) cross_ic = n;
+    }
+    printf("CG mais barato que Gauss a partir de n = %d (jacobi), n = %d (ic)\n",
+           cross_j, cross_ic);
+}
+
+int main(int argc, char **argv)
+{
+    float cap = 100e-9f;
+    int steps = 2000, renew = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if      (!strcmp(argv[i], "-c") && i + 1 < argc) cap   = strtof(argv[++i], NULL);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc) steps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-m")) renew = 1;
+        else {
+            fprintf(stderr, "uso: solver_bench [-c capacitancia] [-s passos] [-m]\n");
+            return 2;
+        }
+    }
+    if (BENCH_K_MAX * BENCH_K_MAX > MS_MAX_NODES) {
+        fprintf(stderr, "compilar com -DMS_MAX_NODES=%d -DMS_MAX_ELEMS=190\n",
+                BENCH_K_MAX * BENCH_K_MAX);
+        return 2;
+    }
+    if (!(cap > 0.0f) || steps <= 0) return 2;
+    ref = malloc((size_t)steps * sizeof(float));
+    if (!ref) return 1;
+
+    printf("malha RC: R=%g ohm, C=%g F, dt=%g us, %d passos%s\n", (double)BENCH_R,
+           (double)cap, (double)(BENCH_DT * 1e6f), steps, renew ? ", com chave (matriz nova a cada passo)" : "");
+    printf("%3s  %-10s %9s %7s %6s %6s %9s\n", "n", "solver", "us/passo",
+           "iter", "omega", "s/conv", "desvio");
+
+    int status = 0;
+    for (int k = 2; k <= BENCH_K_MAX && status == 0; k++) {
+        for (int c = 0; c < BENCH_CASES && status == 0; c++)
+            status = run_case(k, cap, steps, renew, &cases[c], c == 0);
+        printf("\n");
+    }
+    free(ref);
+    if (status == 0)
+        bench_kernels(cap);
+    return status != 0;
+}
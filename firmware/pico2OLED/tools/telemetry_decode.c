@@ -0,0 +1,221 @@
+/*
+ * Projeto: picoHIL - Firmware de simulação de circuitos
+ *
+ * Descrição:
+ * Decodificador da telemetria binária (telemetry.h) no host. Lê o fluxo
+ * bruto da USB (arquivo ou stdin), separa os quadros COBS, confere o
+ * CRC e grava as amostras em CSV ou VCD, já em valores físicos. Texto
+ * comum misturado no fluxo (printf do firmware) é ignorado.
+ *
+ * Compilação (no diretório firmware/pico2OLED):
+ *   gcc -O2 -DMS_HOST_BUILD -I. tools/telemetry_decode.c -o telemetry_decode
+ *
+ * Uso (Linux):
+ *   stty -F /dev/ttyACM0 raw -echo
+ *   echo '!stream 1' > /dev/ttyACM0
+ *   ./telemetry_decode -i /dev/ttyACM0 -o ondas.csv       (Ctrl+C para parar)
+ *   ./telemetry_decode -i captura.bin -f vcd -o ondas.vcd
+ *
+ * Captura com disparo (capture.h): o quadro TRIG vira um comentário com a
+ * amostra do disparo; o tempo das amostras conta a partir do armar.
+ *   echo '!cap dump' > /dev/ttyACM0
+ *
+ * Licença: ver arquivo LICENSE na raiz do repositório.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "telemetry.h"
+
+typedef struct {
+    int   nch;
+    float dt;
+    int   decim;
+    uint8_t type[TELEM_MAX_CH], a[TELEM_MAX_CH], b[TELEM_MAX_CH];
+    float gain[TELEM_MAX_CH], offset[TELEM_MAX_CH];
+} desc_t;
+
+static desc_t desc;
+static int    have_desc = 0;
+static int    vcd = 0;
+static int    header_done = 0;
+static FILE  *out;
+
+static long frames_ok = 0, frames_bad = 0, samples = 0, dropped = 0, seq_gaps = 0;
+static long triggers = 0;
+static int  last_seq = -1;
+static volatile sig_atomic_t stop = 0;
+
+static void on_sigint(int s) { (void)s; stop = 1; }
+
+static uint16_t get16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t get32(const uint8_t *p) { return get16(p) | ((uint32_t)get16(p + 2) << 16); }
+
+static void probe_name(int i, char *buf, size_t len)
+{
+    switch (desc.type[i]) {
+    case MS_PROBE_NODE:    snprintf(buf, len, "V(%d)", desc.a[i]); break;
+    case MS_PROBE_DIFF:    snprintf(buf, len, "V(%d,%d)", desc.a[i], desc.b[i]); break;
+    case MS_PROBE_CURRENT: snprintf(buf, len, "I(e%d)", desc.a[i]); break;
+    default:               snprintf(buf, len, "p%d", i); break;
+    }
+}
+
+static void write_header(void)
+{
+    char name[24];
+
+    if (vcd) {
+        fprintf(out, "$timescale 1 ns $end\n$scope module picoHIL $end\n");
+        for (int i = 0; i < desc.nch; i++) {
+            probe_name(i, name, sizeof name);
+            // Identificadores VCD: '!' + i; parênteses não são aceitos em nomes
+            for (char *p = name; *p; p++) if (*p == '(' || *p == ')' || *p == ',') *p = '_';
+            fprintf(out, "$var real 64 %c %s $end\n", '!' + i, name);
+        }
+        fprintf(out, "$upscope $end\n$enddefinitions $end\n");
+    } else {
+        fprintf(out, "t");
+        for (int i = 0; i < desc.nch; i++) {
+            probe_name(i, name, sizeof name);
+            fprintf(out, ",%s", name);
+        }
+        fprintf(out, "\n");
+    }
+    header_done = 1;
+}
+
+static void handle_desc(const uint8_t *p, size_t len)
+{
+    desc_t d;
+    if (len < 8) return;
+
+    memcpy(&d.dt, p, 4);
+    d.decim = get16(p + 4);
+    d.nch   = p[6];
+    if (d.nch > TELEM_MAX_CH || len != 8 + (size_t)d.nch * 12) return;
+
+    for (int i = 0; i < d.nch; i++) {
+        const uint8_t *q = p + 8 + i * 12;
+        d.type[i] = q[0]; d.a[i] = q[1]; d.b[i] = q[2];
+        memcpy(&d.gain[i],   q + 4, 4);
+        memcpy(&d.offset[i], q + 8, 4);
+    }
+
+    // Mudança de canais no meio do arquivo: novo cabeçalho (CSV)
+    if (have_desc && header_done && (d.nch != desc.nch ||
+        memcmp(d.type, desc.type, sizeof d.type) || memcmp(d.a, desc.a, sizeof d.a))) {
+        if (vcd) fprintf(stderr, "aviso: descritor mudou; VCD mantém os canais iniciais\n");
+        else header_done = 0;
+    }
+    desc = d;
+    have_desc = 1;
+}
+
+static void handle_data(const uint8_t *p, size_t len)
+{
+    if (!have_desc || len < 8) return;
+
+    uint32_t step = get32(p);
+    dropped += get16(p + 4);
+    int nch = p[6], n = p[7];
+    if (nch != desc.nch || len != 8 + (size_t)n * nch * 2) return;
+    if (!header_done) write_header();
+
+    const uint8_t *s = p + 8;
+    for (int k = 0; k < n; k++) {
+        double t = (double)(step + (uint32_t)(k * desc.decim)) * desc.dt;
+        if (vcd) fprintf(out, "#%lld\n", (long long)(t * 1e9 + 0.5));
+        else     fprintf(out, "%.7g", t);
+
+        for (int i = 0; i < nch; i++, s += 2) {
+            int16_t q = (int16_t)get16(s);
+            double y = ((double)q + 32768.0) / 65535.0;
+            double v = (desc.gain[i] != 0.0f) ? (y - desc.offset[i]) / desc.gain[i] : 0.0;
+            if (vcd) fprintf(out, "r%.7g %c\n", v, '!' + i);
+            else     fprintf(out, ",%.7g", v);
+        }
+        if (!vcd) fprintf(out, "\n");
+        samples++;
+    }
+}
+
+static void handle_trigger(const uint8_t *p, size_t len)
+{
+    if (len != 8) return;
+
+    unsigned long step = get32(p);
+    unsigned pre = get16(p + 4), post = get16(p + 6);
+    triggers++;
+
+    if (vcd) {
+        if (header_done) fprintf(out, "$comment disparo passo %lu, pre %u, pos %u $end\n", step, pre, post);
+    } else {
+        // Uma tabela nova (com cabeçalho) para cada captura
+        fprintf(out, "# disparo passo %lu, pre %u, pos %u\n", step, pre, post);
+        header_done = 0;
+    }
+}
+
+static void handle_frame(const uint8_t *enc, size_t len)
+{
+    uint8_t f[TELEM_FRAME_MAX + 8];
+
+    if (len == 0) return;
+    if (len > TELEM_COBS_MAX(TELEM_FRAME_MAX)) { frames_bad++; return; }
+
+    size_t n = telemetry_cobs_decode(enc, len, f);
+    if (n < 4 || telemetry_crc16(f, n - 2) != get16(&f[n - 2])) {
+        frames_bad++;
+        return;
+    }
+    frames_ok++;
+
+    if (last_seq >= 0 && f[1] != (uint8_t)(last_seq + 1)) seq_gaps++;
+    last_seq = f[1];
+
+    if (f[0] == TELEM_FRAME_DESC)      handle_desc(f + 2, n - 4);
+    else if (f[0] == TELEM_FRAME_DATA) handle_data(f + 2, n - 4);
+    else if (f[0] == TELEM_FRAME_TRIG) handle_trigger(f + 2, n - 4);
+}
+
+int main(int argc, char **argv)
+{
+    const char *in_path = NULL, *out_path = NULL;
+    static uint8_t buf[TELEM_COBS_MAX(TELEM_FRAME_MAX) + 1];
+    size_t len = 0;
+    int overflow = 0;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if      (!strcmp(argv[i], "-i")) in_path  = argv[i + 1];
+        else if (!strcmp(argv[i], "-o")) out_path = argv[i + 1];
+        else if (!strcmp(argv[i], "-f")) vcd = !strcmp(argv[i + 1], "vcd");
+        else { fprintf(stderr, "uso: telemetry_decode [-i entrada] [-o saida] [-f csv|vcd]\n"); return 2; }
+    }
+
+    FILE *in = in_path ? fopen(in_path, "rb") : stdin;
+    out = out_path ? fopen(out_path, "w") : stdout;
+    if (!in || !out) { perror("abrir"); return 1; }
+    signal(SIGINT, on_sigint);
+
+    int ch;
+    while (!stop && (ch = fgetc(in)) != EOF) {
+        if (ch == 0) {
+            if (!overflow) handle_frame(buf, len);
+            len = 0;
+            overflow = 0;
+        } else if (len < sizeof buf) {
+            buf[len++] = (uint8_t)ch;
+        } else {
+            overflow = 1;               // texto longo ou lixo: espera o próximo 0x00
+        }
+    }
+
+    fflush(out);
+    fprintf(stderr, "quadros ok %ld, invalidos %ld, saltos de seq %ld, "
+                    "amostras %ld, perdidas no firmware %ld, disparos %ld\n",
+            frames_ok, frames_bad, seq_gaps, samples, dropped, triggers);
+    return 0;
+}